@@ -0,0 +1,30 @@
+#include "sound_fun_rtttl.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+MelodyState alarmState;
+MelodyControls alarmControls;  // Tempo and key of the alarm
+uint8_t urgency = 0;
+uint32_t lastRaise = 0;
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+
+  setMelodyControls(alarmState, &alarmControls);
+  playRTTTLMelody(alarmState, NOKIA, true, 255);
+  lastRaise = millis();
+}
+
+void loop() {
+  updateMelody(alarmState);
+
+  // Every 5 seconds the alarm gets faster and a whole tone higher, from the next note on
+  if (urgency < 8 && millis() - lastRaise >= 5000) {
+    lastRaise = millis();
+    urgency++;
+    setMelodyTempo(alarmState, 100 + 25 * urgency);
+    setMelodyTranspose(alarmState, 2 * urgency);
+    Serial.print("Urgency: ");
+    Serial.println(urgency);
+  }
+}
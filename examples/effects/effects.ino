@@ -0,0 +1,32 @@
+// An RTTTL melody played through table-driven effects: vibrato, then a trill, then the siren preset.
+#include "sound_fun_rtttl.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+EffectOutput<> voice;  // Modulates every note sent to the speaker pin
+MelodyState melodyState;
+SirenState sirenState;
+uint8_t step = 0;
+
+void setup() {
+  initSpeaker();
+  startEffect(voice.effect, &EFFECT_VIBRATO);
+  playRTTTLMelody(voice, melodyState, NOKIA, true);
+}
+
+void loop() {
+  updateMelody(voice, melodyState);
+  updateEffect(voice);
+  updateSiren(sirenState);
+
+  if (!melodyState.isPlaying && !sirenState.isPlaying) {
+    if (step == 0) {
+      startEffect(voice.effect, &EFFECT_TRILL);
+      playRTTTLMelody(voice, melodyState, XFILES, true);
+    } else if (step == 1) {
+      playSiren(sirenState, LOW_C, HIGH_C, LONG_DURATION);  // EFFECT_SIREN preset
+    } else {
+      return;
+    }
+    step++;
+  }
+}
@@ -0,0 +1,39 @@
+#include "sound_fun_rtttl.h"
+#include "melody_catalog_builtin.h"
+
+MelodyState melodyState;
+char command[MELODY_CATALOG_NAME_SIZE];
+uint8_t commandLength = 0;
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+
+  // List the catalog: metadata comes from flash, nothing is parsed
+  MelodyCatalogEntry entry;
+  for (size_t i = 0; readCatalogEntry(BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, i, entry); i++) {
+    Serial.print(entry.name);
+    Serial.print(F(" notes="));
+    Serial.print(entry.noteCount);
+    Serial.print(F(" ms="));
+    Serial.println(entry.duration);
+  }
+  Serial.println(F("Type a melody name"));
+}
+
+void loop() {
+  // Play the melody typed on the serial monitor, e.g. "nokia"
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (c == '\n' || c == '\r') {
+      command[commandLength] = '\0';
+      if (commandLength > 0 && !playCatalogMelody(melodyState, BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, command)) {
+        Serial.println(F("Unknown melody"));
+      }
+      commandLength = 0;
+    } else if (commandLength < MELODY_CATALOG_NAME_SIZE - 1) {
+      command[commandLength++] = c;
+    }
+  }
+  updateMelody(melodyState);
+}
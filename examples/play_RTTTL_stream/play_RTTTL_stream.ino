@@ -0,0 +1,26 @@
+#include "sound_fun_rtttl.h"
+
+MelodyState melodyState;
+RTTTLStream rtttlStream;
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+  initRTTTLStream(rtttlStream);
+  playRTTTLStream(melodyState, rtttlStream);
+  Serial.println(F("Send an RTTTL melody ending with a newline"));
+}
+
+void loop() {
+  // Notes are decoded as the text arrives; bytes that do not fit wait in the serial buffer
+  feedRTTTLStream(rtttlStream, Serial);
+  updateMelody(melodyState);
+
+  // Get ready for the next melody once this one has finished
+  if (!melodyState.isPlaying) {
+    Serial.print(F("Underruns: "));
+    Serial.println(rtttlStream.underruns);
+    initRTTTLStream(rtttlStream);
+    playRTTTLStream(melodyState, rtttlStream);
+  }
+}
@@ -0,0 +1,22 @@
+#include "sound_fun_rtttl.h"
+#include "melodies_compact.h"
+
+MelodyState melodyState;
+
+// Compact images take about one byte per note; make more with extras/tools/melody_compact
+const uint8_t* const playlist[] = { MISSION_COMPACT, SIMPSONS_COMPACT, GADGET_COMPACT, CANON_COMPACT };
+uint8_t track = 0;
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+
+  playCompactMelody(melodyState, playlist[track], true);
+}
+
+void loop() {
+  updateMelody(melodyState);
+  if (!melodyState.isPlaying && track + 1 < sizeof(playlist) / sizeof(playlist[0])) {
+    playCompactMelody(melodyState, playlist[++track], true);
+  }
+}
@@ -0,0 +1,22 @@
+#include "sound_fun_rtttl.h"
+#include "rtttl_compiled_melodies.h"
+
+MelodyState melodyState;
+
+// Compiled while the sketch builds: a typo in the string is a compile error
+PROGMEM_RTTTL(SHORT_NOKIA, "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#");
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+
+  // Start playing the precompiled melody from PROGMEM
+  playPackedMelody(melodyState, XFILES_PACKED, true, 2);  // Play 2 times
+}
+
+void loop() {
+  updateMelody(melodyState);
+  if (!melodyState.isPlaying) {
+    playPackedMelody(melodyState, SHORT_NOKIA, true);  // Then loop the short tune
+  }
+}
@@ -7,6 +7,7 @@ AlertState beepState;
 ToneSeriesState seriesState;
 SirenState sirenState;
 MelodyState rtttlState;
+uint32_t deadline; // Time the current sound needs its next update
 
 void setup() {
   Serial.begin(9600);
@@ -19,7 +20,8 @@ void setup() {
   // 1. Play a single tone
   Serial.println(F("Playing a single tone (MEDIUM_A, SHORT_DURATION)"));
   playTone(toneState, MEDIUM_A, SHORT_DURATION);
-  while (toneState.isPlaying) {
+  while (nextDeadline(toneState, deadline)) {
+    sleepUntil(deadline); // Sleep until the next transition instead of polling
     updateTone(toneState);
   }
   delay(500); // Short pause between examples
@@ -27,7 +29,8 @@ void setup() {
   // 2. Play an alert sequence
   Serial.println(F("Playing an alert sequence (3 tones, HIGH_C, MEDIUM_DURATION, 300ms lapse)"));
   playAlert(alertState, 3, HIGH_C, MEDIUM_DURATION, 300);
-  while (alertState.isPlaying) {
+  while (nextDeadline(alertState, deadline)) {
+    sleepUntil(deadline);
     updateAlert(alertState);
   }
   delay(500);
@@ -35,7 +38,8 @@ void setup() {
   // 3. Play a beep sequence
   Serial.println(F("Playing a beep sequence (5 beeps, LOW_G, VERY_SHORT_DURATION, 200ms lapse)"));
   playBeep(beepState, 5, LOW_G, VERY_SHORT_DURATION, 200);
-  while (beepState.isPlaying) {
+  while (nextDeadline(beepState, deadline)) {
+    sleepUntil(deadline);
     updateAlert(beepState);
   }
   delay(500);
@@ -43,7 +47,8 @@ void setup() {
   // 4. Play a tone series
   Serial.println(F("Playing a tone series (500Hz to 1000Hz, 50Hz steps, SHORT_DURATION)"));
   playToneSeries(seriesState, 500, 1000, 50, SHORT_DURATION);
-  while (seriesState.isPlaying) {
+  while (nextDeadline(seriesState, deadline)) {
+    sleepUntil(deadline);
     updateToneSeries(seriesState);
   }
   delay(500);
@@ -51,7 +56,8 @@ void setup() {
   // 5. Play a siren effect
   Serial.println(F("Playing a siren effect (LOW_C to HIGH_C, LONG_DURATION)"));
   playSiren(sirenState, LOW_C, HIGH_C, LONG_DURATION);
-  while (sirenState.isPlaying) {
+  while (nextDeadline(sirenState, deadline)) {
+    sleepUntil(deadline);
     updateSiren(sirenState);
   }
   delay(500);
@@ -60,7 +66,8 @@ void setup() {
   Serial.println(F("Playing an RTTTL melody (Nokia tune)"));
   const char* nokiaTune = "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#";
   playRTTTLMelody(rtttlState, nokiaTune, false, 2); // Play twice
-  while (rtttlState.isPlaying) {
+  while (nextDeadline(rtttlState, deadline)) {
+    sleepUntil(deadline);
     updateMelody(rtttlState);
   }
   delay(500);
@@ -0,0 +1,32 @@
+#include "sound_fun_rtttl.h"
+#include "sound_playlist.h"
+#include "melody_catalog_builtin.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+Playlist playlist;
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+  setMelodyTiming(playlist.melody, MELODY_TIMING_ABSOLUTE); // Keep the tempo across track changes
+  initPlaylist(playlist);
+
+  // Tracks from PROGMEM strings, RAM strings and the catalog play back to back
+  queueRTTTLTrack(playlist, NOKIA, true);
+  queueRTTTLTrack(playlist, "Beep:d=8,o=6,b=180:c,e,g,c7");
+  queueCatalogTrack(playlist, BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, "simpsons");
+  queueRTTTLTrack(playlist, XFILES, true, 2);
+}
+
+void loop() {
+  // The next track is prepared between notes, so it starts without a gap
+  updatePlaylist(playlist);
+
+  if (!isPlaylistPlaying(playlist)) {
+    Serial.print(F("Tracks played: "));
+    Serial.println(playlist.tracksPlayed);
+    delay(2000);
+    initPlaylist(playlist);
+    queueCatalogTrack(playlist, BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, "twinkle");
+  }
+}
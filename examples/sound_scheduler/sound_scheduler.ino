@@ -0,0 +1,30 @@
+#include "sound_fun_rtttl.h"
+#include "sound_scheduler.h"
+#include "rtttl_compiled_melodies.h"
+
+#define ALARM_PIN 2
+
+SoundScheduler scheduler;
+MelodyState backgroundMelody;
+SirenState alarmSiren;
+
+void setup() {
+  Serial.begin(9600);
+  initSpeaker();
+  pinMode(ALARM_PIN, INPUT_PULLUP);
+  initSoundScheduler(scheduler);
+
+  // Background melody with low priority
+  playPackedMelody(backgroundMelody, XFILES_PACKED, true, 3);
+  addSoundJob(scheduler, backgroundMelody, 1);
+}
+
+void loop() {
+  // The siren preempts the melody, which resumes where it stopped when the siren ends
+  if (digitalRead(ALARM_PIN) == LOW && !alarmSiren.isPlaying) {
+    playSiren(alarmSiren, LOW_C, HIGH_C, LONG_DURATION);
+    addSoundJob(scheduler, alarmSiren, 10);
+  }
+
+  updateSoundScheduler(scheduler);  // Single update for every sound
+}
@@ -0,0 +1,33 @@
+// Smooth frequency sweeps and an RTTTL melody with portamento.
+#include "sound_fun_rtttl.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+SweepState sweepState;
+MelodyState melodyState;
+MelodyControls melodyControls;  // Holds the portamento
+uint8_t step = 0;
+
+void setup() {
+  initSpeaker();
+  // Rising siren-like sweep: equal steps in pitch, retuned every 5 ms
+  playSweep(sweepState, 400, 1600, 1500, SWEEP_EXPONENTIAL);
+  // Each note of the melody glides from the previous one in 60 ms
+  setMelodyControls(melodyState, &melodyControls);
+  setMelodyGlide(melodyState, 60);
+}
+
+void loop() {
+  updateSweep(sweepState);
+  updateMelody(melodyState);
+
+  if (!sweepState.isPlaying && !melodyState.isPlaying) {
+    if (step == 0) {
+      playSweep(sweepState, 2000, 500, 800);  // Falling linear sweep
+    } else if (step == 1) {
+      playRTTTLMelody(melodyState, NOKIA, true);
+    } else {
+      return;
+    }
+    step++;
+  }
+}
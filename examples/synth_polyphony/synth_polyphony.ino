@@ -0,0 +1,42 @@
+// Two voices mixed in software on an ATmega328P (Arduino Uno/Nano): a melody and a beep at the same time.
+// Speaker (with a series resistor or amplifier) on pin 11, the Timer2 PWM output. tone() is not used.
+#include "sound_fun_rtttl.h"
+#include "sound_synth.h"
+#include "rtttl_compiled_melodies.h"
+
+#define SAMPLE_RATE 16000
+
+SynthEngine synth;
+SynthVoiceOutput melodyVoice = { &synth, 0 };
+SynthVoiceOutput beepVoice = { &synth, 1 };
+MelodyState melodyState;
+AlertState beepState;
+
+// Timer1 runs the mixer at SAMPLE_RATE and writes each sample as the Timer2 PWM duty cycle
+ISR(TIMER1_COMPA_vect) {
+  OCR2A = SYNTH_PWM_OFFSET + renderSynthSample(synth);
+}
+
+void setup() {
+  initSynth(synth, SAMPLE_RATE);
+
+  pinMode(11, OUTPUT);
+  TCCR2A = _BV(COM2A1) | _BV(WGM21) | _BV(WGM20);  // Fast PWM on OC2A
+  TCCR2B = _BV(CS20);                              // No prescaler: 62.5 kHz carrier
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);                 // CTC, no prescaler
+  OCR1A = F_CPU / SAMPLE_RATE - 1;
+  TIMSK1 = _BV(OCIE1A);
+
+  playPackedMelody(melodyVoice, melodyState, XFILES_PACKED, true, 3);
+}
+
+void loop() {
+  updateMelody(melodyVoice, melodyState);
+  updateAlert(beepVoice, beepState);
+
+  // A beep every 2 seconds on top of the melody
+  if (!beepState.isPlaying && millis() % 2000 < 10) {
+    playBeep(beepVoice, beepState, 2, HIGH_C, VERY_SHORT_DURATION, 100);
+  }
+}
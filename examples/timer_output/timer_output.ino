@@ -0,0 +1,33 @@
+// A melody and a siren on Timer1 (pin 9 on the Uno/Nano, 11 on the Mega) with precomputed timer settings:
+// each melody note is loaded from the compile-time table and written to the timer registers instead of running tone()'s divisions.
+#include "sound_fun_rtttl.h"
+#include "sound_timer.h"
+#include "rtttl_compiled_melodies.h"
+
+TimerToneOutput timerOutput;
+MelodyState melodyState;
+SirenState sirenState;
+bool sirenPlayed = false;
+
+void setup() {
+  Serial.begin(9600);
+  timerOutput.begin();
+
+  // Melody notes come from TIMER_NOTE_SETTINGS; prepare the two siren tones
+  prepareTimerFrequency(timerOutput, LOW_A);
+  prepareTimerFrequency(timerOutput, HIGH_C);
+  playPackedMelody(timerOutput, melodyState, SUPERMARIO_PACKED, true);
+}
+
+void loop() {
+  updateMelody(timerOutput, melodyState);
+  updateSiren(timerOutput, sirenState);
+
+  // Siren once the melody is over
+  if (!melodyState.isPlaying && !sirenPlayed) {
+    sirenPlayed = true;
+    playSiren(timerOutput, sirenState, LOW_A, HIGH_C, LONG_DURATION);
+    Serial.print(F("Notes computed at run time: "));
+    Serial.println(timerOutput.misses);
+  }
+}
@@ -0,0 +1,40 @@
+// Two buzzers playing different melodies at the same time on an ATmega328P (Arduino Uno/Nano):
+// a panel buzzer on pin 8 and an enclosure buzzer on pin 12. tone() can only sound one pin at a
+// time, so both are GpioSpeaker outputs driven from a Timer1 interrupt.
+#include "sound_fun_rtttl.h"
+#include "sound_speaker.h"
+#include "rtttl_compiled_melodies.h"
+
+#define TICK_RATE 20000
+
+GpioSpeaker<8> panel;
+GpioSpeaker<12> enclosure;
+MelodyState panelMelody;
+AlertState enclosureAlert;
+
+// Timer1 advances both square waves at TICK_RATE
+ISR(TIMER1_COMPA_vect) {
+  panel.tick();
+  enclosure.tick();
+}
+
+void setup() {
+  panel.begin(TICK_RATE);
+  enclosure.begin(TICK_RATE);
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);  // CTC, no prescaler
+  OCR1A = F_CPU / TICK_RATE - 1;
+  TIMSK1 = _BV(OCIE1A);
+
+  playPackedMelody(panel, panelMelody, NOKIA_PACKED, true, 3);
+}
+
+void loop() {
+  // Each output has its own state; the same play and update functions drive both
+  updateMelody(panel, panelMelody);
+  updateAlert(enclosure, enclosureAlert);
+
+  if (!enclosureAlert.isPlaying && millis() % 3000 < 10) {
+    playAlert(enclosure, enclosureAlert, 3, HIGH_C, SHORT_DURATION, 150);
+  }
+}
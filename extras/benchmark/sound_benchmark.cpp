@@ -0,0 +1,1565 @@
+/**
+ * @file sound_benchmark.cpp
+ * @brief Host benchmark suite for the sound functions.
+ * Runs the library on the host backend (fake clock, recording tone sink) and reports:
+ *  - parse throughput over the RTTTL corpus (notes/s and MB/s),
+ *  - pitchFrequency() against the pow()/round() formula it replaced: every note of every octave, and cost per note,
+ *  - cost of each update function per call, idle and over a full playback,
+ *  - note-onset timing error with a simulated busy main loop,
+ *  - main loop wakeups when sleeping until nextDeadline() instead of polling,
+ *  - synthesizer mixing throughput, per sample (interrupt kernel) and per block (SIMD),
+ *  - melody catalog lookup by name (binary search in PROGMEM),
+ *  - chunk-fed RTTTLStream playback against whole-string playback, and its parse throughput,
+ *  - playlist track changes against waiting for the end and calling playRTTTLMelody(),
+ *  - playRTTTLMelody() through the parsed-melody cache: hit rate, cost and heap allocations,
+ *  - two melodies on two Speaker<Pin> outputs, and GpioSpeaker square-wave frequency and tick cost,
+ *  - precomputed Timer1 settings: table generation and timer model checks, and the cost of a note change,
+ *  - fixed-point sweeps against the ideal curves and against playToneSeries(), and portamento between RTTTL notes,
+ *  - table-driven effects: the siren preset against the switching timeline, vibrato depth on a melody, update cost,
+ *  - compact melody images: size against RTTTL text and packed images, playback against packed, decode cost,
+ *  - melody index: position and remaining time, resume after an interruption with seekMelody(), seek cost,
+ *  - live tempo and transposition: note times and pitches from every source, changes at a note boundary, fetch cost,
+ *  - state structure footprint, and playback across millis() wraps of the 16-bit timestamps.
+ * Results are printed as "section.name key=value" lines so runs can be diffed.
+ *
+ * Build and run from the repository root:
+ *   g++ -O2 -std=gnu++11 -Isrc extras/benchmark/sound_benchmark.cpp -o sound_benchmark
+ *   ./sound_benchmark > bench_output.txt
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <new>
+#include <string>
+
+/** @brief The parsed-melody cache is measured in benchCache(). */
+#define RTTTL_CACHE_SLOTS 4
+
+#include "sound_fun_rtttl.h"
+#include "sound_scheduler.h"
+#include "sound_synth.h"
+#include "sound_playlist.h"
+#include "sound_speaker.h"
+#include "sound_timer.h"
+#include "melody_catalog_builtin.h"
+#include "melodies_compact.h"
+#include "rtttl_PROGMEM_melodies.h"
+#include "rtttl_corpus.h"
+
+/** @brief Minimum wall time spent on each measurement (ns). */
+#define BENCH_MIN_TIME_NS 200000000.0
+
+static volatile uint32_t benchSink = 0;
+static uint32_t benchAllocations = 0;
+
+void* operator new[](size_t size) {
+  benchAllocations++;
+  void* ptr = malloc(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete[](void* ptr) noexcept {
+  free(ptr);
+}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t corpusBytes() {
+  size_t bytes = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) bytes += strlen(RTTTL_CORPUS[i]);
+  return bytes;
+}
+
+static void reportParse(const char* name, size_t notes, size_t bytes, double ns) {
+  printf("parse.%s notes_per_s=%.0f mb_per_s=%.2f ns_per_note=%.1f\n", name, notes / ns * 1e9, bytes / ns * 1e3, ns / notes);
+}
+
+/**
+ * Parse throughput: every corpus string is parsed repeatedly with each entry point.
+ */
+static void benchParse() {
+  size_t bytesPerPass = corpusBytes();
+  size_t notes = 0;
+  size_t bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      ToneFrequency* melody = nullptr;
+      ToneDuration* durations = nullptr;
+      size_t length = 0;
+      if (parseRTTTL(RTTTL_CORPUS[i], melody, durations, length)) {
+        benchSink += melody[0];
+        delete[] melody;
+        delete[] durations;
+      }
+      notes += length;
+    }
+    bytes += bytesPerPass;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  reportParse("parseRTTTL", notes, bytes, elapsedNs(start));
+
+  notes = 0;
+  bytes = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      uint16_t* packed = nullptr;
+      if (parseRTTTLPacked(RTTTL_CORPUS[i], packed)) {
+        notes += packed[1];
+        benchSink += packed[PACKED_HEADER_WORDS];
+        delete[] packed;
+      }
+    }
+    bytes += bytesPerPass;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  reportParse("parseRTTTLPacked", notes, bytes, elapsedNs(start));
+
+  notes = 0;
+  bytes = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      RTTTLHeader header;
+      const char* cursor = RTTTL_CORPUS[i];
+      if (!parseRTTTLHeader(cursor, false, header)) continue;
+      ToneFrequency frequency;
+      ToneDuration duration;
+      while (parseRTTTLNote(cursor, false, header, frequency, duration)) {
+        benchSink += frequency;
+        notes++;
+      }
+    }
+    bytes += bytesPerPass;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  reportParse("parseRTTTLNote", notes, bytes, elapsedNs(start));
+}
+
+/** Frequency of a note as computed before the integer pitch engine (PAUSE outside MIN/MAX_FREQUENCY). */
+static ToneFrequency powFrequency(uint8_t noteIndex, uint8_t octave) {
+  uint32_t rawFreq = static_cast<uint32_t>(round(PITCH_TABLE[noteIndex] * pow(2, octave - 4)));
+  return (rawFreq >= MIN_FREQUENCY && rawFreq <= MAX_FREQUENCY) ? static_cast<ToneFrequency>(rawFreq) : PAUSE;
+}
+
+/**
+ * Pitch engine: pitchFrequency() must equal the pow()/round() formula to the hertz for every note of octaves
+ * 0 to MAX_NOTE_OCTAVE; then both are timed over all those notes.
+ */
+static void benchPitch() {
+  const uint8_t noteCount = NOTES_PER_OCTAVE * (MAX_NOTE_OCTAVE + 1);
+  uint32_t mismatches = 0;
+  for (uint8_t k = 0; k < noteCount; k++) {
+    if (pitchFrequency(k % NOTES_PER_OCTAVE, k / NOTES_PER_OCTAVE) != powFrequency(k % NOTES_PER_OCTAVE, k / NOTES_PER_OCTAVE)) mismatches++;
+  }
+  printf("pitch.exact notes=%u octaves=0-%u mismatches=%u\n", static_cast<unsigned>(noteCount), static_cast<unsigned>(MAX_NOTE_OCTAVE),
+         static_cast<unsigned>(mismatches));
+
+  volatile uint8_t firstNote = 0;  // Keeps the compiler from folding the loops
+  uint64_t notes = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (uint8_t k = firstNote; k < noteCount; k++) benchSink += powFrequency(k % NOTES_PER_OCTAVE, k / NOTES_PER_OCTAVE);
+    notes += noteCount;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double powNs = elapsedNs(start) / notes;
+  notes = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    for (uint8_t k = firstNote; k < noteCount; k++) benchSink += pitchFrequency(k % NOTES_PER_OCTAVE, k / NOTES_PER_OCTAVE);
+    notes += noteCount;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double integerNs = elapsedNs(start) / notes;
+  printf("pitch.speed pow_ns_per_note=%.2f integer_ns_per_note=%.2f speedup=%.1f\n", powNs, integerNs, powNs / integerNs);
+}
+
+/**
+ * Update cost. "idle" calls an update function while nothing is due; "run" plays the sound to
+ * completion advancing the clock 1 ms per call, so it includes note transitions.
+ */
+template <typename State, typename Start, typename Update>
+static void benchUpdate(const char* name, Start start, Update update) {
+  static State state;  // Cached melodies refer to the state that plays them
+  state = State();
+  hostSetMillis(0);
+  start(state);
+  const uint32_t idleCalls = 10000000;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < idleCalls; i++) update(state);
+  double idleNs = elapsedNs(t0) / idleCalls;
+
+  uint64_t calls = 0;
+  t0 = std::chrono::steady_clock::now();
+  do {
+    hostSetMillis(0);
+    hostClearToneEvents();
+    start(state);
+    while (state.isPlaying && hostMillis < 600000) {
+      update(state);
+      hostAdvanceMillis(1);
+      calls++;
+    }
+  } while (elapsedNs(t0) < BENCH_MIN_TIME_NS);
+  printf("update.%s idle_ns_per_call=%.2f run_ns_per_call=%.2f\n", name, idleNs, elapsedNs(t0) / calls);
+}
+
+static void benchUpdates() {
+  benchUpdate<ToneState>("updateTone", [](ToneState& s) { playTone(s, MEDIUM_A, LONG_DURATION); }, [](ToneState& s) { updateTone(s); });
+  benchUpdate<AlertState>("updateAlert", [](AlertState& s) { playAlert(s, 5, HIGH_C, SHORT_DURATION, 100); }, [](AlertState& s) { updateAlert(s); });
+  benchUpdate<ToneSeriesState>("updateToneSeries", [](ToneSeriesState& s) { playToneSeries(s, 500, 2000, 50, VERY_SHORT_DURATION); }, [](ToneSeriesState& s) { updateToneSeries(s); });
+  benchUpdate<SirenState>("updateSiren", [](SirenState& s) { playSiren(s, LOW_C, HIGH_C, LONG_DURATION); }, [](SirenState& s) { updateSiren(s); });
+  benchUpdate<SweepState>("updateSweep.linear", [](SweepState& s) { playSweep(s, 500, 2000, 1000); }, [](SweepState& s) { updateSweep(s); });
+  benchUpdate<SweepState>("updateSweep.exponential", [](SweepState& s) { playSweep(s, 500, 2000, 1000, SWEEP_EXPONENTIAL); }, [](SweepState& s) { updateSweep(s); });
+  benchUpdate<MelodyState>("updateMelody.rtttl", [](MelodyState& s) { playRTTTLMelody(s, RTTTL_CORPUS[1]); }, [](MelodyState& s) { updateMelody(s); });
+  benchUpdate<MelodyState>("updateMelody.streaming", [](MelodyState& s) { playRTTTLMelodyStreaming(s, RTTTL_CORPUS[1]); }, [](MelodyState& s) { updateMelody(s); });
+}
+
+/**
+ * Note-onset timing error. Each main loop iteration takes a random 1..maxLoopMs ms. A note starts when
+ * updateMelody() moves the RTTTL cursor; its nominal slot is the note duration (plus MELODY_NOTE_GAP
+ * in relative mode).
+ * onset_error = how far each onset is behind its start on the nominal timeline (sum of the previous slots);
+ * end_drift = how far the end of the melody is behind the nominal length.
+ */
+static void benchTiming(const char* name, MelodyTiming timing, uint32_t maxLoopMs) {
+  double errorSum = 0;
+  int32_t errorMax = 0;
+  size_t onsets = 0;
+  double driftSum = 0;
+  int32_t driftMax = 0;
+  srand(1);
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    MelodyState state = MelodyState();
+    setMelodyTiming(state, timing);
+    hostSetMillis(0);
+    playRTTTLMelodyStreaming(state, RTTTL_CORPUS[i]);
+    uint32_t slotGap = (timing == MELODY_TIMING_ABSOLUTE) ? 0 : MELODY_NOTE_GAP;
+    uint32_t nominal = static_cast<uint16_t>(state.noteDuration) + slotGap;
+    const char* cursor = state.rtttlCursor;
+    while (state.isPlaying) {
+      updateMelody(state);
+      if (state.isPlaying && state.rtttlCursor != cursor) {
+        int32_t error = static_cast<int32_t>(hostMillis - nominal);
+        errorSum += error;
+        if (error > errorMax) errorMax = error;
+        onsets++;
+        nominal += static_cast<uint16_t>(state.noteDuration) + slotGap;
+        cursor = state.rtttlCursor;
+      }
+      if (state.isPlaying) hostAdvanceMillis(1 + rand() % maxLoopMs);
+    }
+    int32_t drift = static_cast<int32_t>(hostMillis - nominal);
+    driftSum += drift;
+    if (drift > driftMax) driftMax = drift;
+  }
+  printf("timing.%s.loop_1_to_%ums mean_onset_error_ms=%.1f max_onset_error_ms=%d mean_end_drift_ms=%.1f max_end_drift_ms=%d\n",
+         name, maxLoopMs, errorSum / onsets, errorMax, driftSum / RTTTL_CORPUS_SIZE, driftMax);
+}
+
+/**
+ * Wakeups. The main loop sleeps until the scheduler deadline, then updates it. Every wakeup should
+ * coincide with a tone event (a note boundary); off_boundary counts the ones that do not.
+ */
+static void benchWakeups() {
+  size_t wakeups = 0;
+  size_t offBoundary = 0;
+  size_t events = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    SoundScheduler scheduler;
+    initSoundScheduler(scheduler);
+    MelodyState state = MelodyState();
+    hostSetMillis(0);
+    hostClearToneEvents();
+    playRTTTLMelodyStreaming(state, RTTTL_CORPUS[i]);
+    addSoundJob(scheduler, state, 1);
+    uint32_t deadline;
+    while (nextDeadline(scheduler, deadline)) {
+      sleepUntil(deadline);
+      size_t before = hostToneEventCount;
+      updateSoundScheduler(scheduler);
+      wakeups++;
+      if (hostToneEventCount == before) offBoundary++;
+    }
+    events += hostToneEventCount;
+  }
+  printf("wakeup.scheduler tone_events=%u wakeups=%u off_boundary=%u\n", static_cast<unsigned>(events), static_cast<unsigned>(wakeups), static_cast<unsigned>(offBoundary));
+}
+
+/**
+ * Synthesizer throughput with every voice playing: renderSynthSample() as called from a timer
+ * interrupt, and renderSynth() on 256-sample blocks.
+ */
+static void benchSynth() {
+  SynthEngine engine;
+  initSynth(engine, 16000);
+  for (uint8_t i = 0; i < SYNTH_MAX_VOICES; i++) setSynthVoice(engine, i, 440 + 110 * i);
+  uint64_t samples = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (int i = 0; i < 4096; i++) benchSink += renderSynthSample(engine);
+    samples += 4096;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double sampleNs = elapsedNs(start) / samples;
+
+  int16_t block[256];
+  samples = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    renderSynth(engine, block, 256);
+    benchSink += block[255];
+    samples += 256;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double blockNs = elapsedNs(start) / samples;
+  printf("synth.voices_%d sample_ns=%.2f block_ns_per_sample=%.3f block_realtime_factor_16khz=%.0f\n",
+         SYNTH_MAX_VOICES, sampleNs, blockNs, 1e9 / 16000 / blockNs);
+}
+
+/**
+ * Catalog lookup: every built-in name, looked up in lower case, plus one missing name per round.
+ */
+static void benchCatalog() {
+  char names[BUILTIN_MELODY_COUNT][MELODY_CATALOG_NAME_SIZE];
+  MelodyCatalogEntry entry;
+  for (size_t i = 0; i < BUILTIN_MELODY_COUNT; i++) {
+    readCatalogEntry(BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, i, entry);
+    for (size_t j = 0; j < MELODY_CATALOG_NAME_SIZE; j++) names[i][j] = tolower(entry.name[j]);
+  }
+  uint64_t lookups = 0;
+  size_t misses = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < BUILTIN_MELODY_COUNT; i++) {
+      if (!findCatalogMelody(BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, names[i], entry)) misses++;
+      benchSink += entry.noteCount;
+    }
+    benchSink += findCatalogMelody(BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, "missing", entry);
+    lookups += BUILTIN_MELODY_COUNT + 1;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  printf("catalog.builtin entries=%u ns_per_lookup=%.1f misses=%u\n", static_cast<unsigned>(BUILTIN_MELODY_COUNT), elapsedNs(start) / lookups,
+         static_cast<unsigned>(misses));
+}
+
+/** Copy of the recorded tone events, with times relative to the first one. */
+static size_t copyToneEvents(HostToneEvent* events) {
+  for (size_t i = 0; i < hostToneEventCount; i++) {
+    events[i] = hostToneEvents[i];
+    events[i].time -= hostToneEvents[0].time;
+  }
+  return hostToneEventCount;
+}
+
+/**
+ * RTTTLStream. Each corpus string is fed 1..8 bytes per ms while it plays, starting once the first note
+ * is decoded; the tone events must match playRTTTLMelodyStreaming() of the whole string (mismatches=0).
+ * Underruns count the waits for a note that had not arrived. Throughput feeds whole strings.
+ */
+static void benchStream() {
+  static HostToneEvent expected[HOST_TONE_EVENT_CAPACITY];
+  size_t mismatches = 0;
+  size_t underruns = 0;
+  srand(1);
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    MelodyState state = MelodyState();
+    hostSetMillis(0);
+    hostClearToneEvents();
+    playRTTTLMelodyStreaming(state, RTTTL_CORPUS[i]);
+    while (state.isPlaying) {
+      updateMelody(state);
+      hostAdvanceMillis(1);
+    }
+    size_t expectedCount = copyToneEvents(expected);
+
+    RTTTLStream stream;
+    initRTTTLStream(stream);
+    state = MelodyState();
+    hostSetMillis(0);
+    hostClearToneEvents();
+    const char* text = RTTTL_CORPUS[i];
+    size_t length = strlen(text) + 1;  // The terminator ends the melody
+    size_t fed = 0;
+    bool started = false;
+    while (!started || state.isPlaying) {
+      fed += feedRTTTLStream(stream, text + fed, std::min<size_t>(1 + rand() % 8, length - fed));
+      if (!started && rtttlStreamAvailable(stream) > 0) {
+        playRTTTLStream(state, stream);
+        started = true;
+      }
+      updateMelody(state);
+      hostAdvanceMillis(1);
+    }
+    underruns += stream.underruns;
+    if (hostToneEventCount != expectedCount) {
+      mismatches++;
+      continue;
+    }
+    for (size_t e = 0; e < expectedCount; e++) {
+      HostToneEvent event = hostToneEvents[e];
+      event.time -= hostToneEvents[0].time;
+      if (event.time != expected[e].time || event.frequency != expected[e].frequency) {
+        mismatches++;
+        break;
+      }
+    }
+  }
+
+  size_t bytes = 0;
+  size_t notes = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      RTTTLStream stream;
+      initRTTTLStream(stream);
+      const char* text = RTTTL_CORPUS[i];
+      size_t length = strlen(text) + 1;
+      size_t fed = 0;
+      ToneFrequency frequency;
+      ToneDuration duration;
+      while (fed < length) {
+        fed += feedRTTTLStream(stream, text + fed, length - fed);
+        while (popRTTTLStreamNote(stream, frequency, duration)) {
+          benchSink += frequency;
+          notes++;
+        }
+      }
+      bytes += length;
+    }
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double ns = elapsedNs(start);
+  printf("stream.chunked melodies=%u mismatches=%u underruns=%u ram_bytes=%u\n", static_cast<unsigned>(RTTTL_CORPUS_SIZE), static_cast<unsigned>(mismatches),
+         static_cast<unsigned>(underruns), static_cast<unsigned>(sizeof(RTTTLStream)));
+  reportParse("RTTTLStream", notes, bytes, ns);
+}
+
+/** Sum of the note durations of an RTTTL string, all notes included (ms). */
+static uint32_t rtttlDuration(const char* rtttl) {
+  RTTTLHeader header;
+  const char* cursor = rtttl;
+  uint32_t total = 0;
+  ToneFrequency frequency;
+  ToneDuration duration;
+  if (!parseRTTTLHeader(cursor, false, header)) return 0;
+  while (parseRTTTLNote(cursor, false, header, frequency, duration)) total += static_cast<uint16_t>(duration);
+  return total;
+}
+
+/**
+ * Playlist. The corpus is played back to back in absolute timing, once with a Playlist and once by waiting
+ * for isPlaying to go false and calling playRTTTLMelody(). gap_ms is the playback time beyond the sum of
+ * the note durations (0 = gapless); swap_ns is the mean wall time of the loop iterations that start a
+ * track (the first track excluded), where the naive loop parses and allocates.
+ */
+static void benchPlaylist() {
+  uint32_t expected = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) expected += rtttlDuration(RTTTL_CORPUS[i]);
+
+  double swapNs = 0;
+  size_t next = 0;
+  static Playlist playlist;
+  setMelodyTiming(playlist.melody, MELODY_TIMING_ABSOLUTE, 0);
+  initPlaylist(playlist);
+  hostSetMillis(0);
+  hostClearToneEvents();
+  do {
+    while (next < RTTTL_CORPUS_SIZE && queueRTTTLTrack(playlist, RTTTL_CORPUS[next])) next++;
+    uint16_t tracks = playlist.tracksPlayed;
+    auto start = std::chrono::steady_clock::now();
+    updatePlaylist(playlist);
+    if (tracks > 0 && playlist.tracksPlayed != tracks) swapNs += elapsedNs(start);
+    hostAdvanceMillis(1);
+  } while (isPlaylistPlaying(playlist));
+  uint32_t playlistTime = hostToneEvents[hostToneEventCount - 1].time;
+  unsigned tracks = playlist.tracksPlayed;
+
+  double naiveSwapNs = 0;
+  next = 0;
+  static MelodyState state;
+  state = MelodyState();
+  setMelodyTiming(state, MELODY_TIMING_ABSOLUTE, 0);
+  hostSetMillis(0);
+  hostClearToneEvents();
+  while (next < RTTTL_CORPUS_SIZE || state.isPlaying) {
+    bool isSwap = !state.isPlaying;
+    auto start = std::chrono::steady_clock::now();
+    if (!state.isPlaying) playRTTTLMelody(state, RTTTL_CORPUS[next++]);
+    updateMelody(state);
+    if (isSwap && next > 1) naiveSwapNs += elapsedNs(start);
+    hostAdvanceMillis(1);
+  }
+  uint32_t naiveTime = hostToneEvents[hostToneEventCount - 1].time;
+
+  printf("playlist.gapless tracks=%u gap_ms=%u swap_ns=%.0f ram_bytes=%u\n", tracks, static_cast<unsigned>(playlistTime - expected), swapNs / (tracks - 1),
+         static_cast<unsigned>(sizeof(Playlist)));
+  printf("playlist.naive tracks=%u gap_ms=%u swap_ns=%.0f\n", static_cast<unsigned>(RTTTL_CORPUS_SIZE), static_cast<unsigned>(naiveTime - expected),
+         naiveSwapNs / (RTTTL_CORPUS_SIZE - 1));
+}
+
+/**
+ * Parsed-melody cache. An alert pattern replays NOKIA and XFILES (PROGMEM) most of the time and a corpus
+ * string now and then, with RTTTL_CACHE_SLOTS slots. hit_ns and miss_ns are the cost of one
+ * playRTTTLMelody() call, uncached_ns the same call without the cache (parseRTTTLPacked(), new[] and
+ * delete[]); allocations counts new[] during hits. Cached replays must sound the same. Then a melody too long for a
+ * slot is looked up repeatedly (no entry may be evicted), and two states play the same string (the second
+ * must get its own copy, and the slot must stay with the first under pressure from other strings).
+ */
+static void benchCache() {
+  static MelodyState state;
+  clearRTTTLCache();
+  srand(2);
+  uint32_t plays = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    int pick = rand() % 10;
+    state = MelodyState();
+    if (pick < 5) playRTTTLMelody(state, NOKIA, true);
+    else if (pick < 9) playRTTTLMelody(state, XFILES, true);
+    else playRTTTLMelody(state, RTTTL_CORPUS[rand() % RTTTL_CORPUS_SIZE]);
+    benchSink += state.noteFrequency;
+    plays++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double mixNs = elapsedNs(start) / plays;
+  uint32_t hits = rtttlCache.hits;
+  uint32_t misses = rtttlCache.misses;
+  uint32_t evictions = rtttlCache.evictions;
+
+  uint32_t calls = 0;
+  uint32_t allocations = benchAllocations;
+  start = std::chrono::steady_clock::now();
+  do {
+    state = MelodyState();
+    playRTTTLMelody(state, NOKIA, true);
+    benchSink += state.noteFrequency;
+    calls++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double hitNs = elapsedNs(start) / calls;
+  double allocationsPerHit = static_cast<double>(benchAllocations - allocations) / calls;
+
+  calls = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    state = MelodyState();
+    forgetRTTTLCache(NOKIA, true);
+    playRTTTLMelody(state, NOKIA, true);
+    benchSink += state.noteFrequency;
+    calls++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double missNs = elapsedNs(start) / calls;
+
+  calls = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    uint16_t* packed = nullptr;
+    state = MelodyState();
+    if (parseRTTTLPacked(NOKIA, packed, true)) {
+      playPackedMelody(state, packed, false);
+      delete[] packed;
+    }
+    benchSink += state.noteFrequency;
+    calls++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double uncachedNs = elapsedNs(start) / calls;
+
+  static HostToneEvent first[HOST_TONE_EVENT_CAPACITY];
+  size_t mismatches = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    size_t count = 0;
+    for (int pass = 0; pass < 2; pass++) {
+      state = MelodyState();
+      if (pass == 0) forgetRTTTLCache(RTTTL_CORPUS[i], false);
+      hostSetMillis(0);
+      hostClearToneEvents();
+      playRTTTLMelody(state, RTTTL_CORPUS[i]);
+      while (state.isPlaying) {
+        updateMelody(state);
+        hostAdvanceMillis(1);
+      }
+      if (pass == 0) {
+        count = copyToneEvents(first);
+      } else if (count != hostToneEventCount || memcmp(first, hostToneEvents, count * sizeof(HostToneEvent)) != 0) {
+        mismatches++;
+      }
+    }
+  }
+
+  // A melody that cannot be cached must not throw out cached ones, and a hit must not take a slot from another
+  // state still playing it (that state would lose the protection of its image)
+  clearRTTTLCache();
+  const char* cached[RTTTL_CACHE_SLOTS];
+  uint8_t cachedCount = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE && cachedCount < RTTTL_CACHE_SLOTS; i++) {
+    if (cacheRTTTLMelody(RTTTL_CORPUS[i], false, nullptr)) cached[cachedCount++] = RTTTL_CORPUS[i];
+  }
+  std::string longMelody = "long:d=16,o=5,b=200:";
+  for (int i = 0; i <= RTTTL_CACHE_SLOT_NOTES; i++) longMelody += "c,";
+  uint32_t evictionsBefore = rtttlCache.evictions;
+  for (int i = 0; i < 10; i++) cacheRTTTLMelody(longMelody.c_str(), false, nullptr);
+  unsigned uncacheableEvictions = static_cast<unsigned>(rtttlCache.evictions - evictionsBefore);
+  unsigned lostEntries = 0;
+  for (uint8_t i = 0; i < cachedCount; i++) {
+    uint32_t hitsBefore = rtttlCache.hits;
+    cacheRTTTLMelody(cached[i], false, nullptr);
+    if (rtttlCache.hits == hitsBefore) lostEntries++;
+  }
+  static MelodyState owner;
+  static MelodyState sharer;
+  owner = MelodyState();
+  sharer = MelodyState();
+  hostSetMillis(0);
+  playRTTTLMelody(owner, NOKIA, true);
+  playRTTTLMelody(sharer, NOKIA, true);
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) cacheRTTTLMelody(RTTTL_CORPUS[i], false, nullptr);  // Pressure on every slot
+  const uint16_t* cachedNokia = cacheRTTTLMelody(NOKIA, true, &owner);
+  unsigned reassigned = (owner.packed == sharer.packed) ? 1 : 0;
+  unsigned unprotected = (cachedNokia && owner.packed == cachedNokia + PACKED_HEADER_WORDS) ? 0 : 1;
+  while (owner.isPlaying || sharer.isPlaying) {  // Also frees the copy of sharer
+    updateMelody(owner);
+    updateMelody(sharer);
+    hostAdvanceMillis(1);
+  }
+  printf("cache.safety uncacheable_evictions=%u lost_entries=%u shared_slots=%u unprotected=%u\n", uncacheableEvictions, lostEntries, reassigned, unprotected);
+
+  printf("cache.alerts slots=%u hit_rate=%.3f evictions=%u ns_per_play=%.0f\n", RTTTL_CACHE_SLOTS, static_cast<double>(hits) / (hits + misses),
+         static_cast<unsigned>(evictions), mixNs);
+  printf("cache.playRTTTLMelody hit_ns=%.0f miss_ns=%.0f uncached_ns=%.0f allocations_per_hit=%.2f mismatches=%u ram_bytes=%u\n", hitNs, missNs,
+         uncachedNs, allocationsPerHit, static_cast<unsigned>(mismatches), static_cast<unsigned>(sizeof(RTTTLCache)));
+}
+
+/** Tone events of one pin, with times relative to the first one. */
+static size_t pinToneEvents(uint8_t pin, HostToneEvent* events) {
+  size_t count = 0;
+  for (size_t i = 0; i < hostToneEventCount; i++) {
+    if (hostToneEvents[i].pin == pin) events[count++] = hostToneEvents[i];
+  }
+  for (size_t i = count; i-- > 0;) events[i].time -= events[0].time;
+  return count;
+}
+
+/**
+ * Speaker outputs. Two corpus melodies play at the same time on Speaker<8> and Speaker<9>, each with its
+ * own state; the events of each pin must match the melody played alone (mismatches=0). GpioSpeaker is
+ * ticked for one second per frequency at 20 kHz; freq_error_hz is the worst gap between the requested
+ * frequency and the counted periods, ns_per_tick the cost of tick() on two playing speakers.
+ */
+static void benchSpeakers() {
+  static HostToneEvent solo[HOST_TONE_EVENT_CAPACITY];
+  static HostToneEvent both[HOST_TONE_EVENT_CAPACITY];
+  Speaker<8> panel;
+  Speaker<9> enclosure;
+  size_t mismatches = 0;
+  for (size_t i = 0; i + 1 < RTTTL_CORPUS_SIZE; i++) {
+    for (uint8_t output = 0; output < 2; output++) {
+      MelodyState state = MelodyState();
+      hostSetMillis(0);
+      hostClearToneEvents();
+      if (output == 0) playRTTTLMelodyStreaming(panel, state, RTTTL_CORPUS[i]);
+      else playRTTTLMelodyStreaming(enclosure, state, RTTTL_CORPUS[i + 1]);
+      while (state.isPlaying) {
+        if (output == 0) updateMelody(panel, state);
+        else updateMelody(enclosure, state);
+        hostAdvanceMillis(1);
+      }
+      size_t soloCount = pinToneEvents(8 + output, solo);
+      MelodyState panelState = MelodyState();
+      MelodyState enclosureState = MelodyState();
+      hostSetMillis(0);
+      hostClearToneEvents();
+      playRTTTLMelodyStreaming(panel, panelState, RTTTL_CORPUS[i]);
+      playRTTTLMelodyStreaming(enclosure, enclosureState, RTTTL_CORPUS[i + 1]);
+      while (panelState.isPlaying || enclosureState.isPlaying) {
+        updateMelody(panel, panelState);
+        updateMelody(enclosure, enclosureState);
+        hostAdvanceMillis(1);
+      }
+      size_t bothCount = pinToneEvents(8 + output, both);
+      if (soloCount != bothCount || memcmp(solo, both, soloCount * sizeof(HostToneEvent)) != 0) mismatches++;
+    }
+  }
+
+  const uint16_t tickRate = 20000;
+  const uint16_t frequencies[] = { 131, 262, 440, 1000, 2093, 4186, 9000 };
+  GpioSpeaker<10> gpio;
+  gpio.begin(tickRate);
+  double worstError = 0;
+  for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+    gpio.play(frequencies[f]);
+    uint32_t rising = 0;
+    for (uint16_t t = 0; t < tickRate; t++) {
+      bool wasHigh = gpio.level;
+      gpio.tick();
+      if (gpio.level && !wasHigh) rising++;
+    }
+    worstError = std::max(worstError, std::fabs(static_cast<double>(rising) - frequencies[f]));
+  }
+  gpio.stop();
+  gpio.tick();
+  bool silent = !gpio.level;
+
+  GpioSpeaker<11> second;
+  second.begin(tickRate);
+  gpio.play(LOW_A);
+  second.play(HIGH_C);
+  uint64_t ticks = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (int t = 0; t < 1000; t++) {
+      gpio.tick();
+      second.tick();
+    }
+    ticks += 2000;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  benchSink += gpio.phase + second.phase;
+
+  printf("speaker.independent outputs=2 melodies=%u mismatches=%u\n", static_cast<unsigned>(RTTTL_CORPUS_SIZE - 1), static_cast<unsigned>(mismatches));
+  printf("speaker.gpio tick_rate=%u freq_error_hz=%.0f silent_after_stop=%d ns_per_tick=%.2f\n", tickRate, worstError, silent, elapsedNs(start) / ticks);
+}
+
+/**
+ * Timer settings. Checks, each reported as a failure count:
+ *  - table: every TIMER_NOTE_SETTINGS entry equals timerSetting() of the note frequency at run time,
+ *  - prescaler: the prescaler is the smallest whose compare value fits 16 bits,
+ *  - reference: 440 Hz at 16 MHz gives OCR1A 18181 with no prescaler, like tone(),
+ *  - model: timerFrequency() of each note is within 0.5% (about 9 cents) of its frequency.
+ * Then the corpus plays on a TimerToneOutput without preparation: notes come with their note number and are
+ * loaded from the table, so misses (settings computed at run time) must be 0, and every tone event must carry
+ * the modeled note frequency. note_table_ns is that table load; prepared_ns and computed_ns are the frequency
+ * paths, finding the setting among TIMER_OUTPUT_SETTINGS prepared ones and computing it (on the host the
+ * divisions are cheap; on AVR each is a software 32-bit division).
+ */
+static void benchTimer() {
+  unsigned tableErrors = 0;
+  unsigned prescalerErrors = 0;
+  unsigned modelErrors = 0;
+  double worstCents = 0;
+  for (uint8_t octave = 0; octave <= PACKED_MAX_OCTAVE; octave++) {
+    for (uint8_t index = 0; index < NOTES_PER_OCTAVE; index++) {
+      uint16_t note = packNote(index + 1, octave, 2, false);
+      uint16_t frequency = packedNoteFrequency(note);
+      TimerSetting fromTable = timerNoteSetting(note);
+      TimerSetting computed = timerSetting(frequency);
+      if (fromTable.top != computed.top || fromTable.clockSelect != computed.clockSelect) tableErrors++;
+      if (frequency == PAUSE) continue;
+      if (computed.clockSelect > 1 && sound_timer_detail::halfPeriod(TIMER_CLOCK, frequency, computed.clockSelect - 1) <= 65536UL) prescalerErrors++;
+      double actual = static_cast<double>(TIMER_CLOCK) / (2.0 * sound_timer_detail::prescaler(computed.clockSelect) * (computed.top + 1.0));
+      double cents = std::fabs(1200.0 * std::log2(actual / frequency));
+      worstCents = std::max(worstCents, cents);
+      if (std::fabs(actual - frequency) > frequency * 0.005) modelErrors++;
+    }
+  }
+  TimerSetting a4 = timerSetting(440, 16000000UL);
+  unsigned referenceErrors = (a4.top != 18181 || a4.clockSelect != 1 || timerFrequency(a4, 16000000UL) != 440) ? 1 : 0;
+  TimerSetting low = timerSetting(MIN_FREQUENCY, 16000000UL);
+  if (low.clockSelect != 2 || timerFrequency(low, 16000000UL) != MIN_FREQUENCY) referenceErrors++;
+  if (timerSetting(PAUSE).clockSelect != 0 || timerFrequency(timerSetting(PAUSE)) != 0) referenceErrors++;
+
+  static TimerToneOutput output;
+  unsigned misses = 0;
+  unsigned eventErrors = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    MelodyState state = MelodyState();
+    output.begin();
+    hostSetMillis(0);
+    hostClearToneEvents();
+    playRTTTLMelody(output, state, RTTTL_CORPUS[i]);  // Not prepared: notes are loaded from TIMER_NOTE_SETTINGS
+    static uint16_t expected[MAX_RTTTL_NOTES];
+    size_t notes = 0;
+    const char* cursor = RTTTL_CORPUS[i];
+    RTTTLHeader header;
+    ToneFrequency frequency;
+    ToneDuration duration;
+    parseRTTTLHeader(cursor, false, header);
+    while (notes < MAX_RTTTL_NOTES && parseRTTTLNote(cursor, false, header, frequency, duration)) {
+      if (frequency != PAUSE) expected[notes++] = frequency;
+    }
+    while (state.isPlaying) {
+      updateMelody(output, state);
+      hostAdvanceMillis(1);
+    }
+    misses += output.misses;
+    size_t played = 0;
+    for (size_t e = 0; e < hostToneEventCount; e++) {
+      if (hostToneEvents[e].frequency == 0) continue;
+      if (played >= notes || hostToneEvents[e].frequency != timerFrequency(timerSetting(expected[played]))) eventErrors++;
+      played++;
+    }
+    if (played != notes) eventErrors++;
+  }
+
+  output.begin();
+  for (uint8_t i = 0; i < TIMER_OUTPUT_SETTINGS; i++) prepareTimerFrequency(output, static_cast<uint16_t>(400 + i * 37));
+  uint32_t calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    uint16_t frequency = static_cast<uint16_t>(400 + (calls % TIMER_OUTPUT_SETTINGS) * 37);
+    benchSink = output.settings[findTimerFrequency(output, frequency)].top;
+    calls++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double preparedNs = elapsedNs(start) / calls;
+  calls = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    uint16_t frequency = static_cast<uint16_t>(400 + (calls % TIMER_OUTPUT_SETTINGS) * 37);
+    benchSink = timerSetting(frequency).top;
+    calls++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double computedNs = elapsedNs(start) / calls;
+  calls = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    uint8_t noteNumber = static_cast<uint8_t>(NOTES_PER_OCTAVE * 3 + calls % (NOTES_PER_OCTAVE * 4));
+    benchSink = timerNoteNumberSetting(noteNumber).top;
+    calls++;
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double tableNs = elapsedNs(start) / calls;
+
+  printf("timer.table notes=%u table_errors=%u prescaler_errors=%u reference_errors=%u model_errors=%u worst_cents=%.2f\n", TIMER_NOTE_COUNT, tableErrors,
+         prescalerErrors, referenceErrors, modelErrors, worstCents);
+  printf("timer.output melodies=%u misses=%u event_errors=%u note_table_ns=%.1f prepared_ns=%.1f computed_ns=%.1f\n", static_cast<unsigned>(RTTTL_CORPUS_SIZE),
+         misses, eventErrors, tableNs, preparedNs, computedNs);
+}
+
+/**
+ * Play a 500 -> 2000 Hz sweep over 1 s and compare each retune with the ideal curve at the same time.
+ * Returns the largest error (Hz on the linear curve, cents on the exponential one) and reports the
+ * number of retunes, the largest frequency jump and when the sweep stopped.
+ */
+static double runSweep(const char* name, SweepCurve curve, uint16_t interval) {
+  static SweepState state;
+  state = SweepState();
+  hostSetMillis(0);
+  hostClearToneEvents();
+  playSweep(state, 500, 2000, 1000, curve, interval);
+  while (state.isPlaying && hostMillis < 2000) {
+    updateSweep(state);
+    hostAdvanceMillis(1);
+  }
+  double worstError = 0;
+  uint16_t maxJump = 0;
+  uint32_t endTime = 0;
+  for (size_t e = 0; e < hostToneEventCount; e++) {
+    const HostToneEvent& event = hostToneEvents[e];
+    if (event.frequency == 0) {
+      endTime = event.time;
+      continue;
+    }
+    double t = static_cast<double>(event.time) / 1000.0;
+    double ideal = (curve == SWEEP_LINEAR) ? 500.0 + 1500.0 * t : 500.0 * std::pow(4.0, t);
+    double error = (curve == SWEEP_LINEAR) ? std::fabs(event.frequency - ideal) : std::fabs(1200.0 * std::log2(event.frequency / ideal));
+    worstError = std::max(worstError, error);
+    if (e > 0 && hostToneEvents[e - 1].frequency != 0) {
+      maxJump = std::max<uint16_t>(maxJump, static_cast<uint16_t>(std::abs(event.frequency - hostToneEvents[e - 1].frequency)));
+    }
+  }
+  printf("sweep.%s interval_ms=%u retunes=%u max_jump_hz=%u end_ms=%u", name, interval, static_cast<unsigned>(hostToneEventCount - 2), maxJump, endTime);
+  return worstError;
+}
+
+/**
+ * Sweeps and glides. The linear and exponential sweeps must follow the ideal curves (within 1 Hz, and within
+ * the few cents of the rounded pitch table) and stop at 1000 ms; the tone series line shows the stepped
+ * alternative over the same range (50 ms per tone). Then every corpus melody plays with a 40 ms portamento:
+ * glide_errors counts retunes outside the interval between the previous and the current note, and notes
+ * that do not settle on their own frequency before they end.
+ */
+static void benchSweep() {
+  double linearError = runSweep("linear", SWEEP_LINEAR, SWEEP_RETUNE_INTERVAL);
+  printf(" max_error_hz=%.2f\n", linearError);
+  double exponentialError = runSweep("exponential", SWEEP_EXPONENTIAL, SWEEP_RETUNE_INTERVAL);
+  printf(" max_error_cents=%.2f\n", exponentialError);
+  double coarseError = runSweep("exponential", SWEEP_EXPONENTIAL, 20);
+  printf(" max_error_cents=%.2f\n", coarseError);
+
+  static ToneSeriesState series;
+  series = ToneSeriesState();
+  hostSetMillis(0);
+  hostClearToneEvents();
+  playToneSeries(series, 500, 2000, 75, VERY_SHORT_DURATION);
+  while (series.isPlaying && hostMillis < 2000) {
+    updateToneSeries(series);
+    hostAdvanceMillis(1);
+  }
+  printf("sweep.toneSeries retunes=%u max_jump_hz=75 end_ms=%u\n", static_cast<unsigned>(hostToneEventCount - 2), hostToneEvents[hostToneEventCount - 1].time);
+
+  static MelodyState state;
+  static MelodyControls controls;
+  unsigned glideErrors = 0;
+  unsigned glides = 0;
+  size_t retunes = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    state = MelodyState();
+    controls = MelodyControls();
+    setMelodyControls(state, &controls);
+    setMelodyGlide(state, 40);
+    hostSetMillis(0);
+    hostClearToneEvents();
+    playRTTTLMelody(state, RTTTL_CORPUS[i]);
+    uint16_t previous = PAUSE;
+    uint16_t target = static_cast<uint16_t>(state.noteFrequency);
+    size_t note = state.currentNote;
+    size_t firstEvent = 0;
+    while (state.isPlaying) {
+      updateMelody(state);
+      if (state.isPlaying && state.currentNote != note) {
+        // The note that just ended must have settled on its frequency; check the retunes of its glide
+        if (hostToneEvents[hostToneEventCount - 2].frequency != target) glideErrors++;
+        for (size_t e = firstEvent; e + 1 < hostToneEventCount; e++) {
+          uint16_t frequency = hostToneEvents[e].frequency;
+          if (frequency == target || frequency == PAUSE) continue;
+          retunes++;
+          if (previous == PAUSE || frequency < std::min(previous, target) || frequency > std::max(previous, target)) glideErrors++;
+        }
+        glides += (previous != PAUSE && target != PAUSE && previous != target) ? 1 : 0;
+        previous = target;
+        target = static_cast<uint16_t>(state.noteFrequency);
+        note = state.currentNote;
+        firstEvent = hostToneEventCount - 1;
+      }
+      hostAdvanceMillis(1);
+    }
+  }
+  printf("sweep.glide melodies=%u glides=%u retunes=%u glide_errors=%u\n", static_cast<unsigned>(RTTTL_CORPUS_SIZE), glides, static_cast<unsigned>(retunes), glideErrors);
+}
+
+/**
+ * Effects engine. The siren (now the EFFECT_SIREN preset) must switch exactly every duration / 10 ms between
+ * its two frequencies and stop at duration. Then a corpus melody plays through an EffectOutput with each preset:
+ * every retune must stay within the depth of the preset around the current note (max_cents, checked against
+ * the preset depth), and retunes counts the frequency changes made by updateEffect(). ns_per_update is the
+ * cost of updateEffect() over the vibrato melody, due or not.
+ */
+static void benchEffects() {
+  static SirenState siren;
+  siren = SirenState();
+  hostSetMillis(0);
+  hostClearToneEvents();
+  playSiren(siren, LOW_C, HIGH_C, LONG_DURATION);
+  while (siren.isPlaying) {
+    updateSiren(siren);
+    hostAdvanceMillis(1);
+  }
+  unsigned sirenErrors = (hostToneEventCount != 11) ? 1 : 0;
+  for (size_t e = 0; e < hostToneEventCount && e < 11; e++) {
+    uint16_t expected = (e == 10) ? 0 : (e % 2 ? HIGH_C : LOW_C);
+    if (hostToneEvents[e].time != e * 100 || hostToneEvents[e].frequency != expected) sirenErrors++;
+  }
+  printf("effect.siren events=%u errors=%u\n", static_cast<unsigned>(hostToneEventCount), sirenErrors);
+
+  struct Preset {
+    const char* name;
+    const SoundEffect* effect;
+  };
+  static const Preset presets[] = { { "vibrato", &EFFECT_VIBRATO }, { "lfo", &EFFECT_LFO }, { "trill", &EFFECT_TRILL }, { "warble", &EFFECT_WARBLE }, { "chirp", &EFFECT_CHIRP } };
+  static MelodyState state;
+  static EffectOutput<> voice;
+  for (const Preset& preset : presets) {
+    state = MelodyState();
+    voice = EffectOutput<>();
+    hostSetMillis(0);
+    hostClearToneEvents();
+    startEffect(voice.effect, preset.effect);
+    playRTTTLMelody(voice, state, RTTTL_CORPUS[1]);
+    uint32_t updates = 0;
+    double updateNs = 0;
+    double maxCents = 0;
+    unsigned retunes = 0;
+    unsigned depthErrors = 0;
+    SoundEffect effect;
+    memcpy_P(&effect, preset.effect, sizeof(effect));
+    while (state.isPlaying) {
+      updateMelody(voice, state);
+      size_t before = hostToneEventCount;
+      auto start = std::chrono::steady_clock::now();
+      updateEffect(voice);
+      updateNs += elapsedNs(start);
+      updates++;
+      if (hostToneEventCount > before && voice.effect.baseFrequency != PAUSE) {
+        retunes++;
+        double base = voice.effect.baseFrequency;
+        double cents = std::fabs(1200.0 * std::log2(hostToneEvents[hostToneEventCount - 1].frequency / base));
+        double limit = std::fabs(1200.0 * std::log2(1.0 - effect.depth / 1000.0)) + 2.0;
+        maxCents = std::max(maxCents, cents);
+        if (cents > limit) depthErrors++;
+      }
+      hostAdvanceMillis(1);
+    }
+    printf("effect.%s retunes=%u max_cents=%.1f depth_errors=%u ns_per_update=%.1f\n", preset.name, retunes, maxCents, depthErrors, updateNs / updates);
+  }
+  printf("effect.size sound_effect_bytes=%u effect_state_bytes=%u siren_state_bytes=%u\n", static_cast<unsigned>(sizeof(SoundEffect)),
+         static_cast<unsigned>(sizeof(EffectState)), static_cast<unsigned>(sizeof(SirenState)));
+}
+
+/** Play a melody started by start() with two repeats to the end and keep its tone events (times relative to the first). */
+template <typename Start>
+static size_t playToEnd(HostToneEvent* events, Start start) {
+  static MelodyState state;
+  state = MelodyState();
+  hostSetMillis(0);
+  hostClearToneEvents();
+  start(state);
+  while (state.isPlaying) {
+    updateMelody(state);
+    hostAdvanceMillis(1);
+  }
+  return copyToneEvents(events);
+}
+
+/** True if two recordings hold the same tone events. */
+static bool sameToneEvents(const HostToneEvent* a, size_t aCount, const HostToneEvent* b, size_t bCount) {
+  if (aCount != bCount) return false;
+  for (size_t e = 0; e < aCount; e++) {
+    if (a[e].time != b[e].time || a[e].pin != b[e].pin || a[e].frequency != b[e].frequency) return false;
+  }
+  return true;
+}
+
+/**
+ * Compact images. Every corpus string is packed with packRTTTL() and converted with compactMelody(); both images
+ * are played twice through and their tone events must match (mismatches=0). Sizes are summed over the corpus:
+ * text (RTTTL string), packed and compact bytes. The shipped melodies_compact.h images must play like their packed
+ * tables. Decode cost is per note, frequency and duration included, against reading a packed word.
+ */
+static void benchCompact() {
+  static HostToneEvent expected[HOST_TONE_EVENT_CAPACITY];
+  static HostToneEvent actual[HOST_TONE_EVENT_CAPACITY];
+  static uint16_t packed[RTTTL_CORPUS_SIZE][PACKED_HEADER_WORDS + MAX_RTTTL_NOTES];
+  static uint8_t compact[RTTTL_CORPUS_SIZE][COMPACT_HEADER_BYTES + MAX_RTTTL_NOTES * 2];
+  size_t textBytes = 0;
+  size_t packedBytes = 0;
+  size_t compactBytes = 0;
+  unsigned failures = 0;
+  unsigned mismatches = 0;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    size_t size = 0;
+    if (!packRTTTL(RTTTL_CORPUS[i], packed[i], MAX_RTTTL_NOTES) || (size = compactMelody(packed[i], compact[i], sizeof(compact[i]))) == 0) {
+      failures++;
+      continue;
+    }
+    textBytes += strlen(RTTTL_CORPUS[i]) + 1;
+    packedBytes += (PACKED_HEADER_WORDS + packed[i][1]) * sizeof(uint16_t);
+    compactBytes += size;
+    size_t expectedCount = playToEnd(expected, [&](MelodyState& state) { playPackedMelody(state, packed[i], false, 2); });
+    size_t actualCount = playToEnd(actual, [&](MelodyState& state) { playCompactMelody(state, compact[i], false, 2); });
+    if (!sameToneEvents(actual, actualCount, expected, expectedCount)) mismatches++;
+  }
+
+  struct Builtin {
+    const uint16_t* packed;
+    const uint8_t* compact;
+  };
+  static const Builtin builtins[] = { { TWINKLE_PACKED.words, TWINKLE_COMPACT }, { FLIGHT_OF_THE_BUMBLEBEE_PACKED.words, FLIGHT_OF_THE_BUMBLEBEE_COMPACT },
+                                      { R2D2_PACKED.words, R2D2_COMPACT }, { NOKIA_PACKED.words, NOKIA_COMPACT }, { XFILES_PACKED.words, XFILES_COMPACT },
+                                      { MISSION_PACKED.words, MISSION_COMPACT }, { SIMPSONS_PACKED.words, SIMPSONS_COMPACT },
+                                      { GADGET_PACKED.words, GADGET_COMPACT }, { CANON_PACKED.words, CANON_COMPACT },
+                                      { SUPERMARIO_PACKED.words, SUPERMARIO_COMPACT } };
+  unsigned builtinMismatches = 0;
+  size_t builtinPacked = 0;
+  size_t builtinCompact = 0;
+  for (const Builtin& builtin : builtins) {
+    builtinPacked += (PACKED_HEADER_WORDS + pgm_read_word(builtin.packed + 1)) * sizeof(uint16_t);
+    builtinCompact += compactMelody(builtin.packed, nullptr, 0, true);
+    size_t expectedCount = playToEnd(expected, [&](MelodyState& state) { playPackedMelody(state, builtin.packed, true, 2); });
+    size_t actualCount = playToEnd(actual, [&](MelodyState& state) { playCompactMelody(state, builtin.compact, true, 2); });
+    if (!sameToneEvents(actual, actualCount, expected, expectedCount)) builtinMismatches++;
+  }
+
+  uint32_t notes = 0;
+  auto start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      CompactCursor cursor;
+      uint16_t note;
+      startCompactCursor(compact[i], false, cursor);
+      for (uint16_t n = 0; n < packed[i][1] && readCompactNote(compact[i], false, cursor, note); n++) {
+        benchSink = packedNoteFrequency(note) + packedNoteDuration(note, packed[i][0]);
+        notes++;
+      }
+    }
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double compactNs = elapsedNs(start) / notes;
+  notes = 0;
+  start = std::chrono::steady_clock::now();
+  do {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      for (uint16_t n = 0; n < packed[i][1]; n++) {
+        uint16_t note = readPackedWord(packed[i] + PACKED_HEADER_WORDS + n, false);
+        benchSink = packedNoteFrequency(note) + packedNoteDuration(note, packed[i][0]);
+        notes++;
+      }
+    }
+  } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+  double packedNs = elapsedNs(start) / notes;
+
+  printf("compact.corpus melodies=%u failures=%u mismatches=%u text_bytes=%u packed_bytes=%u compact_bytes=%u text_ratio=%.2f packed_ratio=%.2f\n",
+         static_cast<unsigned>(RTTTL_CORPUS_SIZE), failures, mismatches, static_cast<unsigned>(textBytes), static_cast<unsigned>(packedBytes),
+         static_cast<unsigned>(compactBytes), static_cast<double>(textBytes) / compactBytes, static_cast<double>(packedBytes) / compactBytes);
+  printf("compact.builtin melodies=%u mismatches=%u packed_bytes=%u compact_bytes=%u\n", static_cast<unsigned>(sizeof(builtins) / sizeof(builtins[0])),
+         builtinMismatches, static_cast<unsigned>(builtinPacked), static_cast<unsigned>(builtinCompact));
+  printf("compact.decode ns_per_note=%.1f packed_ns_per_note=%.1f\n", compactNs, packedNs);
+}
+
+/** Start corpus melody i from one of the seekable sources: 0 parsed (packed), 1 streamed RTTTL, 2 compact. */
+static void startSeekMelody(MelodyState& state, size_t i, int source, uint8_t repeats) {
+  static uint16_t packed[PACKED_HEADER_WORDS + MAX_RTTTL_NOTES];
+  static uint8_t compact[COMPACT_HEADER_BYTES + MAX_RTTTL_NOTES * 2];
+  if (source == 0) {
+    playRTTTLMelody(state, RTTTL_CORPUS[i], false, repeats);
+  } else if (source == 1) {
+    playRTTTLMelodyStreaming(state, RTTTL_CORPUS[i], false, repeats);
+  } else {
+    packRTTTL(RTTTL_CORPUS[i], packed, MAX_RTTTL_NOTES);
+    compactMelody(packed, compact, sizeof(compact));
+    playCompactMelody(state, compact, false, repeats);
+  }
+}
+
+/**
+ * Melody index. Every corpus melody is played from each seekable source, in both timing modes, with two repeats.
+ * length_errors: the index length differs from the real end of the melody. position_errors: melodyElapsed() is not
+ * the time since the start, or elapsed + remaining is not the total. Then each melody is interrupted at a random time:
+ * the position is saved, a beep plays on the same speaker, the melody is restarted and sought back to the position;
+ * the tone events after the interruption must be the uninterrupted ones, shifted (resume_errors=0). The compile-time
+ * index of SUPERMARIO_PACKED must equal the one built at run time. Costs are per seek to a random position.
+ */
+static void benchSeek() {
+  static HostToneEvent expected[HOST_TONE_EVENT_CAPACITY];
+  static uint32_t starts[MAX_RTTTL_NOTES + 1];
+  static MelodyState state;
+  static AlertState beep;
+  unsigned lengthErrors = 0;
+  unsigned positionErrors = 0;
+  unsigned resumeErrors = 0;
+  unsigned runs = 0;
+  srand(7);
+  for (int source = 0; source < 3; source++) {
+    for (int timing = 0; timing < 2; timing++) {
+      for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+        runs++;
+        MelodyIndex index;
+        state = MelodyState();
+        setMelodyTiming(state, timing ? MELODY_TIMING_ABSOLUTE : MELODY_TIMING_RELATIVE, 0);
+        hostSetMillis(0);
+        hostClearToneEvents();
+        startSeekMelody(state, i, source, 2);
+        if (!buildMelodyIndex(state, starts, MAX_RTTTL_NOTES + 1, index)) {
+          lengthErrors++;
+          continue;
+        }
+        uint32_t total = 2 * melodyPassLength(state, index);
+        while (state.isPlaying) {
+          uint32_t now = hostMillis;
+          if (melodyElapsed(state, index) != now || melodyElapsed(state, index) + melodyRemaining(state, index) != total) positionErrors++;
+          updateMelody(state);
+          hostAdvanceMillis(1);
+        }
+        size_t expectedCount = copyToneEvents(expected);
+        if (expected[expectedCount - 1].time != total) lengthErrors++;
+
+        // Interrupt during the second pass, beep, then restart and seek back
+        uint32_t interruptTime = total / 2 + rand() % (total / 2);
+        state = MelodyState();
+        setMelodyTiming(state, timing ? MELODY_TIMING_ABSOLUTE : MELODY_TIMING_RELATIVE, 0);
+        hostSetMillis(0);
+        hostClearToneEvents();
+        startSeekMelody(state, i, source, 2);
+        while (hostMillis < interruptTime) {
+          updateMelody(state);
+          hostAdvanceMillis(1);
+        }
+        uint8_t repeat = state.currentRepeat;
+        uint32_t position = melodyPosition(state, index);
+        size_t before = hostToneEventCount;
+        playBeep(beep, 2, MEDIUM_A, VERY_SHORT_DURATION, 50);
+        while (beep.isPlaying) {
+          updateAlert(beep);
+          hostAdvanceMillis(1);
+        }
+        uint32_t resumeTime = hostMillis;
+        startSeekMelody(state, i, source, 2);
+        state.currentRepeat = repeat;
+        hostToneEventCount = before;  // Keep the melody events only
+        seekMelody(state, index, position);
+        while (state.isPlaying) {
+          updateMelody(state);
+          hostAdvanceMillis(1);
+        }
+        // First event: the note playing at the interruption; then the same events, shifted
+        size_t e = 0;
+        while (e + 1 < expectedCount && expected[e + 1].time <= interruptTime) e++;
+        bool ok = hostToneEventCount > before && hostToneEvents[before].time == resumeTime && hostToneEvents[before].frequency == expected[e].frequency;
+        for (size_t k = before + 1; ok && k < hostToneEventCount; k++) {
+          e++;
+          ok = e < expectedCount && hostToneEvents[k].time - resumeTime == expected[e].time - interruptTime && hostToneEvents[k].frequency == expected[e].frequency;
+        }
+        if (!ok || e + 1 != expectedCount) resumeErrors++;
+      }
+    }
+  }
+
+  static PROGMEM_MELODY_INDEX(marioIndex, SUPERMARIO_PACKED);
+  state = MelodyState();
+  playPackedMelody(state, SUPERMARIO_PACKED, true);
+  MelodyIndex built;
+  MelodyIndex compiled = melodyIndex(marioIndex, true);
+  unsigned compiledErrors = buildMelodyIndex(state, starts, MAX_RTTTL_NOTES + 1, built) ? 0 : 1;
+  for (size_t n = 0; compiledErrors == 0 && n <= compiled.count; n++) {
+    if (built.count != compiled.count || melodyNoteStart(state, built, n) != melodyNoteStart(state, compiled, n)) compiledErrors++;
+  }
+
+  double seekNs[3];
+  for (int source = 0; source < 3; source++) {
+    MelodyIndex index;
+    state = MelodyState();
+    hostSetMillis(0);
+    startSeekMelody(state, 9, source, 1);
+    buildMelodyIndex(state, starts, MAX_RTTTL_NOTES + 1, index);
+    uint32_t length = melodyPassLength(state, index);
+    uint32_t seeks = 0;
+    auto start = std::chrono::steady_clock::now();
+    do {
+      seekMelody(state, index, (seeks * 7919UL) % length);
+      seeks++;
+    } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+    seekNs[source] = elapsedNs(start) / seeks;
+  }
+  printf("seek.index runs=%u length_errors=%u position_errors=%u resume_errors=%u compiled_errors=%u\n", runs, lengthErrors, positionErrors,
+         resumeErrors, compiledErrors);
+  printf("seek.cost notes=%u packed_ns=%.1f rtttl_ns=%.1f compact_ns=%.1f\n", static_cast<unsigned>(state.length), seekNs[0], seekNs[1], seekNs[2]);
+}
+
+/**
+ * Tempo and transposition. Every corpus melody is played from each source (0 parsed, 1 streamed RTTTL, 2 compact,
+ * 3 frequency arrays) in MELODY_TIMING_ABSOLUTE mode without articulation gap, at several tempos and transpositions.
+ * Each note must last its written duration * 100 / tempo within 1 ms (end_drift is how far the end of the melody is
+ * from the exact scaled length), and sound the transposed note (note sources) or transposeFrequency() of the written
+ * frequency (arrays). max_cents compares both transposition paths with the exact ratio 2^(semitones/12) over every
+ * note of the pitch engine landing between C3 and MAX_FREQUENCY / 2 (lower notes are whole hertz apart). A change made
+ * in the middle of a note must leave that note alone and apply from the next one (boundary_errors=0).
+ * Notes longer than the 16-bit note timestamp (a whole note at b=3, or b=30 played at 10%, in both timing modes, and a
+ * 65535 ms array note) are clamped to MELODY_MAX_NOTE_DURATION: polled every 20 ms, each must end once (hangs=0) with
+ * its second note starting within one poll of the clamped length (length_errors=0).
+ * Fetch cost is per loadMelodyNote() of a packed melody, as written and with tempo and transposition set.
+ */
+static void benchTempo() {
+  static MelodyState state;
+  static MelodyControls controls;
+  struct Setting {
+    uint16_t tempo;
+    int8_t transpose;
+  };
+  static const Setting settings[] = { { 200, 0 }, { 50, 12 }, { 150, -5 }, { 333, 7 }, { 75, -24 } };
+  unsigned runs = 0;
+  unsigned countErrors = 0;
+  unsigned pitchErrors = 0;
+  double maxNoteError = 0;
+  double maxEndDrift = 0;
+  for (int source = 0; source < 4; source++) {
+    for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+      ToneFrequency* melody = nullptr;
+      ToneDuration* durations = nullptr;
+      size_t length = 0;
+      if (!parseRTTTL(RTTTL_CORPUS[i], melody, durations, length)) continue;
+      for (const Setting& setting : settings) {
+        runs++;
+        state = MelodyState();
+        controls = MelodyControls();
+        setMelodyControls(state, &controls);
+        setMelodyTiming(state, MELODY_TIMING_ABSOLUTE, 0);
+        setMelodyTempo(state, setting.tempo);
+        setMelodyTranspose(state, setting.transpose);
+        hostSetMillis(0);
+        hostClearToneEvents();
+        if (source < 3) {
+          startSeekMelody(state, i, source, 1);
+        } else {
+          playMelody(state, melody, durations, length);
+        }
+        while (state.isPlaying) {
+          updateMelody(state);
+          hostAdvanceMillis(1);
+        }
+        // One event per note (tone() or noTone() for a rest), then the final noTone()
+        if (hostToneEventCount != length + 1) {
+          countErrors++;
+          continue;
+        }
+        double ideal = 0;
+        for (size_t n = 0; n < length; n++) {
+          double scaled = static_cast<uint16_t>(durations[n]) * 100.0 / setting.tempo;
+          maxNoteError = std::max(maxNoteError, fabs(hostToneEvents[n + 1].time - hostToneEvents[n].time - scaled));
+          uint16_t written = static_cast<uint16_t>(melody[n]);
+          uint16_t expected = written;
+          uint8_t noteIndex;
+          uint8_t octave;
+          if (source == 3) {
+            expected = transposeFrequency(written, setting.transpose);
+          } else if (frequencyToNote(written, noteIndex, octave)) {
+            expected = transposedNoteFrequency(noteIndex, octave, setting.transpose);
+          }
+          if (hostToneEvents[n].frequency != expected) pitchErrors++;
+          ideal += scaled;
+        }
+        maxEndDrift = std::max(maxEndDrift, fabs(hostToneEvents[length].time - ideal));
+      }
+      delete[] melody;
+      delete[] durations;
+    }
+  }
+
+  double noteCents = 0;
+  double frequencyCents = 0;
+  for (int semitones = -24; semitones <= 24; semitones++) {
+    for (uint8_t note = NOTES_PER_OCTAVE - 1; note < (MAX_NOTE_OCTAVE + 1) * NOTES_PER_OCTAVE; note++) {
+      uint16_t frequency = pitchFrequency(note % NOTES_PER_OCTAVE, note / NOTES_PER_OCTAVE);
+      double exact = frequency * pow(2.0, semitones / 12.0);
+      if (exact < 130.8 || exact > MAX_FREQUENCY / 2) continue;
+      uint16_t byNote = transposedNoteFrequency(note % NOTES_PER_OCTAVE, note / NOTES_PER_OCTAVE, semitones);
+      uint16_t byFrequency = transposeFrequency(frequency, semitones);
+      noteCents = std::max(noteCents, fabs(1200.0 * log2(byNote / exact)));
+      frequencyCents = std::max(frequencyCents, fabs(1200.0 * log2(byFrequency / exact)));
+    }
+  }
+
+  // Change tempo and key in the middle of note 4 of SUPERMARIO: note 4 keeps its end, note 5 is changed
+  unsigned boundaryErrors = 0;
+  for (int source = 0; source < 3; source++) {
+    state = MelodyState();
+    controls = MelodyControls();
+    setMelodyControls(state, &controls);
+    setMelodyTiming(state, MELODY_TIMING_ABSOLUTE, 0);
+    hostSetMillis(0);
+    hostClearToneEvents();
+    startSeekMelody(state, 9, source, 1);
+    while (state.currentNote < 4) {
+      updateMelody(state);
+      hostAdvanceMillis(1);
+    }
+    uint32_t noteStart = hostMillis - 1;
+    uint16_t noteLength = static_cast<uint16_t>(state.noteDuration);
+    hostAdvanceMillis(noteLength / 2);
+    updateMelody(state);
+    setMelodyTempo(state, 200);
+    setMelodyTranspose(state, 12);
+    size_t before = hostToneEventCount;
+    while (state.currentNote < 6) {
+      updateMelody(state);
+      hostAdvanceMillis(1);
+    }
+    MelodyState reader = MelodyState();
+    startSeekMelody(reader, 9, source, 1);
+    while (reader.currentNote < 5) {
+      reader.currentNote++;
+      loadMelodyNote(reader);
+    }
+    uint16_t nextFrequency = PAUSE;
+    uint8_t noteIndex;
+    uint8_t octave;
+    if (frequencyToNote(static_cast<uint16_t>(reader.noteFrequency), noteIndex, octave)) nextFrequency = transposedNoteFrequency(noteIndex, octave, 12);
+    bool ok = hostToneEventCount >= before + 2 && hostToneEvents[before].time == noteStart + noteLength && hostToneEvents[before].frequency == nextFrequency
+              && hostToneEvents[before + 1].time - hostToneEvents[before].time == static_cast<uint32_t>((reader.noteDuration + 1) / 2);
+    if (!ok) boundaryErrors++;
+  }
+
+  struct LongNote {
+    const char* rtttl;
+    uint16_t tempo;
+    MelodyTiming timing;
+  };
+  static const LongNote longNotes[] = { { "x:d=1,o=5,b=3:c,d", 100, MELODY_TIMING_RELATIVE },
+                                        { "x:d=1,o=5,b=3:c,d", 100, MELODY_TIMING_ABSOLUTE },
+                                        { "x:d=1,o=5,b=30:c,d", 10, MELODY_TIMING_RELATIVE },
+                                        { "x:d=1,o=5,b=30:c,d", 10, MELODY_TIMING_ABSOLUTE },
+                                        { nullptr, 100, MELODY_TIMING_RELATIVE } };
+  static ToneFrequency longMelody[] = { LOW_C, LOW_D };
+  static ToneDuration longDurations[] = { static_cast<ToneDuration>(65535), static_cast<ToneDuration>(65535) };
+  const uint32_t longPoll = 20;
+  unsigned hangs = 0;
+  unsigned lengthErrors = 0;
+  for (const LongNote& test : longNotes) {
+    state = MelodyState();
+    controls = MelodyControls();
+    setMelodyControls(state, &controls);
+    setMelodyTiming(state, test.timing, 0);
+    setMelodyTempo(state, test.tempo);
+    hostSetMillis(0);
+    hostClearToneEvents();
+    if (test.rtttl) {
+      playRTTTLMelodyStreaming(state, test.rtttl);
+    } else {
+      playMelody(state, longMelody, longDurations, 2);
+    }
+    while (state.isPlaying && hostMillis < 400000UL) {
+      hostAdvanceMillis(longPoll);
+      updateMelody(state);
+    }
+    if (state.isPlaying || hostToneEventCount != 3) {
+      hangs++;
+      continue;
+    }
+    uint32_t expected = MELODY_MAX_NOTE_DURATION + (test.timing == MELODY_TIMING_ABSOLUTE ? 0 : MELODY_NOTE_GAP);
+    uint32_t length = hostToneEvents[1].time - hostToneEvents[0].time;
+    if (length < expected || length >= expected + longPoll) lengthErrors++;
+  }
+
+  double fetchNs[2];
+  for (int set = 0; set < 2; set++) {
+    state = MelodyState();
+    controls = MelodyControls();
+    setMelodyControls(state, &controls);
+    setMelodyTempo(state, set ? 150 : 100);
+    setMelodyTranspose(state, set ? -5 : 0);
+    playPackedMelody(state, SUPERMARIO_PACKED, true);
+    uint32_t notes = 0;
+    auto start = std::chrono::steady_clock::now();
+    do {
+      for (state.currentNote = 0; loadMelodyNote(state); state.currentNote++) {
+        benchSink = static_cast<uint16_t>(state.noteFrequency) + static_cast<uint16_t>(state.noteDuration);
+        notes++;
+      }
+    } while (elapsedNs(start) < BENCH_MIN_TIME_NS);
+    fetchNs[set] = elapsedNs(start) / notes;
+  }
+  printf("tempo.scale runs=%u count_errors=%u pitch_errors=%u max_note_error_ms=%.2f max_end_drift_ms=%.1f\n", runs, countErrors, pitchErrors, maxNoteError,
+         maxEndDrift);
+  printf("tempo.transpose semitones=-24..24 note_max_cents=%.2f frequency_max_cents=%.2f\n", noteCents, frequencyCents);
+  printf("tempo.change sources=3 boundary_errors=%u\n", boundaryErrors);
+  printf("tempo.long melodies=%u hangs=%u length_errors=%u\n", static_cast<unsigned>(sizeof(longNotes) / sizeof(longNotes[0])), hangs, lengthErrors);
+  printf("tempo.fetch written_ns=%.1f scaled_ns=%.1f\n", fetchNs[0], fetchNs[1]);
+}
+
+/** Print the size of a state structure on this host. */
+static void reportFootprint(const char* name, size_t bytes) {
+  printf("footprint.%s bytes=%u\n", name, static_cast<unsigned>(bytes));
+}
+
+/**
+ * Play a sound started by start() at startTime under a scheduler, to its end, and keep its tone events (times relative
+ * to the first). The loop sleeps until each deadline, or polls every 1..7 ms (same sequence for every start time).
+ */
+template <typename State, typename Start>
+static size_t playScheduledFrom(HostToneEvent* events, uint32_t startTime, bool isPolled, Start start) {
+  State state = State();
+  SoundScheduler scheduler;
+  initSoundScheduler(scheduler);
+  hostSetMillis(startTime);
+  hostClearToneEvents();
+  srand(7);
+  start(state);
+  addSoundJob(scheduler, state, 1);
+  uint32_t deadline;
+  while (nextDeadline(scheduler, deadline)) {
+    if (isPolled) hostAdvanceMillis(1 + rand() % 7);
+    else sleepUntil(deadline);
+    updateSoundScheduler(scheduler);
+  }
+  return copyToneEvents(events);
+}
+
+/** Count the start times at which a sound does not play like it does from millis() = 0 (both loop styles). */
+template <typename State, typename Start>
+static unsigned wrapMismatches(Start start) {
+  static HostToneEvent expected[HOST_TONE_EVENT_CAPACITY];
+  static HostToneEvent actual[HOST_TONE_EVENT_CAPACITY];
+  static const uint32_t startTimes[] = { 65536 - 1, 65536 - 700, 3 * 65536 - 123, 0xFFFFFFFF - 1500, 0xFFFF0000 + 30000 };
+  unsigned mismatches = 0;
+  for (int polled = 0; polled < 2; polled++) {
+    size_t expectedCount = playScheduledFrom<State>(expected, 0, polled != 0, start);
+    for (uint32_t startTime : startTimes) {
+      size_t actualCount = playScheduledFrom<State>(actual, startTime, polled != 0, start);
+      if (!sameToneEvents(expected, expectedCount, actual, actualCount)) mismatches++;
+    }
+  }
+  return mismatches;
+}
+
+/**
+ * State footprint. Sizes of the state structures and of one scheduler job on this host (the budgets of every target
+ * are checked at compile time). Timestamps are the low 16 bits of millis(): every kind of sound, and every melody
+ * source in both timing modes (with a portamento), must play the same when started just before a 16-bit or 32-bit
+ * millis() wrap (wrap_mismatches=0). A tone frozen for 70 s by an alert must stop on time after it resumes
+ * (freeze_stop_error_ms=0).
+ */
+static void benchFootprint() {
+  static MelodyControls controls;
+  reportFootprint("ToneState", sizeof(ToneState));
+  reportFootprint("AlertState", sizeof(AlertState));
+  reportFootprint("ToneSeriesState", sizeof(ToneSeriesState));
+  reportFootprint("SweepState", sizeof(SweepState));
+  reportFootprint("SirenState", sizeof(SirenState));
+  reportFootprint("MelodyState", sizeof(MelodyState));
+  reportFootprint("MelodyControls", sizeof(MelodyControls));
+  reportFootprint("SoundJob", sizeof(SoundJob));
+  printf("footprint.scheduler max_jobs=%u scheduler_bytes=%u\n", static_cast<unsigned>(SOUND_SCHEDULER_MAX_JOBS), static_cast<unsigned>(sizeof(SoundScheduler)));
+
+  unsigned mismatches = 0;
+  mismatches += wrapMismatches<ToneState>([](ToneState& s) { playTone(s, MEDIUM_A, LONG_DURATION); });
+  mismatches += wrapMismatches<AlertState>([](AlertState& s) { playAlert(s, 5, HIGH_C, SHORT_DURATION, 100); });
+  mismatches += wrapMismatches<ToneSeriesState>([](ToneSeriesState& s) { playToneSeries(s, 500, 2000, 50, VERY_SHORT_DURATION); });
+  mismatches += wrapMismatches<SirenState>([](SirenState& s) { playSiren(s, LOW_C, HIGH_C, LONG_DURATION); });
+  mismatches += wrapMismatches<SweepState>([](SweepState& s) { playSweep(s, 500, 2000, 1000, SWEEP_EXPONENTIAL); });
+  unsigned runs = 5;
+  for (size_t i = 0; i < RTTTL_CORPUS_SIZE; i++) {
+    for (int source = 0; source < 3; source++) {
+      for (int timing = 0; timing < 2; timing++) {
+        mismatches += wrapMismatches<MelodyState>([&](MelodyState& s) {
+          setMelodyTiming(s, timing ? MELODY_TIMING_ABSOLUTE : MELODY_TIMING_RELATIVE);
+          controls = MelodyControls();
+          setMelodyControls(s, &controls);
+          setMelodyGlide(s, (i % 2) ? 40 : 0);
+          startSeekMelody(s, i, source, 2);
+        });
+        runs++;
+      }
+    }
+  }
+
+  SoundScheduler scheduler;
+  initSoundScheduler(scheduler);
+  ToneState tone = ToneState();
+  AlertState alert = AlertState();
+  hostSetMillis(0xFFFF0000);
+  hostClearToneEvents();
+  playTone(tone, MEDIUM_A, LONG_DURATION);
+  addSoundJob(scheduler, tone, 1);
+  sleepUntil(millis() + 400);
+  playAlert(alert, 70, HIGH_C, MEDIUM_DURATION, 500);
+  addSoundJob(scheduler, alert, 2);
+  uint32_t deadline;
+  uint32_t resumeTime = 0;
+  while (nextDeadline(scheduler, deadline)) {
+    sleepUntil(deadline);
+    updateSoundScheduler(scheduler);
+    if (resumeTime == 0 && !alert.isPlaying) resumeTime = millis();
+  }
+  const HostToneEvent& last = hostToneEvents[hostToneEventCount - 1];
+  int32_t stopError = static_cast<int32_t>(last.time - (resumeTime + LONG_DURATION - 400));
+  printf("footprint.wrap runs=%u wrap_mismatches=%u freeze_ms=%u freeze_stop_error_ms=%d\n", runs, mismatches,
+         static_cast<unsigned>(resumeTime - 0xFFFF0000 - 400), static_cast<int>(last.frequency == 0 ? stopError : -1));
+}
+
+int main() {
+  printf("corpus melodies=%u bytes=%u\n", static_cast<unsigned>(RTTTL_CORPUS_SIZE), static_cast<unsigned>(corpusBytes()));
+  benchParse();
+  benchPitch();
+  benchUpdates();
+  benchTiming("relative", MELODY_TIMING_RELATIVE, 1);
+  benchTiming("relative", MELODY_TIMING_RELATIVE, 5);
+  benchTiming("relative", MELODY_TIMING_RELATIVE, 20);
+  benchTiming("absolute", MELODY_TIMING_ABSOLUTE, 1);
+  benchTiming("absolute", MELODY_TIMING_ABSOLUTE, 5);
+  benchTiming("absolute", MELODY_TIMING_ABSOLUTE, 20);
+  benchWakeups();
+  benchSynth();
+  benchCatalog();
+  benchStream();
+  benchPlaylist();
+  benchCache();
+  benchSpeakers();
+  benchTimer();
+  benchSweep();
+  benchEffects();
+  benchCompact();
+  benchSeek();
+  benchTempo();
+  benchFootprint();
+  return benchSink == 0xFFFFFFFF;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file melody_compact.cpp
+ * @brief Encoder for compact melody images: nibble pitches, octave steps and sticky durations (see compactMelody()).
+ * Every melody is packed with packRTTTL() (or taken from its packed table), converted with compactMelody() and
+ * decoded back with readCompactNote(), so an image is only written if it plays exactly like the packed one.
+ *
+ * Build from the repository root:
+ *   g++ -O2 -std=gnu++11 -Isrc extras/tools/melody_compact.cpp -o melody_compact
+ * Usage:
+ *   melody_compact [-H out.h] [--builtin] [file ...]
+ *     -H file     Write the compact images as PROGMEM arrays for playCompactMelody(..., true).
+ *     --builtin   Encode the melodies of melodies.h and rtttl_PROGMEM_melodies.h.
+ *     file        Text file with one RTTTL string per line ("-" for stdin); empty lines and lines
+ *                 starting with '#' are skipped.
+ * Output: "name notes=N source=S packed=P compact=C ratio=R" per melody (bytes; source is the RTTTL text or
+ * the ToneFrequency and ToneDuration arrays on AVR, ratio is source / compact), then a summary line.
+ */
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "sound_fun_rtttl.h"
+#include "melodies.h"
+#include "rtttl_compiled_melodies.h"
+
+struct CompactMelody {
+  std::string name;   // Array name, without the _COMPACT suffix.
+  std::string origin; // Where the melody comes from, written as a comment.
+  size_t sourceBytes;
+  size_t packedBytes;
+  std::vector<uint8_t> image;
+};
+
+struct CompactTotals {
+  size_t melodies = 0;
+  size_t failures = 0;
+  size_t sourceBytes = 0;
+  size_t packedBytes = 0;
+  size_t compactBytes = 0;
+};
+
+/** C identifier for the array of a melody, unique within one header. */
+static std::string arrayName(const std::string& name, const std::vector<CompactMelody>& melodies) {
+  std::string base;
+  for (char c : name) base += isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : '_';
+  if (base.empty() || isdigit(static_cast<unsigned char>(base[0]))) base = "MELODY_" + base;
+  std::string candidate = base;
+  auto used = [&](const std::string& n) {
+    return std::any_of(melodies.begin(), melodies.end(), [&](const CompactMelody& m) { return m.name == n; });
+  };
+  for (unsigned n = 2; used(candidate); n++) candidate = base + "_" + std::to_string(n);
+  return candidate;
+}
+
+/** Encode a packed image, check that it decodes to the same notes and add it to melodies. */
+static void addMelody(std::vector<CompactMelody>& melodies, CompactTotals& totals, const std::string& name, const std::string& origin,
+                      size_t sourceBytes, const uint16_t* packed, bool isProgmem) {
+  totals.melodies++;
+  size_t size = compactMelody(packed, nullptr, 0, isProgmem);
+  std::vector<uint8_t> image(size);
+  if (size == 0 || compactMelody(packed, image.data(), image.size(), isProgmem) != size) {
+    fprintf(stderr, "%s: error: melody cannot be compacted\n", origin.c_str());
+    totals.failures++;
+    return;
+  }
+  uint16_t length = readPackedWord(packed + 1, isProgmem);
+  CompactCursor cursor;
+  startCompactCursor(image.data(), false, cursor);
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t note;
+    uint16_t expected = readPackedWord(packed + PACKED_HEADER_WORDS + i, isProgmem);
+    if ((expected >> PACKED_PITCH_SHIFT) == 0) expected &= ~(0x07 << PACKED_OCTAVE_SHIFT);  // The octave of a pause is not kept
+    if (!readCompactNote(image.data(), false, cursor, note) || note != expected) {
+      fprintf(stderr, "%s: error: note %u does not decode back\n", origin.c_str(), static_cast<unsigned>(i));
+      totals.failures++;
+      return;
+    }
+  }
+  CompactMelody melody{ arrayName(name, melodies), origin, sourceBytes, (PACKED_HEADER_WORDS + length) * sizeof(uint16_t), image };
+  printf("%s notes=%u source=%u packed=%u compact=%u ratio=%.2f\n", melody.name.c_str(), static_cast<unsigned>(length),
+         static_cast<unsigned>(melody.sourceBytes), static_cast<unsigned>(melody.packedBytes), static_cast<unsigned>(size),
+         static_cast<double>(melody.sourceBytes) / size);
+  totals.sourceBytes += melody.sourceBytes;
+  totals.packedBytes += melody.packedBytes;
+  totals.compactBytes += size;
+  melodies.push_back(melody);
+}
+
+static void addRTTTL(std::vector<CompactMelody>& melodies, CompactTotals& totals, const std::string& text, const std::string& origin) {
+  std::vector<uint16_t> packed(PACKED_HEADER_WORDS + MAX_RTTTL_NOTES);
+  if (!packRTTTL(text.c_str(), packed.data(), MAX_RTTTL_NOTES)) {
+    fprintf(stderr, "%s: error: invalid RTTTL or note that cannot be packed\n", origin.c_str());
+    totals.melodies++;
+    totals.failures++;
+    return;
+  }
+  addMelody(melodies, totals, text.substr(0, text.find(':')), origin, text.size() + 1, packed.data(), false);
+}
+
+template <size_t Words>
+static void addPacked(std::vector<CompactMelody>& melodies, CompactTotals& totals, const char* name, const PackedMelody<Words>& melody,
+                      size_t sourceBytes) {
+  addMelody(melodies, totals, name, name, sourceBytes, melody.words, true);
+}
+
+static void addBuiltin(std::vector<CompactMelody>& melodies, CompactTotals& totals) {
+  // Enum arrays take two 2-byte enums per note on AVR
+  addPacked(melodies, totals, "TWINKLE", TWINKLE_PACKED, sizeof(twinkleMelody) / sizeof(twinkleMelody[0]) * 4);
+  addPacked(melodies, totals, "FLIGHT_OF_THE_BUMBLEBEE", FLIGHT_OF_THE_BUMBLEBEE_PACKED, sizeof(flightOfTheBumblebeeMelody) / sizeof(flightOfTheBumblebeeMelody[0]) * 4);
+  addPacked(melodies, totals, "R2D2", R2D2_PACKED, sizeof(r2d2Melody) / sizeof(r2d2Melody[0]) * 4);
+  addPacked(melodies, totals, "NOKIA", NOKIA_PACKED, sizeof(NOKIA_RTTTL));
+  addPacked(melodies, totals, "XFILES", XFILES_PACKED, sizeof(XFILES_RTTTL));
+  addPacked(melodies, totals, "MISSION", MISSION_PACKED, sizeof(MISSION_RTTTL));
+  addPacked(melodies, totals, "SIMPSONS", SIMPSONS_PACKED, sizeof(SIMPSONS_RTTTL));
+  addPacked(melodies, totals, "GADGET", GADGET_PACKED, sizeof(GADGET_RTTTL));
+  addPacked(melodies, totals, "CANON", CANON_PACKED, sizeof(CANON_RTTTL));
+  addPacked(melodies, totals, "SUPERMARIO", SUPERMARIO_PACKED, sizeof(SUPERMARIO_RTTTL));
+}
+
+static bool addFile(std::vector<CompactMelody>& melodies, CompactTotals& totals, const char* path) {
+  FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string line;
+  size_t lineNumber = 0;
+  int c;
+  while ((c = fgetc(file)) != EOF || !line.empty()) {
+    if (c != EOF && c != '\n') {
+      if (c != '\r') line += static_cast<char>(c);
+      continue;
+    }
+    lineNumber++;
+    if (!line.empty() && line[0] != '#') addRTTTL(melodies, totals, line, std::string(path) + ":" + std::to_string(lineNumber));
+    line.clear();
+    if (c == EOF) break;
+  }
+  if (file != stdin) fclose(file);
+  return true;
+}
+
+static bool writeHeader(const char* path, const std::vector<CompactMelody>& melodies) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string base = path;
+  base = base.substr(base.find_last_of("/\\") + 1);
+  std::string guard;
+  for (char c : base) guard += isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : '_';
+  fprintf(file, "/**\n * @file %s\n * @brief Compact melody images generated by melody_compact (extras/tools).\n", base.c_str());
+  fprintf(file, " * Play them with playCompactMelody(state, NAME_COMPACT, true); each note is decoded when it starts.\n */\n\n");
+  fprintf(file, "#ifndef %s\n#define %s\n", guard.c_str(), guard.c_str());
+  for (const CompactMelody& melody : melodies) {
+    fprintf(file, "\n// %s: %u bytes (packed: %u)\nconst uint8_t %s_COMPACT[] PROGMEM = {", melody.origin.c_str(), static_cast<unsigned>(melody.image.size()),
+            static_cast<unsigned>(melody.packedBytes), melody.name.c_str());
+    for (size_t b = 0; b < melody.image.size(); b++) {
+      fprintf(file, "%s0x%02x", b == 0 ? " " : (b % 16 == 0 ? ",\n  " : ", "), melody.image[b]);
+    }
+    fprintf(file, " };\n");
+  }
+  fprintf(file, "\n#endif  // %s\n", guard.c_str());
+  bool ok = !ferror(file);
+  return (fclose(file) == 0) && ok;
+}
+
+int main(int argc, char** argv) {
+  std::vector<CompactMelody> melodies;
+  CompactTotals totals;
+  const char* headerPath = nullptr;
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-H" && i + 1 < argc) {
+      headerPath = argv[++i];
+    } else if (arg == "--builtin") {
+      addBuiltin(melodies, totals);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "usage: %s [-H out.h] [--builtin] [file ...]\n", argv[0]);
+      return 2;
+    } else {
+      ok = addFile(melodies, totals, argv[i]) && ok;
+    }
+  }
+  if (headerPath) {
+    ok = writeHeader(headerPath, melodies) && ok;
+  }
+  printf("total melodies=%u failures=%u source_bytes=%u packed_bytes=%u compact_bytes=%u source_ratio=%.2f packed_ratio=%.2f\n",
+         static_cast<unsigned>(totals.melodies), static_cast<unsigned>(totals.failures), static_cast<unsigned>(totals.sourceBytes),
+         static_cast<unsigned>(totals.packedBytes), static_cast<unsigned>(totals.compactBytes),
+         totals.compactBytes ? static_cast<double>(totals.sourceBytes) / totals.compactBytes : 0.0,
+         totals.compactBytes ? static_cast<double>(totals.packedBytes) / totals.compactBytes : 0.0);
+  return (ok && totals.failures == 0) ? 0 : 1;
+}
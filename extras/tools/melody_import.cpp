@@ -0,0 +1,727 @@
+/**
+ * @file melody_import.cpp
+ * @brief Importer for standard MIDI files and MML: extracts one monophonic line, quantizes it and writes compact
+ * melody images (see compactMelody()) ready to include in a sketch.
+ * MIDI: format 0 and 1 files, with every tempo change. The notes of one track and channel are reduced to a single
+ * line by keeping the highest (or lowest) sounding note at each instant; the default line is the (track, channel)
+ * pair with the most notes, drum channel 10 excluded.
+ * MML: t (tempo), o, <, > (octave), l (default length), a-g with +, # or - and an optional length and dots,
+ * r or p (rest), n (MIDI key, 60 = o4c), & (tie to the next note of the same pitch), ^ (extend by a length);
+ * v, q and @ are ignored, and ';' separates tracks. Octave 4 holds A at 440 Hz, as in RTTTL.
+ * Note boundaries are converted to milliseconds through the tempo map and rounded to a grid of the whole note
+ * (one whole note duration for the melody, from the tempo that lasts longest). Lengths that no duration code
+ * can hold are split into tied pieces of the same pitch, and notes outside octaves 1 to 7 are moved by octaves.
+ * Every image is decoded back with readCompactNote() and timed with packedNoteDuration(), so the reported
+ * errors are the ones the board plays.
+ *
+ * Build from the repository root:
+ *   g++ -O2 -std=gnu++11 -Isrc extras/tools/melody_import.cpp -o melody_import
+ * Usage:
+ *   melody_import [-H out.h] [-q grid] [-w whole_ms] [-t track] [-c channel] [-m high|low] file ...
+ *     -H file     Write the compact images as PROGMEM arrays for playCompactMelody(..., true).
+ *     -q grid     Quantization grid as a duration code: 3 = 1/8 to 7 = 1/128 of a whole note (default 5, 1/32).
+ *     -w ms       Duration of a whole note (default: from the tempo that lasts longest).
+ *     -t track    MIDI track or MML track (';'-separated) to import, from 0 (default: the one with the most notes).
+ *     -c channel  MIDI channel to import, 1-16 (default: the one with the most notes in the track).
+ *     -m mode     Note kept when several sound together: high (default) or low.
+ *     file        MIDI file (.mid, .midi or an MThd header), or MML text.
+ * Output: "name notes=N pieces=P ties=T stretched=S folded=F overlaps=O whole_ms=W duration_ms=D end_error_ms=E
+ * max_onset_error_ms=M packed=B compact=C" per melody (bytes), then a summary line with the elapsed time.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "sound_fun_rtttl.h"
+
+/** @brief Lowest octave imported as is; octave 0 is mostly below MIN_FREQUENCY. */
+#define IMPORT_MIN_OCTAVE 1
+/** @brief Ticks per quarter note of MML scores. */
+#define MML_TICKS_PER_QUARTER 480
+
+struct ImportOptions {
+  uint8_t grid = 5;
+  uint32_t wholeNote = 0;
+  int track = -1;
+  int channel = -1;
+  bool isLowest = false;
+};
+
+struct TempoChange {
+  uint32_t tick;
+  uint32_t microsPerQuarter;
+};
+
+/** One note of the monophonic line, in ticks; key -1 is never stored (rests are the gaps). */
+struct ScoreNote {
+  int key;
+  uint32_t start;
+  uint32_t end;
+};
+
+struct Score {
+  double ticksPerQuarter = MML_TICKS_PER_QUARTER;
+  std::vector<TempoChange> tempos;
+  std::vector<ScoreNote> notes;
+  uint32_t overlaps = 0;  // Note-ons that started while another note of the line was sounding
+};
+
+struct ImportedMelody {
+  std::string name;
+  std::string origin;
+  size_t notes;
+  size_t packedBytes;
+  uint32_t durationMs;
+  std::vector<uint8_t> image;
+};
+
+struct ImportTotals {
+  size_t melodies = 0;
+  size_t failures = 0;
+  size_t notes = 0;
+  size_t sourceBytes = 0;
+  size_t packedBytes = 0;
+  size_t compactBytes = 0;
+};
+
+/** C identifier for the array of a melody, unique within one header. */
+static std::string arrayName(const std::string& name, const std::vector<ImportedMelody>& melodies) {
+  std::string base;
+  for (char c : name) base += isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : '_';
+  if (base.empty() || isdigit(static_cast<unsigned char>(base[0]))) base = "MELODY_" + base;
+  std::string candidate = base;
+  auto used = [&](const std::string& n) {
+    return std::any_of(melodies.begin(), melodies.end(), [&](const ImportedMelody& m) { return m.name == n; });
+  };
+  for (unsigned n = 2; used(candidate); n++) candidate = base + "_" + std::to_string(n);
+  return candidate;
+}
+
+/** Time of a tick (ms) through the tempo map, which must be sorted and start at tick 0. */
+static double tickTime(const Score& score, uint32_t tick) {
+  double time = 0;
+  for (size_t i = 0; i < score.tempos.size(); i++) {
+    uint32_t end = (i + 1 < score.tempos.size()) ? std::min(tick, score.tempos[i + 1].tick) : tick;
+    if (end <= score.tempos[i].tick) break;
+    time += static_cast<double>(end - score.tempos[i].tick) * score.tempos[i].microsPerQuarter / (score.ticksPerQuarter * 1000.0);
+  }
+  return time;
+}
+
+/** Sort the tempo map, keep the last change of each tick and make it start at tick 0 (120 bpm by default). */
+static void normalizeTempos(Score& score) {
+  std::stable_sort(score.tempos.begin(), score.tempos.end(), [](const TempoChange& a, const TempoChange& b) { return a.tick < b.tick; });
+  std::vector<TempoChange> tempos;
+  for (const TempoChange& change : score.tempos) {
+    if (!tempos.empty() && tempos.back().tick == change.tick) tempos.back() = change;
+    else tempos.push_back(change);
+  }
+  if (tempos.empty() || tempos[0].tick != 0) tempos.insert(tempos.begin(), TempoChange{ 0, 500000 });
+  score.tempos = tempos;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// MIDI
+
+struct MidiEvent {
+  uint32_t tick;
+  uint8_t track;
+  uint8_t channel;
+  uint8_t key;
+  bool isOn;
+};
+
+struct MidiReader {
+  const std::vector<uint8_t>& data;
+  size_t position;
+  size_t end;
+
+  bool read(uint8_t& byte) {
+    if (position >= end) return false;
+    byte = data[position++];
+    return true;
+  }
+
+  bool readVariable(uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+      uint8_t byte;
+      if (!read(byte)) return false;
+      value = (value << 7) | (byte & 0x7F);
+      if (!(byte & 0x80)) return true;
+    }
+    return false;
+  }
+
+  bool skip(uint32_t length) {
+    if (end - position < length) return false;
+    position += length;
+    return true;
+  }
+};
+
+static uint32_t readBigEndian(const std::vector<uint8_t>& data, size_t position, int bytes) {
+  uint32_t value = 0;
+  for (int i = 0; i < bytes; i++) value = (value << 8) | data[position + i];
+  return value;
+}
+
+/** Read the note and tempo events of one MTrk chunk. */
+static bool readMidiTrack(MidiReader& reader, uint8_t track, Score& score, std::vector<MidiEvent>& events, std::string& error) {
+  uint32_t tick = 0;
+  uint8_t status = 0;
+  while (reader.position < reader.end) {
+    uint32_t delta;
+    uint8_t byte;
+    if (!reader.readVariable(delta) || !reader.read(byte)) break;
+    tick += delta;
+    if (byte == 0xFF) {
+      uint8_t type;
+      uint32_t length;
+      if (!reader.read(type) || !reader.readVariable(length) || reader.end - reader.position < length) break;
+      if (type == 0x51 && length == 3) {
+        score.tempos.push_back(TempoChange{ tick, readBigEndian(reader.data, reader.position, 3) });
+      }
+      reader.position += length;
+      if (type == 0x2F) return true;
+      continue;
+    }
+    if (byte == 0xF0 || byte == 0xF7) {
+      uint32_t length;
+      if (!reader.readVariable(length) || !reader.skip(length)) break;
+      continue;
+    }
+    uint8_t first;
+    if (byte & 0x80) {
+      status = byte;
+      if (!reader.read(first)) break;
+    } else if (status) {
+      first = byte;  // Running status
+    } else {
+      error = "data byte without status";
+      return false;
+    }
+    uint8_t type = status & 0xF0;
+    if (type == 0xC0 || type == 0xD0) continue;
+    uint8_t second;
+    if (!reader.read(second)) break;
+    if (type == 0x90 || type == 0x80) {
+      events.push_back(MidiEvent{ tick, track, static_cast<uint8_t>(status & 0x0F), static_cast<uint8_t>(first & 0x7F),
+                                  type == 0x90 && second > 0 });
+    }
+  }
+  error = "truncated track";
+  return false;
+}
+
+/**
+ * Reduce the note events of one line to non-overlapping notes: at every tick the highest (or lowest) held key sounds;
+ * a new note starts when that key changes or is struck again.
+ */
+static void reduceMidiLine(const std::vector<MidiEvent>& events, bool isLowest, Score& score) {
+  std::vector<uint8_t> held(128, 0);
+  int sounding = -1;
+  uint32_t soundingStart = 0;
+  size_t i = 0;
+  uint32_t heldCount = 0;
+  while (i < events.size()) {
+    uint32_t tick = events[i].tick;
+    std::vector<bool> struck(128, false);
+    for (; i < events.size() && events[i].tick == tick; i++) {
+      const MidiEvent& event = events[i];
+      if (event.isOn) {
+        if (heldCount) score.overlaps++;  // Offs of this tick come first, so this note really overlaps another
+        held[event.key]++;
+        heldCount++;
+        struck[event.key] = true;
+      } else if (held[event.key]) {
+        held[event.key]--;
+        heldCount--;
+      }
+    }
+    int key = -1;
+    for (int k = 0; k < 128; k++) {
+      if (!held[k]) continue;
+      key = k;
+      if (isLowest) break;
+    }
+    if (key != sounding || (key >= 0 && struck[key])) {
+      if (sounding >= 0 && tick > soundingStart) score.notes.push_back(ScoreNote{ sounding, soundingStart, tick });
+      sounding = key;
+      soundingStart = tick;
+    }
+  }
+}
+
+static bool parseMidi(const std::vector<uint8_t>& data, const ImportOptions& options, Score& score, std::string& error) {
+  if (data.size() < 14 || readBigEndian(data, 0, 4) != 0x4D546864 || readBigEndian(data, 4, 4) < 6) {
+    error = "not a MIDI file";
+    return false;
+  }
+  uint16_t format = readBigEndian(data, 8, 2);
+  uint16_t division = readBigEndian(data, 12, 2);
+  if (format > 1) {
+    error = "MIDI format 2 is not supported";
+    return false;
+  }
+  if (division & 0x8000) {
+    // SMPTE time: frames per second times ticks per frame; a quarter is given 0.5 s at the default tempo
+    score.ticksPerQuarter = (256 - (division >> 8)) * (division & 0xFF) / 2.0;
+  } else {
+    score.ticksPerQuarter = division;
+  }
+  if (score.ticksPerQuarter <= 0) {
+    error = "invalid time division";
+    return false;
+  }
+  std::vector<MidiEvent> events;
+  size_t position = 8 + readBigEndian(data, 4, 4);
+  uint8_t track = 0;
+  while (position + 8 <= data.size()) {
+    uint32_t length = readBigEndian(data, position + 4, 4);
+    if (length > data.size() - position - 8) {
+      error = "truncated chunk";
+      return false;
+    }
+    if (readBigEndian(data, position, 4) == 0x4D54726B) {
+      MidiReader reader{ data, position + 8, position + 8 + length };
+      if (!readMidiTrack(reader, track, score, events, error)) {
+        error = "track " + std::to_string(track) + ": " + error;
+        return false;
+      }
+      if (track == 255) break;
+      track++;
+    }
+    position += 8 + length;
+  }
+  normalizeTempos(score);
+
+  // Pick the (track, channel) line with the most note-ons, drums excluded unless asked for
+  std::vector<uint32_t> counts(256 * 16, 0);
+  for (const MidiEvent& event : events) {
+    if (event.isOn) counts[event.track * 16 + event.channel]++;
+  }
+  int best = -1;
+  for (int line = 0; line < 256 * 16; line++) {
+    int lineTrack = line / 16;
+    int lineChannel = line % 16;
+    if (options.track >= 0 && lineTrack != options.track) continue;
+    if (options.channel >= 0 ? lineChannel != options.channel - 1 : lineChannel == 9) continue;
+    if (counts[line] && (best < 0 || counts[line] > counts[best])) best = line;
+  }
+  if (best < 0) {
+    error = "no notes in the selected track and channel";
+    return false;
+  }
+  std::vector<MidiEvent> line;
+  for (const MidiEvent& event : events) {
+    if (event.track * 16 + event.channel == best) line.push_back(event);
+  }
+  // Note-offs first on the same tick, so repeated notes do not overlap
+  std::stable_sort(line.begin(), line.end(), [](const MidiEvent& a, const MidiEvent& b) {
+    if (a.tick != b.tick) return a.tick < b.tick;
+    return !a.isOn && b.isOn;
+  });
+  reduceMidiLine(line, options.isLowest, score);
+  if (score.notes.empty()) {
+    error = "no complete notes in the selected track and channel";
+    return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// MML
+
+struct MmlParser {
+  const std::string& text;
+  size_t position;
+
+  int peek() const { return position < text.size() ? tolower(static_cast<unsigned char>(text[position])) : -1; }
+
+  void skipSpace() {
+    while (position < text.size() && (isspace(static_cast<unsigned char>(text[position])) || text[position] == '|')) position++;
+  }
+
+  bool readNumber(long& value) {
+    skipSpace();
+    if (!isdigit(peek())) return false;
+    value = 0;
+    while (isdigit(peek()) && value < 100000) value = value * 10 + (text[position++] - '0');
+    return true;
+  }
+
+  /** Length in ticks of an optional divider and dots, or defaultTicks; 0 if the divider is invalid. */
+  uint32_t readLength(uint32_t defaultTicks) {
+    long divider;
+    uint32_t ticks = defaultTicks;
+    if (readNumber(divider)) {
+      if (divider < 1 || divider > 4 * MML_TICKS_PER_QUARTER) return 0;
+      ticks = 4 * MML_TICKS_PER_QUARTER / divider;
+    }
+    skipSpace();
+    for (uint32_t dot = ticks / 2; peek() == '.'; dot /= 2) {
+      ticks += dot;
+      position++;
+      skipSpace();
+    }
+    return ticks;
+  }
+};
+
+static bool parseMml(const std::string& text, const ImportOptions& options, Score& score, std::string& error) {
+  // Find the track: the one asked for, or the one with the most notes
+  std::vector<std::pair<size_t, size_t>> tracks;
+  size_t start = 0;
+  for (size_t i = 0; i <= text.size(); i++) {
+    if (i == text.size() || text[i] == ';') {
+      tracks.push_back(std::make_pair(start, i));
+      start = i + 1;
+    }
+  }
+  size_t chosen = 0;
+  if (options.track >= 0) {
+    if (static_cast<size_t>(options.track) >= tracks.size()) {
+      error = "no MML track " + std::to_string(options.track);
+      return false;
+    }
+    chosen = options.track;
+  } else {
+    size_t bestCount = 0;
+    for (size_t t = 0; t < tracks.size(); t++) {
+      size_t count = 0;
+      for (size_t i = tracks[t].first; i < tracks[t].second; i++) count += strchr("abcdefgnABCDEFGN", text[i]) && text[i] ? 1 : 0;
+      if (count > bestCount) {
+        bestCount = count;
+        chosen = t;
+      }
+    }
+  }
+  std::string track = text.substr(tracks[chosen].first, tracks[chosen].second - tracks[chosen].first);
+  static const int NOTE_KEYS[7] = { 9, 11, 0, 2, 4, 5, 7 };  // a to g, semitones above C
+
+  MmlParser parser{ track, 0 };
+  int octave = 4;
+  uint32_t defaultTicks = MML_TICKS_PER_QUARTER;
+  uint32_t tick = 0;
+  bool isTied = false;
+  auto fail = [&](const char* message) {
+    error = "column " + std::to_string(tracks[chosen].first + parser.position + 1) + ": " + message;
+    return false;
+  };
+  for (parser.skipSpace(); parser.position < track.size(); parser.skipSpace()) {
+    int command = parser.peek();
+    parser.position++;
+    long value;
+    if ((command >= 'a' && command <= 'g') || command == 'n' || command == 'r' || command == 'p') {
+      int key = -1;
+      if (command == 'n') {
+        if (!parser.readNumber(value) || value > 127) return fail("n needs a MIDI key from 0 to 127");
+        key = static_cast<int>(value);
+      } else if (command != 'r' && command != 'p') {
+        key = (octave + 1) * 12 + NOTE_KEYS[command - 'a'];
+        for (parser.skipSpace(); parser.peek() == '+' || parser.peek() == '#' || parser.peek() == '-'; parser.skipSpace()) {
+          key += (track[parser.position++] == '-') ? -1 : 1;
+        }
+        if (key < 0 || key > 127) return fail("note out of range");
+      }
+      uint32_t ticks = parser.readLength(defaultTicks);
+      if (ticks == 0) return fail("invalid length");
+      ScoreNote* last = score.notes.empty() ? nullptr : &score.notes.back();
+      if (key >= 0 && isTied && last && last->key == key && last->end == tick) {
+        last->end += ticks;
+      } else if (key >= 0) {
+        score.notes.push_back(ScoreNote{ key, tick, tick + ticks });
+      }
+      tick += ticks;
+      parser.skipSpace();
+      isTied = parser.peek() == '&';
+      if (isTied) parser.position++;
+    } else if (command == '^') {
+      uint32_t ticks = parser.readLength(defaultTicks);
+      if (ticks == 0) return fail("invalid length");
+      if (!score.notes.empty() && score.notes.back().end == tick) score.notes.back().end += ticks;
+      tick += ticks;
+    } else if (command == 'o') {
+      if (!parser.readNumber(value) || value > 9) return fail("o needs an octave from 0 to 9");
+      octave = static_cast<int>(value);
+    } else if (command == '>' || command == '<') {
+      octave += (command == '>') ? 1 : -1;
+      if (octave < 0 || octave > 9) return fail("octave out of range");
+    } else if (command == 'l') {
+      defaultTicks = parser.readLength(0);
+      if (defaultTicks == 0) return fail("l needs a length");
+    } else if (command == 't') {
+      if (!parser.readNumber(value) || value < 1 || value > 999) return fail("t needs a tempo from 1 to 999");
+      score.tempos.push_back(TempoChange{ tick, static_cast<uint32_t>(60000000 / value) });
+    } else if (command == 'v' || command == 'q' || command == '@') {
+      parser.readNumber(value);
+    } else {
+      parser.position--;
+      return fail("unknown command");
+    }
+  }
+  normalizeTempos(score);
+  if (score.notes.empty()) {
+    error = "no notes";
+    return false;
+  }
+  return true;
+}
+
+// ---------------------------------------------------------------------------------------------------------------
+// Quantization and packing
+
+/** Whole note duration (ms) of the tempo that lasts longest between the first and last note. */
+static uint32_t dominantWholeNote(const Score& score) {
+  uint32_t first = score.notes.front().start;
+  uint32_t last = score.notes.back().end;
+  double bestTime = -1;
+  uint32_t bestTempo = score.tempos[0].microsPerQuarter;
+  for (size_t i = 0; i < score.tempos.size(); i++) {
+    uint32_t from = std::max(first, score.tempos[i].tick);
+    uint32_t to = (i + 1 < score.tempos.size()) ? std::min(last, score.tempos[i + 1].tick) : last;
+    if (to <= from) continue;
+    double time = tickTime(score, to) - tickTime(score, from);
+    if (time > bestTime) {
+      bestTime = time;
+      bestTempo = score.tempos[i].microsPerQuarter;
+    }
+  }
+  return static_cast<uint32_t>(lround(4.0 * bestTempo / 1000.0));
+}
+
+struct PackResult {
+  std::vector<uint16_t> packed;
+  std::vector<size_t> firstPiece;  // Index of the first packed note of each score note
+  std::vector<double> onsets;      // Source onset of each score note (ms from the first note)
+  double endTime;                  // Source end of the last note (ms from the first note)
+  uint32_t ties = 0;
+  uint32_t folded = 0;
+  uint32_t stretched = 0;  // Notes shorter than half a grid step, played one step long
+};
+
+/** Append the packed notes of a length in grid units: largest plain or dotted durations first. */
+static void appendPieces(PackResult& result, uint8_t pitch, uint8_t octave, uint32_t units, uint8_t grid) {
+  while (units > 0) {
+    uint8_t code = 0;
+    bool isDotted = false;
+    uint32_t pieceUnits = 0;
+    for (uint8_t c = 0; c <= grid; c++) {
+      uint32_t plain = 1u << (grid - c);
+      uint32_t dotted = (c < grid) ? plain + plain / 2 : 0;
+      if (dotted && dotted <= units && dotted > pieceUnits) {
+        code = c;
+        isDotted = true;
+        pieceUnits = dotted;
+      }
+      if (plain <= units && plain > pieceUnits) {
+        code = c;
+        isDotted = false;
+        pieceUnits = plain;
+      }
+    }
+    result.packed.push_back(packNote(pitch, pitch ? octave : 0, code, isDotted));
+    units -= pieceUnits;
+  }
+}
+
+/** Time (ms) the packed notes from index first on take to play. */
+static double playedTime(const PackResult& result, size_t first, uint32_t wholeNote) {
+  double time = 0;
+  for (size_t i = first; i < result.packed.size(); i++) time += packedNoteDuration(result.packed[i], wholeNote);
+  return time;
+}
+
+/**
+ * Quantize the notes of a score to the grid and pack them, with the rests between them. Lengths are rounded against
+ * the time already played (durations are wholeNote >> code, truncated), so rounding errors do not add up.
+ */
+static bool packScore(const Score& score, uint32_t wholeNote, uint8_t grid, PackResult& result, std::string& error) {
+  double unit = static_cast<double>(wholeNote) / (1u << grid);
+  double origin = tickTime(score, score.notes.front().start);
+  result.packed.assign(PACKED_HEADER_WORDS, 0);
+  double played = 0;
+  for (const ScoreNote& note : score.notes) {
+    double onset = tickTime(score, note.start) - origin;
+    double end = tickTime(score, note.end) - origin;
+    long rest = lround((onset - played) / unit);
+    if (rest > 0) {
+      size_t first = result.packed.size();
+      appendPieces(result, 0, 0, static_cast<uint32_t>(rest), grid);
+      played += playedTime(result, first, wholeNote);
+    }
+    int octave = note.key / 12 - 1;
+    if (octave < IMPORT_MIN_OCTAVE || octave > PACKED_MAX_OCTAVE) {
+      octave = std::min(std::max(octave, IMPORT_MIN_OCTAVE), PACKED_MAX_OCTAVE);
+      result.folded++;
+    }
+    result.firstPiece.push_back(result.packed.size() - PACKED_HEADER_WORDS);
+    result.onsets.push_back(onset);
+    size_t first = result.packed.size();
+    long units = lround((end - played) / unit);
+    if (units < 1) {
+      units = 1;
+      result.stretched++;
+    }
+    appendPieces(result, static_cast<uint8_t>(note.key % 12 + 1), static_cast<uint8_t>(octave), static_cast<uint32_t>(units), grid);
+    result.ties += static_cast<uint32_t>(result.packed.size() - first - 1);
+    played += playedTime(result, first, wholeNote);
+    result.endTime = end;
+  }
+  size_t length = result.packed.size() - PACKED_HEADER_WORDS;
+  if (length > UINT16_MAX) {
+    error = "too many notes for one image";
+    return false;
+  }
+  result.packed[0] = static_cast<uint16_t>(wholeNote);
+  result.packed[1] = static_cast<uint16_t>(length);
+  return true;
+}
+
+/** Import one file: parse, quantize, pack, compact, and check the image against the packed notes and the source times. */
+static void importFile(std::vector<ImportedMelody>& melodies, ImportTotals& totals, const ImportOptions& options, const char* path) {
+  totals.melodies++;
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    totals.failures++;
+    return;
+  }
+  std::vector<uint8_t> data;
+  uint8_t buffer[4096];
+  for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file)) > 0;) data.insert(data.end(), buffer, buffer + n);
+  fclose(file);
+
+  std::string base = path;
+  base = base.substr(base.find_last_of("/\\") + 1);
+  std::string extension = base.find('.') != std::string::npos ? base.substr(base.find_last_of('.')) : "";
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+  bool isMidi = extension == ".mid" || extension == ".midi" || (data.size() >= 4 && memcmp(data.data(), "MThd", 4) == 0);
+
+  Score score;
+  std::string error;
+  bool ok = isMidi ? parseMidi(data, options, score, error) : parseMml(std::string(data.begin(), data.end()), options, score, error);
+  uint32_t wholeNote = ok ? (options.wholeNote ? options.wholeNote : dominantWholeNote(score)) : 0;
+  if (ok && (wholeNote < (1u << options.grid) || wholeNote > UINT16_MAX)) {
+    error = "whole note of " + std::to_string(wholeNote) + " ms out of range";
+    ok = false;
+  }
+  PackResult result;
+  ok = ok && packScore(score, wholeNote, options.grid, result, error);
+  size_t size = ok ? compactMelody(result.packed.data(), nullptr, 0) : 0;
+  std::vector<uint8_t> image(size);
+  if (ok && (size == 0 || compactMelody(result.packed.data(), image.data(), image.size()) != size)) {
+    error = "melody does not fit one compact image (65535 nibbles); split the source";
+    ok = false;
+  }
+  if (!ok) {
+    fprintf(stderr, "%s: error: %s\n", path, error.c_str());
+    totals.failures++;
+    return;
+  }
+
+  // Decode the image as the board does and compare the note onsets with the source
+  uint16_t length = result.packed[1];
+  CompactCursor cursor;
+  startCompactCursor(image.data(), false, cursor);
+  std::vector<uint32_t> playedOnsets(length + 1, 0);
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t note;
+    uint16_t expected = result.packed[PACKED_HEADER_WORDS + i];
+    if (!readCompactNote(image.data(), false, cursor, note) || note != expected) {
+      fprintf(stderr, "%s: error: note %u does not decode back\n", path, static_cast<unsigned>(i));
+      totals.failures++;
+      return;
+    }
+    playedOnsets[i + 1] = playedOnsets[i] + static_cast<uint16_t>(packedNoteDuration(note, wholeNote));
+  }
+  double maxError = 0;
+  for (size_t n = 0; n < result.onsets.size(); n++) {
+    maxError = std::max(maxError, fabs(playedOnsets[result.firstPiece[n]] - result.onsets[n]));
+  }
+  uint32_t duration = playedOnsets[length];
+
+  ImportedMelody melody{ arrayName(base.substr(0, base.find('.')), melodies), path, score.notes.size(), result.packed.size() * sizeof(uint16_t), duration, image };
+  printf("%s notes=%u pieces=%u ties=%u stretched=%u folded=%u overlaps=%u whole_ms=%u duration_ms=%u end_error_ms=%.1f max_onset_error_ms=%.1f packed=%u compact=%u\n",
+         melody.name.c_str(), static_cast<unsigned>(melody.notes), static_cast<unsigned>(length), static_cast<unsigned>(result.ties), static_cast<unsigned>(result.stretched),
+         static_cast<unsigned>(result.folded), static_cast<unsigned>(score.overlaps), static_cast<unsigned>(wholeNote), static_cast<unsigned>(duration),
+         duration - result.endTime, maxError, static_cast<unsigned>(melody.packedBytes), static_cast<unsigned>(size));
+  totals.notes += melody.notes;
+  totals.sourceBytes += data.size();
+  totals.packedBytes += melody.packedBytes;
+  totals.compactBytes += size;
+  melodies.push_back(melody);
+}
+
+static bool writeHeader(const char* path, const std::vector<ImportedMelody>& melodies) {
+  FILE* file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string base = path;
+  base = base.substr(base.find_last_of("/\\") + 1);
+  std::string guard;
+  for (char c : base) guard += isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : '_';
+  fprintf(file, "/**\n * @file %s\n * @brief Compact melody images generated by melody_import (extras/tools).\n", base.c_str());
+  fprintf(file, " * Play them with playCompactMelody(state, NAME_COMPACT, true); each note is decoded when it starts.\n */\n\n");
+  fprintf(file, "#ifndef %s\n#define %s\n", guard.c_str(), guard.c_str());
+  for (const ImportedMelody& melody : melodies) {
+    fprintf(file, "\n// %s: %u notes, %u ms, %u bytes (packed: %u)\nconst uint8_t %s_COMPACT[] PROGMEM = {", melody.origin.c_str(),
+            static_cast<unsigned>(melody.notes), static_cast<unsigned>(melody.durationMs), static_cast<unsigned>(melody.image.size()),
+            static_cast<unsigned>(melody.packedBytes), melody.name.c_str());
+    for (size_t b = 0; b < melody.image.size(); b++) {
+      fprintf(file, "%s0x%02x", b == 0 ? " " : (b % 16 == 0 ? ",\n  " : ", "), melody.image[b]);
+    }
+    fprintf(file, " };\n");
+  }
+  fprintf(file, "\n#endif  // %s\n", guard.c_str());
+  bool ok = !ferror(file);
+  return (fclose(file) == 0) && ok;
+}
+
+int main(int argc, char** argv) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<ImportedMelody> melodies;
+  ImportTotals totals;
+  ImportOptions options;
+  const char* headerPath = nullptr;
+  std::vector<const char*> files;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "-H" && hasValue) {
+      headerPath = argv[++i];
+    } else if (arg == "-q" && hasValue) {
+      options.grid = static_cast<uint8_t>(atoi(argv[++i]));
+    } else if (arg == "-w" && hasValue) {
+      options.wholeNote = static_cast<uint32_t>(atol(argv[++i]));
+    } else if (arg == "-t" && hasValue) {
+      options.track = atoi(argv[++i]);
+    } else if (arg == "-c" && hasValue) {
+      options.channel = atoi(argv[++i]);
+    } else if (arg == "-m" && hasValue && (strcmp(argv[i + 1], "high") == 0 || strcmp(argv[i + 1], "low") == 0)) {
+      options.isLowest = strcmp(argv[++i], "low") == 0;
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      files.clear();
+      break;
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty() || options.grid < 3 || options.grid > 7 || (options.channel != -1 && (options.channel < 1 || options.channel > 16))) {
+    fprintf(stderr, "usage: %s [-H out.h] [-q grid 3-7] [-w whole_ms] [-t track] [-c channel 1-16] [-m high|low] file ...\n", argv[0]);
+    return 2;
+  }
+  for (const char* path : files) importFile(melodies, totals, options, path);
+  bool ok = !headerPath || writeHeader(headerPath, melodies);
+  double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  printf("total melodies=%u failures=%u notes=%u source_bytes=%u packed_bytes=%u compact_bytes=%u elapsed_ms=%.2f\n", static_cast<unsigned>(totals.melodies),
+         static_cast<unsigned>(totals.failures), static_cast<unsigned>(totals.notes), static_cast<unsigned>(totals.sourceBytes),
+         static_cast<unsigned>(totals.packedBytes), static_cast<unsigned>(totals.compactBytes), elapsed);
+  return (ok && totals.failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,151 @@
+/**
+ * @file melody_trace.cpp
+ * @brief Timing-jitter tracer: plays melodies through updateMelody() built with SOUND_TRACE set, under a simulated
+ * busy main loop, and reports how late each note onset is against its schedule.
+ * Every loop pass takes a random time between 1 ms and the given latency (fake clock), like a sketch doing other
+ * work between updateMelody() calls. The statistics come from the library's own trace (SoundTrace), so they are
+ * what a board built with SOUND_TRACE would record.
+ *
+ * Build from the repository root:
+ *   g++ -O2 -std=gnu++11 -Isrc extras/tools/melody_trace.cpp -o melody_trace
+ * Usage:
+ *   melody_trace [-l latency] [-s seed] [-a] [-o trace.csv] [--builtin] [file ...]
+ *     -l latency  Longest main loop pass in ms (default 5).
+ *     -s seed     Seed of the loop pass times (default 1).
+ *     -a          Use MELODY_TIMING_ABSOLUTE instead of the default relative timing.
+ *     -o file     Write the onsets of every melody as CSV (hostWriteSoundTrace()), each after a "# name" line.
+ *     --builtin   Trace the RTTTL melodies of rtttl_PROGMEM_melodies.h.
+ *     file        Text file with one RTTTL string per line ("-" for stdin); empty lines and lines
+ *                 starting with '#' are skipped.
+ * Output: "name updates=U onsets=N min_ms=A max_ms=B mean_ms=M" per melody, then a summary line.
+ */
+
+#include <string>
+
+/** @brief Trace every onset of the longest melodies. */
+#define SOUND_TRACE 1
+#define SOUND_TRACE_EVENTS 255
+
+#include "sound_fun_rtttl.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+struct TraceOptions {
+  uint32_t latency = 5;
+  MelodyTiming timing = MELODY_TIMING_RELATIVE;
+  FILE* csv = nullptr;
+};
+
+struct TraceTotals {
+  size_t melodies = 0;
+  size_t failures = 0;
+  uint32_t onsets = 0;
+  uint32_t totalLateness = 0;
+  uint16_t maxLateness = 0;
+};
+
+static void traceRTTTL(const TraceOptions& options, TraceTotals& totals, const char* rtttl, bool isProgmem) {
+  std::string name;
+  for (char c; (c = readRTTTLChar(rtttl + name.size(), isProgmem)) && c != ':';) name += c;
+  totals.melodies++;
+  MelodyState state = MelodyState();
+  setMelodyTiming(state, options.timing);
+  hostSetMillis(0);
+  resetSoundTrace();
+  playRTTTLMelody(state, rtttl, isProgmem);
+  if (!state.isPlaying) {
+    totals.failures++;
+    printf("%s error=invalid_melody\n", name.c_str());
+    return;
+  }
+  while (state.isPlaying) {
+    updateMelody(state);
+    hostAdvanceMillis(1 + rand() % options.latency);
+  }
+  const SoundTraceStats& stats = soundTrace.stats;
+  printf("%s updates=%u onsets=%u min_ms=%u max_ms=%u mean_ms=%.2f\n", name.c_str(), static_cast<unsigned>(stats.updates),
+         static_cast<unsigned>(stats.onsets), stats.onsets ? stats.minLateness : 0, stats.maxLateness,
+         stats.onsets ? static_cast<double>(stats.totalLateness) / stats.onsets : 0.0);
+  totals.onsets += stats.onsets;
+  totals.totalLateness += stats.totalLateness;
+  if (stats.maxLateness > totals.maxLateness) totals.maxLateness = stats.maxLateness;
+  if (options.csv) {
+    fprintf(options.csv, "# %s\n", name.c_str());
+    hostWriteSoundTrace(options.csv);
+  }
+}
+
+static void traceBuiltin(const TraceOptions& options, TraceTotals& totals) {
+  traceRTTTL(options, totals, NOKIA, true);
+  traceRTTTL(options, totals, XFILES, true);
+  const char* const melodies[] = { MISSION_RTTTL, SIMPSONS_RTTTL, GADGET_RTTTL, CANON_RTTTL, SUPERMARIO_RTTTL };
+  for (const char* melody : melodies) traceRTTTL(options, totals, melody, false);
+}
+
+static bool traceFile(const TraceOptions& options, TraceTotals& totals, const char* path) {
+  FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string line;
+  int c;
+  while ((c = fgetc(file)) != EOF || !line.empty()) {
+    if (c != EOF && c != '\n') {
+      if (c != '\r') line += static_cast<char>(c);
+      continue;
+    }
+    if (!line.empty() && line[0] != '#') traceRTTTL(options, totals, line.c_str(), false);
+    line.clear();
+    if (c == EOF) break;
+  }
+  if (file != stdin) fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  TraceOptions options;
+  TraceTotals totals;
+  const char* csvPath = nullptr;
+  bool ok = true;
+  srand(1);
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-l" && i + 1 < argc) {
+      long latency = strtol(argv[++i], nullptr, 10);
+      options.latency = latency > 0 ? static_cast<uint32_t>(latency) : 1;
+    } else if (arg == "-s" && i + 1 < argc) {
+      srand(static_cast<unsigned>(strtoul(argv[++i], nullptr, 10)));
+    } else if (arg == "-a") {
+      options.timing = MELODY_TIMING_ABSOLUTE;
+    } else if (arg == "-o" && i + 1 < argc) {
+      csvPath = argv[++i];
+    } else if (arg == "--builtin" || (arg.size() > 1 && arg[0] == '-')) {
+      if (arg != "--builtin") {
+        fprintf(stderr, "usage: %s [-l latency] [-s seed] [-a] [-o trace.csv] [--builtin] [file ...]\n", argv[0]);
+        return 2;
+      }
+    }
+  }
+  if (csvPath && !(options.csv = fopen(csvPath, "w"))) {
+    fprintf(stderr, "cannot open %s\n", csvPath);
+    return 1;
+  }
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-l" || arg == "-s" || arg == "-o") {
+      i++;
+    } else if (arg == "--builtin") {
+      traceBuiltin(options, totals);
+    } else if (arg != "-a") {
+      ok = traceFile(options, totals, argv[i]) && ok;
+    }
+  }
+  if (options.csv) {
+    ok = !ferror(options.csv) && ok;
+    ok = (fclose(options.csv) == 0) && ok;
+  }
+  printf("total melodies=%u failures=%u latency_ms=%u onsets=%u max_lateness_ms=%u mean_lateness_ms=%.2f\n", static_cast<unsigned>(totals.melodies),
+         static_cast<unsigned>(totals.failures), static_cast<unsigned>(options.latency), static_cast<unsigned>(totals.onsets), totals.maxLateness,
+         totals.onsets ? static_cast<double>(totals.totalLateness) / totals.onsets : 0.0);
+  return (ok && totals.failures == 0) ? 0 : 1;
+}
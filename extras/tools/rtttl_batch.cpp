@@ -0,0 +1,441 @@
+/**
+ * @file rtttl_batch.cpp
+ * @brief Batch validator and compiler for RTTTL corpora.
+ * Every string is checked with checkRTTTL() (the strict rules of rtttl_compile.h), decoded with
+ * readRTTTLNote() and packed with packRTTTLNote(), so a string that passes plays the same on the board.
+ * Strings are spread over all cores: each worker owns a range of the corpus and, when it runs out,
+ * steals the second half of the largest remaining range. Results are printed in input order.
+ *
+ * Build from the repository root:
+ *   g++ -O2 -std=gnu++11 -pthread -Isrc extras/tools/rtttl_batch.cpp -o rtttl_batch
+ * Usage:
+ *   rtttl_batch [-j threads] [-q] [-N normalized.txt] [-b out.bin] [-H out.h] [-C catalog.h] file ...
+ *     -j threads  Number of worker threads (default: all cores).
+ *     -q          Only print errors, warnings and the summary.
+ *     -N file     Write the valid strings in normalized form (d= and o= set to the most used values,
+ *                 lower-case notes, no redundant fields).
+ *     -b file     Write the packed image of every valid string, concatenated (little-endian words).
+ *     -H file     Write the packed images as PROGMEM arrays for playPackedMelody(..., true).
+ *     -C file     Write the packed images and a MELODY_CATALOG sorted by name, with note count and
+ *                 duration of each melody, for findCatalogMelody() (melody_catalog.h).
+ *     file        Text file with one RTTTL string per line ("-" for stdin); empty lines and lines
+ *                 starting with '#' are skipped.
+ * Output: "file:line name notes=N ms=T hz=MIN-MAX" per valid string, "file:line:column: error: ..."
+ * per invalid string, then a summary line with the throughput.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sound_fun_rtttl.h"
+#include "melody_catalog.h"
+
+struct BatchItem {
+  const char* file;
+  size_t line;
+  std::string text;
+};
+
+struct BatchResult {
+  RTTTLStatus status;
+  size_t errorOffset;
+  std::string name;
+  std::vector<uint16_t> packed;  // Packed image, header words included.
+  uint32_t totalMs;
+  uint16_t minFrequency;
+  uint16_t maxFrequency;
+  std::string normalized;
+};
+
+/** Range [next, end) of the corpus still to be processed by one worker. */
+struct WorkRange {
+  std::mutex lock;
+  size_t next;
+  size_t end;
+};
+
+static const char* statusName(RTTTLStatus status) {
+  switch (status) {
+    case RTTTL_OK: return "ok";
+    case RTTTL_MISSING_CONTROL_SECTION: return "missing_control_section";
+    case RTTTL_INVALID_SETTING: return "invalid_setting";
+    case RTTTL_INVALID_BPM: return "invalid_bpm";
+    case RTTTL_INVALID_DURATION: return "invalid_duration";
+    case RTTTL_INVALID_NOTE: return "invalid_note";
+    case RTTTL_INVALID_OCTAVE: return "invalid_octave";
+    case RTTTL_UNEXPECTED_CHARACTER: return "unexpected_character";
+    case RTTTL_NO_NOTES: return "no_notes";
+  }
+  return "unknown";
+}
+
+static std::string trim(const std::string& text) {
+  size_t begin = text.find_first_not_of(" \t");
+  if (begin == std::string::npos) return std::string();
+  return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+/**
+ * Rewrite a valid string with the most used divider and octave as defaults, so that every note
+ * carries only the fields that differ from them. The tempo is kept, so the packed image is unchanged.
+ */
+static std::string normalize(const std::string& name, const RTTTLHeader& header, const std::vector<RTTTLNote>& notes) {
+  static const char* const NOTE_NAMES[NOTES_PER_OCTAVE] = { "c", "c#", "d", "d#", "e", "f", "f#", "g", "g#", "a", "a#", "b" };
+  size_t dividerCount[33] = { 0 };
+  size_t octaveCount[PACKED_MAX_OCTAVE + 1] = { 0 };
+  for (const RTTTLNote& note : notes) {
+    dividerCount[note.divider]++;
+    if (note.noteIndex < NOTES_PER_OCTAVE) octaveCount[note.octave]++;
+  }
+  uint8_t divider = 4;
+  for (uint8_t d = 1; d <= 32; d *= 2) {
+    if (dividerCount[d] > dividerCount[divider]) divider = d;
+  }
+  uint8_t octave = 6;
+  for (uint8_t o = 0; o <= PACKED_MAX_OCTAVE; o++) {
+    if (octaveCount[o] > octaveCount[octave]) octave = o;
+  }
+
+  char buffer[24];
+  snprintf(buffer, sizeof(buffer), ":d=%u,o=%u,b=%u:", divider, octave, header.bpm);
+  std::string text = name + buffer;
+  for (size_t i = 0; i < notes.size(); i++) {
+    const RTTTLNote& note = notes[i];
+    if (i > 0) text += ',';
+    if (note.divider != divider) text += std::to_string(note.divider);
+    bool isPause = note.noteIndex >= NOTES_PER_OCTAVE;
+    text += isPause ? "p" : NOTE_NAMES[note.noteIndex];
+    if (!isPause && note.octave != octave) text += static_cast<char>('0' + note.octave);
+    if (note.isDotted) text += '.';
+  }
+  return text;
+}
+
+static void processItem(const BatchItem& item, BatchResult& result, bool wantNormalized) {
+  const char* rtttl = item.text.c_str();
+  size_t noteCount = 0;
+  result.status = checkRTTTL(rtttl, false, result.errorOffset, noteCount);
+  result.name = trim(item.text.substr(0, item.text.find(':')));
+  if (result.status != RTTTL_OK) {
+    return;
+  }
+
+  RTTTLHeader header;
+  const char* cursor = rtttl;
+  parseRTTTLHeader(cursor, false, header);
+  std::vector<RTTTLNote> notes;
+  notes.reserve(noteCount);
+  result.packed.assign(PACKED_HEADER_WORDS, 0);
+  result.packed[0] = static_cast<uint16_t>(header.wholeNote);
+  result.totalMs = 0;
+  result.minFrequency = UINT16_MAX;
+  result.maxFrequency = 0;
+  RTTTLNote note;
+  uint16_t word;
+  while (readRTTTLNote(cursor, false, header, note) && packRTTTLNote(note, word)) {
+    notes.push_back(note);
+    result.packed.push_back(word);
+    result.totalMs += packedNoteDuration(word, header.wholeNote);
+    uint16_t frequency = packedNoteFrequency(word);
+    if (frequency != PAUSE) {
+      result.minFrequency = std::min(result.minFrequency, frequency);
+      result.maxFrequency = std::max(result.maxFrequency, frequency);
+    }
+  }
+  result.packed[1] = static_cast<uint16_t>(notes.size());
+  if (wantNormalized) result.normalized = normalize(result.name, header, notes);
+}
+
+/** Take the next item of a worker's own range, or steal half of the largest other range. */
+static bool takeItem(std::vector<WorkRange>& ranges, size_t self, size_t& index, size_t& steals) {
+  {
+    std::lock_guard<std::mutex> guard(ranges[self].lock);
+    if (ranges[self].next < ranges[self].end) {
+      index = ranges[self].next++;
+      return true;
+    }
+  }
+  while (true) {
+    size_t victim = self;
+    size_t largest = 0;
+    for (size_t i = 0; i < ranges.size(); i++) {
+      std::lock_guard<std::mutex> guard(ranges[i].lock);
+      if (ranges[i].end - ranges[i].next > largest) {
+        largest = ranges[i].end - ranges[i].next;
+        victim = i;
+      }
+    }
+    if (largest == 0) return false;
+    size_t begin, end;
+    {
+      std::lock_guard<std::mutex> guard(ranges[victim].lock);
+      size_t remaining = ranges[victim].end - ranges[victim].next;
+      if (remaining == 0) continue;  // Emptied since it was measured.
+      end = ranges[victim].end;
+      begin = end - (remaining + 1) / 2;
+      ranges[victim].end = begin;
+    }
+    steals++;
+    std::lock_guard<std::mutex> guard(ranges[self].lock);
+    ranges[self].next = begin + 1;
+    ranges[self].end = end;
+    index = begin;
+    return true;
+  }
+}
+
+static size_t runWorkers(const std::vector<BatchItem>& items, std::vector<BatchResult>& results, unsigned threads, bool wantNormalized) {
+  std::vector<WorkRange> ranges(threads);
+  for (unsigned i = 0; i < threads; i++) {
+    ranges[i].next = items.size() * i / threads;
+    ranges[i].end = items.size() * (i + 1) / threads;
+  }
+  std::vector<size_t> steals(threads, 0);
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back([&, i]() {
+      size_t index;
+      while (takeItem(ranges, i, index, steals[i])) processItem(items[index], results[index], wantNormalized);
+    });
+  }
+  size_t total = 0;
+  for (unsigned i = 0; i < threads; i++) {
+    workers[i].join();
+    total += steals[i];
+  }
+  return total;
+}
+
+static bool loadFile(const char* path, std::vector<BatchItem>& items) {
+  FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string line;
+  size_t lineNumber = 0;
+  int c;
+  while ((c = fgetc(file)) != EOF || !line.empty()) {
+    if (c != EOF && c != '\n') {
+      if (c != '\r') line += static_cast<char>(c);
+      continue;
+    }
+    lineNumber++;
+    if (!trim(line).empty() && line[0] != '#') items.push_back(BatchItem{ path, lineNumber, line });
+    line.clear();
+    if (c == EOF) break;
+  }
+  if (file != stdin) fclose(file);
+  return true;
+}
+
+/** C identifier for the array of a melody, unique within one header. */
+static std::string arrayName(const std::string& name, std::vector<std::string>& used) {
+  std::string base;
+  for (char c : name) base += isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(toupper(static_cast<unsigned char>(c))) : '_';
+  if (base.empty() || isdigit(static_cast<unsigned char>(base[0]))) base = "MELODY_" + base;
+  std::string candidate = base + "_PACKED";
+  for (unsigned n = 2; std::find(used.begin(), used.end(), candidate) != used.end(); n++) {
+    candidate = base + "_" + std::to_string(n) + "_PACKED";
+  }
+  used.push_back(candidate);
+  return candidate;
+}
+
+/** Name as a C string literal, cut to fit the name field of a catalog entry. */
+static std::string catalogName(const std::string& name) {
+  std::string literal = "\"";
+  for (size_t i = 0; i < name.size() && i < MELODY_CATALOG_NAME_SIZE - 1; i++) {
+    char c = name[i];
+    if (c == '"' || c == '\\') literal += '\\';
+    literal += isprint(static_cast<unsigned char>(c)) ? c : '_';
+  }
+  return literal + "\"";
+}
+
+/**
+ * Write the valid melodies as a catalog header: one packed array per melody, then the entries sorted
+ * with the case-insensitive order of compareCatalogName(). Names that clash once cut are skipped.
+ */
+static bool writeCatalog(FILE* file, const std::vector<BatchItem>& items, const std::vector<BatchResult>& results) {
+  std::vector<size_t> order;
+  for (size_t i = 0; i < results.size(); i++) {
+    if (results[i].status == RTTTL_OK) order.push_back(i);
+  }
+  auto key = [&](size_t i) {
+    std::string name = results[i].name.substr(0, MELODY_CATALOG_NAME_SIZE - 1);
+    for (char& c : name) c = isprint(static_cast<unsigned char>(c)) ? static_cast<char>(tolower(static_cast<unsigned char>(c))) : '_';
+    return name;
+  };
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key(a) < key(b); });
+
+  fprintf(file, "// Melody catalog generated by rtttl_batch. Play with playCatalogMelody(state, MELODY_CATALOG, MELODY_CATALOG_COUNT, name).\n\n");
+  fprintf(file, "#ifndef RTTTL_BATCH_CATALOG_H\n#define RTTTL_BATCH_CATALOG_H\n\n#include \"melody_catalog.h\"\n");
+  std::vector<std::string> used;
+  std::vector<std::string> arrays(results.size());
+  std::vector<size_t> entries;
+  for (size_t n = 0; n < order.size(); n++) {
+    size_t i = order[n];
+    if (!entries.empty() && key(entries.back()) == key(i)) {
+      fprintf(stderr, "%s:%u: warning: catalog name \"%s\" already used, melody skipped\n", items[i].file, static_cast<unsigned>(items[i].line),
+              results[i].name.c_str());
+      continue;
+    }
+    entries.push_back(i);
+    arrays[i] = arrayName(results[i].name, used);
+    fprintf(file, "\n// %s:%u\nconst uint16_t %s[] PROGMEM = {", items[i].file, static_cast<unsigned>(items[i].line), arrays[i].c_str());
+    for (size_t w = 0; w < results[i].packed.size(); w++) {
+      fprintf(file, "%s0x%04x", w == 0 ? " " : (w % 12 == 0 ? ",\n  " : ", "), results[i].packed[w]);
+    }
+    fprintf(file, " };\n");
+  }
+  fprintf(file, "\nconstexpr MelodyCatalogEntry MELODY_CATALOG[] PROGMEM = {\n");
+  for (size_t i : entries) {
+    fprintf(file, "  { %s, %s, %uUL, %u, CATALOG_FORMAT_PACKED },\n", catalogName(results[i].name).c_str(), arrays[i].c_str(), results[i].totalMs,
+            static_cast<unsigned>(results[i].packed.size() - PACKED_HEADER_WORDS));
+  }
+  fprintf(file, "};\nMELODY_CATALOG_CHECK(MELODY_CATALOG);\n\nconst size_t MELODY_CATALOG_COUNT = %u;\n\n#endif\n", static_cast<unsigned>(entries.size()));
+  return !ferror(file);
+}
+
+static bool writeOutputs(const std::vector<BatchItem>& items, const std::vector<BatchResult>& results, const char* normalizedPath,
+                         const char* binaryPath, const char* headerPath, const char* catalogPath) {
+  bool ok = true;
+  if (normalizedPath) {
+    FILE* file = fopen(normalizedPath, "w");
+    if (file) {
+      for (const BatchResult& result : results) {
+        if (result.status == RTTTL_OK) fprintf(file, "%s\n", result.normalized.c_str());
+      }
+      ok = !ferror(file) && ok;
+      fclose(file);
+    } else {
+      ok = false;
+    }
+  }
+  if (binaryPath) {
+    FILE* file = fopen(binaryPath, "wb");
+    if (file) {
+      for (const BatchResult& result : results) {
+        for (uint16_t word : result.packed) {
+          fputc(word & 0xFF, file);
+          fputc(word >> 8, file);
+        }
+      }
+      ok = !ferror(file) && ok;
+      fclose(file);
+    } else {
+      ok = false;
+    }
+  }
+  if (headerPath) {
+    FILE* file = fopen(headerPath, "w");
+    if (file) {
+      fprintf(file, "// Packed melody images generated by rtttl_batch. Play with playPackedMelody(state, NAME_PACKED, true).\n\n");
+      fprintf(file, "#ifndef RTTTL_BATCH_MELODIES_H\n#define RTTTL_BATCH_MELODIES_H\n\n#include \"sound_fun_rtttl.h\"\n");
+      std::vector<std::string> used;
+      for (size_t i = 0; i < results.size(); i++) {
+        const BatchResult& result = results[i];
+        if (result.status != RTTTL_OK) continue;
+        fprintf(file, "\n// %s:%u\nconst uint16_t %s[] PROGMEM = {", items[i].file, static_cast<unsigned>(items[i].line),
+                arrayName(result.name, used).c_str());
+        for (size_t w = 0; w < result.packed.size(); w++) {
+          fprintf(file, "%s0x%04x", w == 0 ? " " : (w % 12 == 0 ? ",\n  " : ", "), result.packed[w]);
+        }
+        fprintf(file, " };\n");
+      }
+      fprintf(file, "\n#endif\n");
+      ok = !ferror(file) && ok;
+      fclose(file);
+    } else {
+      ok = false;
+    }
+  }
+  if (catalogPath) {
+    FILE* file = fopen(catalogPath, "w");
+    if (file) {
+      ok = writeCatalog(file, items, results) && ok;
+      fclose(file);
+    } else {
+      ok = false;
+    }
+  }
+  if (!ok) fprintf(stderr, "cannot write output files\n");
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  bool quiet = false;
+  const char* normalizedPath = nullptr;
+  const char* binaryPath = nullptr;
+  const char* headerPath = nullptr;
+  const char* catalogPath = nullptr;
+  std::vector<BatchItem> items;
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      long count = strtol(argv[++i], nullptr, 10);
+      if (count < 1 || count > 1024) {
+        fprintf(stderr, "thread count must be 1..1024\n");
+        return 2;
+      }
+      threads = static_cast<unsigned>(count);
+    } else if (arg == "-q") {
+      quiet = true;
+    } else if (arg == "-N" && i + 1 < argc) {
+      normalizedPath = argv[++i];
+    } else if (arg == "-b" && i + 1 < argc) {
+      binaryPath = argv[++i];
+    } else if (arg == "-H" && i + 1 < argc) {
+      headerPath = argv[++i];
+    } else if (arg == "-C" && i + 1 < argc) {
+      catalogPath = argv[++i];
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "usage: %s [-j threads] [-q] [-N normalized.txt] [-b out.bin] [-H out.h] [-C catalog.h] file ...\n", argv[0]);
+      return 2;
+    } else {
+      ok = loadFile(argv[i], items) && ok;
+    }
+  }
+
+  std::vector<BatchResult> results(items.size());
+  auto start = std::chrono::steady_clock::now();
+  size_t steals = runWorkers(items, results, threads, normalizedPath != nullptr);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  size_t bytes = 0;
+  size_t invalid = 0;
+  size_t notes = 0;
+  for (size_t i = 0; i < items.size(); i++) {
+    const BatchItem& item = items[i];
+    const BatchResult& result = results[i];
+    bytes += item.text.size();
+    if (result.status != RTTTL_OK) {
+      invalid++;
+      printf("%s:%u:%u: error: %s in \"%s\"\n", item.file, static_cast<unsigned>(item.line), static_cast<unsigned>(result.errorOffset + 1),
+             statusName(result.status), result.name.c_str());
+      continue;
+    }
+    size_t count = result.packed.size() - PACKED_HEADER_WORDS;
+    notes += count;
+    if (count > MAX_RTTTL_NOTES) {
+      printf("%s:%u: warning: %u notes, parseRTTTL() and playRTTTLMelody() keep only MAX_RTTTL_NOTES (%u)\n", item.file,
+             static_cast<unsigned>(item.line), static_cast<unsigned>(count), MAX_RTTTL_NOTES);
+    }
+    if (!quiet) {
+      printf("%s:%u %s notes=%u ms=%u hz=%u-%u\n", item.file, static_cast<unsigned>(item.line), result.name.c_str(), static_cast<unsigned>(count),
+             result.totalMs, result.maxFrequency ? result.minFrequency : 0, result.maxFrequency);
+    }
+  }
+  ok = writeOutputs(items, results, normalizedPath, binaryPath, headerPath, catalogPath) && ok;
+  printf("total strings=%u valid=%u invalid=%u notes=%u mb=%.2f threads=%u steals=%u wall_s=%.3f mb_per_s=%.1f\n",
+         static_cast<unsigned>(items.size()), static_cast<unsigned>(items.size() - invalid), static_cast<unsigned>(invalid),
+         static_cast<unsigned>(notes), bytes / 1e6, threads, static_cast<unsigned>(steals), seconds, seconds > 0 ? bytes / seconds / 1e6 : 0.0);
+  return (ok && invalid == 0) ? 0 : 1;
+}
@@ -0,0 +1,220 @@
+/**
+ * @file rtttl_render.cpp
+ * @brief Offline renderer: plays melodies through the library on the host and writes 16-bit mono WAV files.
+ * Each melody runs through the real playback code (updateMelody() on a SynthVoiceOutput, fake clock),
+ * jumping from one nextDeadline() to the next, and the audio between deadlines is rendered in one
+ * renderSynth() block (SIMD square-wave kernel). Every rendering gets a checksum so a corpus can be diffed.
+ *
+ * Build from the repository root:
+ *   g++ -O2 -std=gnu++11 -Isrc extras/tools/rtttl_render.cpp -o rtttl_render
+ * Usage:
+ *   rtttl_render [-r rate] [-o dir] [-n] [--builtin] [file ...]
+ *     -r rate     Sample rate in Hz (default 22050, max 65535).
+ *     -o dir      Directory for the WAV files (default: current directory).
+ *     -n          Do not write WAV files, only print checksums.
+ *     --builtin   Render the melodies of melodies.h and rtttl_PROGMEM_melodies.h.
+ *     file        Text file with one RTTTL string per line ("-" for stdin).
+ * Output: one line per melody "name notes=N ms=T samples=S fnv1a=XXXXXXXX", then a summary line. RTTTL strings
+ * are checked with checkRTTTL() first; one that fails is reported as "name error=invalid_melody" and skipped.
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "sound_fun_rtttl.h"
+#include "sound_synth.h"
+#include "melodies.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+/** @brief Amplitude of the rendered square wave (16-bit PCM). */
+#define RENDER_LEVEL 8000
+
+struct RenderOptions {
+  uint16_t sampleRate = 22050;
+  std::string outputDir = ".";
+  bool writeWav = true;
+};
+
+struct RenderTotals {
+  size_t melodies = 0;
+  size_t failures = 0;
+  uint64_t samples = 0;
+};
+
+static uint32_t fnv1a(const int16_t* samples, size_t count) {
+  uint32_t hash = 2166136261u;
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(samples);
+  for (size_t i = 0; i < count * sizeof(int16_t); i++) {
+    hash = (hash ^ bytes[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static void putLE(FILE* file, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) fputc((value >> (8 * i)) & 0xFF, file);
+}
+
+static bool writeWav(const std::string& path, const std::vector<int16_t>& pcm, uint16_t sampleRate) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) return false;
+  uint32_t dataBytes = static_cast<uint32_t>(pcm.size() * sizeof(int16_t));
+  fputs("RIFF", file);
+  putLE(file, 36 + dataBytes, 4);
+  fputs("WAVEfmt ", file);
+  putLE(file, 16, 4);              // fmt chunk size
+  putLE(file, 1, 2);               // PCM
+  putLE(file, 1, 2);               // mono
+  putLE(file, sampleRate, 4);
+  putLE(file, sampleRate * 2u, 4); // byte rate
+  putLE(file, 2, 2);               // block align
+  putLE(file, 16, 2);              // bits per sample
+  fputs("data", file);
+  putLE(file, dataBytes, 4);
+  for (int16_t sample : pcm) putLE(file, static_cast<uint16_t>(sample), 2);
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+/**
+ * Run a melody that has just been started on voice 0 to its end and render it.
+ * The clock jumps from one deadline to the next; all samples up to a deadline are rendered before
+ * updateMelody() changes the voice.
+ */
+static void renderMelody(MelodyState& state, SynthEngine& engine, SynthVoiceOutput& voice, std::vector<int16_t>& pcm, size_t& notes) {
+  uint64_t rendered = 0;
+  auto renderUntil = [&](uint32_t ms) {
+    uint64_t target = static_cast<uint64_t>(ms) * engine.sampleRate / 1000;
+    if (target <= rendered) return;
+    pcm.resize(target);
+    renderSynth(engine, pcm.data() + rendered, target - rendered);
+    rendered = target;
+  };
+  notes = state.isPlaying ? 1 : 0;
+  uint32_t deadline;
+  while (nextDeadline(state, deadline)) {
+    renderUntil(deadline);
+    hostSetMillis(deadline);
+    size_t noteBefore = state.currentNote;
+    const char* cursorBefore = state.rtttlCursor;
+    updateMelody(voice, state);
+    if (state.isPlaying && (state.currentNote != noteBefore || state.rtttlCursor != cursorBefore)) notes++;
+  }
+  renderUntil(hostMillis);
+}
+
+static std::string fileName(size_t index, const std::string& name) {
+  std::string clean;
+  for (char c : name) clean += (isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_') ? c : '_';
+  char prefix[16];
+  snprintf(prefix, sizeof(prefix), "%04u_", static_cast<unsigned>(index));
+  return prefix + (clean.empty() ? std::string("melody") : clean) + ".wav";
+}
+
+static void finishMelody(const RenderOptions& options, RenderTotals& totals, const std::string& name, MelodyState& state,
+                         SynthEngine& engine, SynthVoiceOutput& voice) {
+  size_t index = totals.melodies++;
+  if (!state.isPlaying) {
+    totals.failures++;
+    printf("%s error=invalid_melody\n", name.c_str());
+    return;
+  }
+  std::vector<int16_t> pcm;
+  size_t notes = 0;
+  renderMelody(state, engine, voice, pcm, notes);
+  totals.samples += pcm.size();
+  printf("%s notes=%u ms=%u samples=%u fnv1a=%08x\n", name.c_str(), static_cast<unsigned>(notes), hostMillis,
+         static_cast<unsigned>(pcm.size()), fnv1a(pcm.data(), pcm.size()));
+  if (options.writeWav && !writeWav(options.outputDir + "/" + fileName(index, name), pcm, engine.sampleRate)) {
+    totals.failures++;
+    fprintf(stderr, "cannot write %s\n", fileName(index, name).c_str());
+  }
+}
+
+static void renderRTTTL(const RenderOptions& options, RenderTotals& totals, const std::string& rtttl) {
+  SynthEngine engine;
+  initSynth(engine, options.sampleRate, RENDER_LEVEL);
+  SynthVoiceOutput voice = { &engine, 0 };
+  MelodyState state = MelodyState();
+  hostSetMillis(0);
+  size_t errorOffset = 0;
+  size_t noteCount = 0;
+  if (checkRTTTL(rtttl.c_str(), false, errorOffset, noteCount) == RTTTL_OK) playRTTTLMelodyStreaming(voice, state, rtttl.c_str());
+  finishMelody(options, totals, rtttl.substr(0, rtttl.find(':')), state, engine, voice);
+}
+
+static void renderArrays(const RenderOptions& options, RenderTotals& totals, const char* name, const ToneFrequency* melody,
+                         const ToneDuration* durations, size_t length) {
+  SynthEngine engine;
+  initSynth(engine, options.sampleRate, RENDER_LEVEL);
+  SynthVoiceOutput voice = { &engine, 0 };
+  MelodyState state = MelodyState();
+  hostSetMillis(0);
+  playMelody(voice, state, const_cast<ToneFrequency*>(melody), const_cast<ToneDuration*>(durations), length);
+  finishMelody(options, totals, name, state, engine, voice);
+}
+
+static void renderBuiltin(const RenderOptions& options, RenderTotals& totals) {
+  renderArrays(options, totals, "twinkle", twinkleMelody, twinkleDurations, TWINKLE_MELODY_LENGTH);
+  renderArrays(options, totals, "flightOfTheBumblebee", flightOfTheBumblebeeMelody, flightOfTheBumblebeeDurations,
+               sizeof(flightOfTheBumblebeeMelody) / sizeof(flightOfTheBumblebeeMelody[0]));
+  renderArrays(options, totals, "r2d2", r2d2Melody, r2d2Durations, sizeof(r2d2Melody) / sizeof(r2d2Melody[0]));
+  renderRTTTL(options, totals, NOKIA);
+  renderRTTTL(options, totals, XFILES);
+}
+
+static bool renderFile(const RenderOptions& options, RenderTotals& totals, const char* path) {
+  FILE* file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "cannot open %s\n", path);
+    return false;
+  }
+  std::string line;
+  int c;
+  while ((c = fgetc(file)) != EOF || !line.empty()) {
+    if (c != EOF && c != '\n') {
+      if (c != '\r') line += static_cast<char>(c);
+      continue;
+    }
+    if (!line.empty() && line[0] != '#') renderRTTTL(options, totals, line);
+    line.clear();
+    if (c == EOF) break;
+  }
+  if (file != stdin) fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  RenderOptions options;
+  RenderTotals totals;
+  auto start = std::chrono::steady_clock::now();
+  bool ok = true;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-r" && i + 1 < argc) {
+      long rate = strtol(argv[++i], nullptr, 10);
+      if (rate < 1000 || rate > 65535) {
+        fprintf(stderr, "sample rate must be 1000..65535 Hz\n");
+        return 2;
+      }
+      options.sampleRate = static_cast<uint16_t>(rate);
+    } else if (arg == "-o" && i + 1 < argc) {
+      options.outputDir = argv[++i];
+    } else if (arg == "-n") {
+      options.writeWav = false;
+    } else if (arg == "--builtin") {
+      renderBuiltin(options, totals);
+    } else if (arg.size() > 1 && arg[0] == '-') {
+      fprintf(stderr, "usage: %s [-r rate] [-o dir] [-n] [--builtin] [file ...]\n", argv[0]);
+      return 2;
+    } else {
+      ok = renderFile(options, totals, argv[i]) && ok;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double audioSeconds = static_cast<double>(totals.samples) / options.sampleRate;
+  printf("total melodies=%u failures=%u audio_s=%.1f wall_s=%.3f realtime_factor=%.0f\n", static_cast<unsigned>(totals.melodies),
+         static_cast<unsigned>(totals.failures), audioSeconds, seconds, seconds > 0 ? audioSeconds / seconds : 0.0);
+  return (ok && totals.failures == 0) ? 0 : 1;
+}
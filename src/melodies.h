@@ -2,6 +2,7 @@
 #define MELODIES_H
 
 #include "sound_fun_rtttl.h"
+#include "rtttl_compile.h"
 
 // Melodía 1: Twinkle Twinkle Little Star
 static const ToneFrequency twinkleMelody[] = {
@@ -80,4 +81,9 @@ static const ToneDuration r2d2Durations[] = {
 
 static const size_t R2D2_MELODY_LENGTH = sizeof(r2d2Melody) / sizeof(r2d2Melody[0]);
 
-#endif // MELODIES_H
\ No newline at end of file
+// Versiones empaquetadas en PROGMEM (2 bytes por nota), para playPackedMelody(state, TWINKLE_PACKED, true)
+PROGMEM_TONE_MELODY(TWINKLE_PACKED, twinkleMelody, twinkleDurations);
+PROGMEM_TONE_MELODY(FLIGHT_OF_THE_BUMBLEBEE_PACKED, flightOfTheBumblebeeMelody, flightOfTheBumblebeeDurations);
+PROGMEM_TONE_MELODY(R2D2_PACKED, r2d2Melody, r2d2Durations);
+
+#endif // MELODIES_H
\ No newline at end of file
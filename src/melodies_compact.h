@@ -0,0 +1,59 @@
+/**
+ * @file melodies_compact.h
+ * @brief Compact melody images generated by melody_compact (extras/tools).
+ * Play them with playCompactMelody(state, NAME_COMPACT, true); each note is decoded when it starts.
+ */
+
+#ifndef MELODIES_COMPACT_H
+#define MELODIES_COMPACT_H
+
+// TWINKLE: 15 bytes (packed: 32)
+const uint8_t TWINKLE_COMPACT[] PROGMEM = { 0x00, 0x00, 0x0e, 0x00, 0x24, 0x11, 0x88, 0xaa, 0xf3, 0x8f, 0x26, 0x65, 0x53, 0x3f, 0x31 };
+
+// FLIGHT_OF_THE_BUMBLEBEE: 26 bytes (packed: 68)
+const uint8_t FLIGHT_OF_THE_BUMBLEBEE_COMPACT[] PROGMEM = { 0x00, 0x00, 0x20, 0x00, 0x05, 0xa9, 0xa7, 0x95, 0x73, 0x52, 0x3c, 0x2a, 0xcf, 0x19, 0xf0, 0xa9,
+  0xa7, 0x95, 0x73, 0x51, 0x3b, 0x1e, 0x8d, 0xbf, 0x1e, 0x60 };
+
+// R2D2: 32 bytes (packed: 78)
+const uint8_t R2D2_COMPACT[] PROGMEM = { 0x00, 0x00, 0x25, 0x00, 0x06, 0x15, 0x80, 0x36, 0x53, 0x10, 0xf1, 0xea, 0xf0, 0xd6, 0xa0, 0x18,
+  0x30, 0xf1, 0xe8, 0xf0, 0xd1, 0x53, 0x0a, 0x68, 0x10, 0x53, 0x60, 0xae, 0xcd, 0x10, 0xf1, 0x80 };
+
+// NOKIA: 19 bytes (packed: 30)
+const uint8_t NOKIA_COMPACT[] PROGMEM = { 0x28, 0x04, 0x0d, 0x00, 0x36, 0x53, 0xf2, 0xe7, 0x9f, 0x3d, 0x2e, 0xcf, 0x23, 0x5f, 0x3c, 0xaf,
+  0x22, 0x5f, 0x1a };
+
+// XFILES: 53 bytes (packed: 92)
+const uint8_t XFILES_COMPACT[] PROGMEM = { 0x80, 0x07, 0x2c, 0x00, 0x25, 0x5c, 0xac, 0xd3, 0xf9, 0xec, 0xf0, 0x0f, 0x25, 0xca, 0xcd, 0x5f,
+  0x9e, 0xcf, 0x00, 0xf2, 0xd8, 0x75, 0x35, 0xf9, 0xec, 0xf0, 0x0f, 0x2d, 0x87, 0x53, 0x7f, 0x9e,
+  0xcf, 0x00, 0xf2, 0x5c, 0xac, 0xd3, 0xf9, 0xec, 0xf0, 0x0f, 0x25, 0xca, 0xcd, 0x5f, 0x9e, 0xcf,
+  0x00, 0xf2, 0xd5, 0xf9, 0xec };
+
+// MISSION: 87 bytes (packed: 154)
+const uint8_t MISSION_COMPACT[] PROGMEM = { 0xdc, 0x09, 0x4b, 0x00, 0x56, 0x34, 0x34, 0x34, 0x34, 0x33, 0x45, 0x67, 0x8f, 0x48, 0xf3, 0x0f,
+  0x48, 0xf3, 0x0f, 0x4b, 0x0d, 0x10, 0xe8, 0xf3, 0x0f, 0x48, 0xf3, 0x0f, 0x46, 0x07, 0x08, 0xf3,
+  0x0f, 0x48, 0xf3, 0x0f, 0x4b, 0x0d, 0x10, 0xe8, 0xf3, 0x0f, 0x48, 0xf3, 0x0f, 0x46, 0x07, 0x0b,
+  0x8f, 0x13, 0xf5, 0x0f, 0x4b, 0x8f, 0x12, 0xf5, 0x0f, 0x4b, 0x8f, 0x11, 0xf4, 0xeb, 0xf3, 0xd1,
+  0xf1, 0x0f, 0x50, 0xf4, 0xeb, 0x8f, 0x1d, 0x7f, 0x50, 0xf4, 0xeb, 0x8f, 0x1d, 0x6f, 0x50, 0xf4,
+  0xeb, 0x8f, 0x1d, 0x5f, 0x44, 0xf3, 0x30 };
+
+// SIMPSONS: 28 bytes (packed: 50)
+const uint8_t SIMPSONS_COMPACT[] PROGMEM = { 0xdc, 0x05, 0x17, 0x00, 0xa6, 0x1f, 0x25, 0x7f, 0x3a, 0xfa, 0x8f, 0x25, 0x1f, 0x3e, 0xa7, 0x77,
+  0xf1, 0x8f, 0x30, 0x07, 0x77, 0x8f, 0xab, 0xf3, 0xd1, 0x11, 0xf2, 0x10 };
+
+// GADGET: 27 bytes (packed: 60)
+const uint8_t GADGET_COMPACT[] PROGMEM = { 0xc0, 0x12, 0x1c, 0x00, 0x55, 0x46, 0x79, 0xf4, 0xb7, 0xa6, 0x97, 0xf5, 0x46, 0x79, 0xf4, 0xbd,
+  0x4f, 0x23, 0xf5, 0xe4, 0x67, 0x9f, 0x4b, 0x7a, 0x69, 0x7f, 0x34 };
+
+// CANON: 56 bytes (packed: 116)
+const uint8_t CANON_COMPACT[] PROGMEM = { 0x80, 0x07, 0x38, 0x00, 0xb6, 0xbf, 0xc8, 0x9f, 0xbb, 0xfc, 0x89, 0xbe, 0xbd, 0x13, 0x46, 0x89,
+  0xfb, 0x8f, 0xc4, 0x6f, 0xb8, 0xfc, 0xe8, 0x9b, 0xd1, 0xeb, 0x9b, 0x89, 0xbf, 0xb9, 0xfc, 0xd1,
+  0xeb, 0xfb, 0x9f, 0xc8, 0x68, 0x64, 0x68, 0x9b, 0xd1, 0xfb, 0xe9, 0xfc, 0xd1, 0xeb, 0xfb, 0xd1,
+  0xfc, 0x34, 0xeb, 0xd1, 0x34, 0x68, 0x9f, 0x3b };
+
+// SUPERMARIO: 63 bytes (packed: 114)
+const uint8_t SUPERMARIO_COMPACT[] PROGMEM = { 0x80, 0x07, 0x37, 0x00, 0x25, 0xaf, 0xb6, 0xf4, 0x13, 0x60, 0xf2, 0x6f, 0x43, 0x10, 0x60, 0x60,
+  0xf3, 0xd1, 0xfb, 0xea, 0xf2, 0x8f, 0x41, 0xf2, 0xaf, 0xb6, 0xf4, 0x13, 0x60, 0xf2, 0x6f, 0x43,
+  0x10, 0x60, 0xba, 0x8f, 0x16, 0xf4, 0x0f, 0xba, 0x6f, 0x31, 0xfb, 0xaf, 0x26, 0xf4, 0x96, 0x10,
+  0xfb, 0x9f, 0x18, 0xfb, 0xa6, 0xf3, 0x1f, 0xba, 0xf2, 0x6f, 0x49, 0x6f, 0x31, 0xf1, 0xd1 };
+
+#endif  // MELODIES_COMPACT_H
@@ -0,0 +1,183 @@
+/**
+ * @file melody_catalog.h
+ * @brief Melody catalog: a name index in PROGMEM with precomputed note count and duration.
+ * Entries are sorted by name (case-insensitive), so a melody is found by binary search directly in flash,
+ * and its metadata is known without parsing anything. Build catalogs with the MELODY_CATALOG_* macros
+ * (checked at compile time) or generate them with rtttl_batch -C.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef MELODY_CATALOG_H
+#define MELODY_CATALOG_H
+
+#include "sound_fun_rtttl.h"
+#include "rtttl_compile.h"
+
+/** @brief Size of the name field of a catalog entry, terminator included. */
+#define MELODY_CATALOG_NAME_SIZE 16
+
+/**
+ * @brief Format of the melody data a catalog entry points at.
+ */
+enum MelodyCatalogFormat {
+  CATALOG_FORMAT_PACKED, /**< Packed melody image in PROGMEM, played with playPackedMelody(). */
+  CATALOG_FORMAT_RTTTL   /**< RTTTL string in PROGMEM, played in streaming mode. */
+};
+
+/**
+ * @brief One melody of a catalog (stored in PROGMEM).
+ */
+struct MelodyCatalogEntry {
+  char name[MELODY_CATALOG_NAME_SIZE]; /**< Lookup name. */
+  const void* data;                    /**< Packed image or RTTTL string in PROGMEM. */
+  uint32_t duration;                   /**< Sum of the note durations (ms). */
+  uint16_t noteCount;                  /**< Number of notes. */
+  uint8_t format;                      /**< MelodyCatalogFormat of data. */
+};
+
+namespace melody_catalog_detail {
+
+template <size_t N>
+constexpr uint32_t melodyDuration(const PackedMelody<N>& melody) {
+  return rtttl_compile_detail::sumDurations(melody.words, PACKED_HEADER_WORDS, PACKED_HEADER_WORDS + N);
+}
+
+/** Case-insensitive comparison of two names, like compareCatalogName(). */
+constexpr int compareNames(const char* a, const char* b, size_t i) {
+  return (rtttl_compile_detail::toLower(a[i]) != rtttl_compile_detail::toLower(b[i]) || a[i] == '\0')
+             ? rtttl_compile_detail::toLower(a[i]) - rtttl_compile_detail::toLower(b[i])
+             : compareNames(a, b, i + 1);
+}
+
+/** Whether the names of entries[begin, end) are strictly increasing. */
+constexpr bool isSorted(const MelodyCatalogEntry* entries, size_t begin, size_t end) {
+  return end - begin < 2 ? true
+         : end - begin == 2 ? compareNames(entries[begin].name, entries[begin + 1].name, 0) < 0
+         : isSorted(entries, begin, begin + (end - begin) / 2 + 1) && isSorted(entries, begin + (end - begin) / 2, end);
+}
+
+}  // namespace melody_catalog_detail
+
+/**
+ * @brief Catalog entry for a compiled melody (PROGMEM_RTTTL, PROGMEM_TONE_MELODY); metadata is computed at compile time.
+ * Example: MELODY_CATALOG_PACKED("Nokia", NOKIA_PACKED)
+ */
+#define MELODY_CATALOG_PACKED(name, melody) \
+  { name, (melody).words, melody_catalog_detail::melodyDuration(melody), static_cast<uint16_t>(sizeof((melody).words) / sizeof(uint16_t) - PACKED_HEADER_WORDS), CATALOG_FORMAT_PACKED }
+
+/**
+ * @brief Catalog entry for an RTTTL string in PROGMEM; text is the same string as a literal, used for the metadata.
+ * Example: MELODY_CATALOG_RTTTL("Nokia", NOKIA, NOKIA_RTTTL)
+ */
+#define MELODY_CATALOG_RTTTL(name, rtttl, text) \
+  { name, rtttl, melody_catalog_detail::melodyDuration(RTTTL_COMPILE(text)), static_cast<uint16_t>(rtttl_compile_detail::countNotes(text)), CATALOG_FORMAT_RTTTL }
+
+/**
+ * @brief Stop the build unless the names of a constexpr catalog are unique and sorted (case-insensitive).
+ */
+#define MELODY_CATALOG_CHECK(entries) \
+  static_assert(melody_catalog_detail::isSorted(entries, 0, sizeof(entries) / sizeof((entries)[0])), "melody catalog names must be unique and sorted")
+
+/**
+ * @brief Compare a name with the name of a catalog entry, ignoring case.
+ * @param name The name to look for (RAM).
+ * @param entryName The name field of a catalog entry (PROGMEM).
+ * @return Negative, zero or positive if name sorts before, equal to or after entryName.
+ */
+int compareCatalogName(const char* name, const char* entryName) {
+  for (uint8_t i = 0; i < MELODY_CATALOG_NAME_SIZE; i++) {
+    char a = tolower(name[i]);
+    char b = tolower(static_cast<char>(pgm_read_byte(entryName + i)));
+    if (a != b || a == '\0') return a - b;
+  }
+  return 0;
+}
+
+/**
+ * @brief Copy one entry of a catalog from PROGMEM.
+ * @param catalog The catalog entries (PROGMEM).
+ * @param count The number of entries.
+ * @param index Index of the entry (entries are in name order).
+ * @param entry Structure to store the entry.
+ * @return True if index is within the catalog.
+ */
+bool readCatalogEntry(const MelodyCatalogEntry* catalog, size_t count, size_t index, MelodyCatalogEntry& entry) {
+  if (!catalog || index >= count) {
+    return false;
+  }
+  memcpy_P(&entry, &catalog[index], sizeof(entry));
+  return true;
+}
+
+/**
+ * @brief Find a melody by name (case-insensitive) with a binary search in PROGMEM.
+ * @param catalog The catalog entries (PROGMEM), sorted by name.
+ * @param count The number of entries.
+ * @param name The name to look for.
+ * @param entry Structure to store the entry found.
+ * @return True if the melody was found, false otherwise (entry is left unchanged).
+ */
+bool findCatalogMelody(const MelodyCatalogEntry* catalog, size_t count, const char* name, MelodyCatalogEntry& entry) {
+  if (!catalog || !name) {
+    return false;
+  }
+  size_t low = 0;
+  size_t high = count;
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    int order = compareCatalogName(name, catalog[mid].name);
+    if (order == 0) {
+      return readCatalogEntry(catalog, count, mid, entry);
+    }
+    if (order < 0) high = mid;
+    else low = mid + 1;
+  }
+  return false;
+}
+
+/**
+ * @brief Play a catalog melody (non-blocking) with optional repeats.
+ * Packed images play without any parsing; RTTTL strings play in streaming mode. Nothing is allocated.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param entry The entry from findCatalogMelody() or readCatalogEntry().
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ * @return True if the melody started.
+ */
+template <typename Output>
+bool playCatalogMelody(Output& output, MelodyState& state, const MelodyCatalogEntry& entry, uint8_t repeatCount = 1) {
+  if (entry.format == CATALOG_FORMAT_PACKED) {
+    playPackedMelody(output, state, static_cast<const uint16_t*>(entry.data), true, repeatCount);
+  } else {
+    playRTTTLMelodyStreaming(output, state, static_cast<const char*>(entry.data), true, repeatCount);
+  }
+  return state.isPlaying;
+}
+
+/**
+ * @brief Same as playCatalogMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+bool playCatalogMelody(MelodyState& state, const MelodyCatalogEntry& entry, uint8_t repeatCount = 1) {
+  SpeakerOutput output;
+  return playCatalogMelody(output, state, entry, repeatCount);
+}
+
+/**
+ * @brief Find a melody by name and play it (non-blocking).
+ * @param state The MelodyState structure to manage the melody.
+ * @param catalog The catalog entries (PROGMEM), sorted by name.
+ * @param count The number of entries.
+ * @param name The name of the melody (case-insensitive).
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ * @return True if the melody was found and started.
+ */
+bool playCatalogMelody(MelodyState& state, const MelodyCatalogEntry* catalog, size_t count, const char* name, uint8_t repeatCount = 1) {
+  MelodyCatalogEntry entry;
+  return findCatalogMelody(catalog, count, name, entry) && playCatalogMelody(state, entry, repeatCount);
+}
+
+#endif  // MELODY_CATALOG_H
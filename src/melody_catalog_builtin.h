@@ -0,0 +1,32 @@
+/**
+ * @file melody_catalog_builtin.h
+ * @brief Catalog of the melodies shipped with the library, as packed images in PROGMEM.
+ * Example: playCatalogMelody(state, BUILTIN_MELODIES, BUILTIN_MELODY_COUNT, "nokia");
+ */
+
+#ifndef MELODY_CATALOG_BUILTIN_H
+#define MELODY_CATALOG_BUILTIN_H
+
+#include "melody_catalog.h"
+#include "melodies.h"
+#include "rtttl_compiled_melodies.h"
+
+/** @brief Built-in melodies, sorted by name. */
+constexpr MelodyCatalogEntry BUILTIN_MELODIES[] PROGMEM = {
+  MELODY_CATALOG_PACKED("Bumblebee", FLIGHT_OF_THE_BUMBLEBEE_PACKED),
+  MELODY_CATALOG_PACKED("Canon", CANON_PACKED),
+  MELODY_CATALOG_PACKED("Gadget", GADGET_PACKED),
+  MELODY_CATALOG_PACKED("MissionImp", MISSION_PACKED),
+  MELODY_CATALOG_PACKED("Nokia", NOKIA_PACKED),
+  MELODY_CATALOG_PACKED("R2D2", R2D2_PACKED),
+  MELODY_CATALOG_PACKED("Simpsons", SIMPSONS_PACKED),
+  MELODY_CATALOG_PACKED("SuperMario", SUPERMARIO_PACKED),
+  MELODY_CATALOG_PACKED("Twinkle", TWINKLE_PACKED),
+  MELODY_CATALOG_PACKED("Xfiles", XFILES_PACKED),
+};
+MELODY_CATALOG_CHECK(BUILTIN_MELODIES);
+
+/** @brief Number of entries in BUILTIN_MELODIES. */
+const size_t BUILTIN_MELODY_COUNT = sizeof(BUILTIN_MELODIES) / sizeof(BUILTIN_MELODIES[0]);
+
+#endif  // MELODY_CATALOG_BUILTIN_H
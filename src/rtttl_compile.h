@@ -0,0 +1,438 @@
+/**
+ * @file rtttl_compile.h
+ * @brief Compile-time RTTTL compiler and melody packer.
+ * Turns an RTTTL string literal, or ToneFrequency/ToneDuration arrays, into a packed melody image
+ * (see packNote()) while the sketch is compiled, so playback needs no parsing at all.
+ * Syntax errors in the literal and notes that cannot be packed stop the build.
+ * Written for C++11 constexpr (single-expression functions), as used by the AVR toolchain.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef RTTTL_COMPILE_H
+#define RTTTL_COMPILE_H
+
+#include "sound_fun_rtttl.h"
+
+/**
+ * @brief Packed melody image built at compile time.
+ * words[0] is the whole-note duration (ms) or PACKED_TONE_DURATIONS, words[1] the note count,
+ * followed by one packed note per word.
+ * @tparam N Number of notes.
+ */
+template <size_t N>
+struct PackedMelody {
+  uint16_t words[N + PACKED_HEADER_WORDS]; /**< Packed melody image. */
+};
+
+/**
+ * @brief Start times of the notes of a packed melody, built at compile time (see MelodyIndex).
+ * @tparam N Number of notes.
+ */
+template <size_t N>
+struct PackedMelodyIndex {
+  uint32_t starts[N + 1]; /**< Sum of the durations before each note (ms), then the length of the melody. */
+};
+
+namespace rtttl_compile_detail {
+
+// Error reporters. They are not constexpr, so reaching one during constant evaluation
+// stops the build with the function name in the compiler diagnostic.
+inline uint16_t RTTTL_ERROR_missing_control_section() { return 0; }
+inline uint16_t RTTTL_ERROR_invalid_bpm() { return 0; }
+inline uint16_t RTTTL_ERROR_invalid_duration() { return 0; }
+inline uint16_t RTTTL_ERROR_invalid_note() { return 0; }
+inline uint16_t RTTTL_ERROR_invalid_octave() { return 0; }
+inline uint16_t RTTTL_ERROR_unexpected_character() { return 0; }
+inline uint16_t PACK_ERROR_frequency_out_of_range() { return 0; }
+inline uint16_t PACK_ERROR_not_a_tone_duration() { return 0; }
+
+template <size_t... I>
+struct IndexList {};
+
+template <typename First, typename Second>
+struct JoinIndexLists;
+
+template <size_t... I, size_t... J>
+struct JoinIndexLists<IndexList<I...>, IndexList<J...>> {
+  typedef IndexList<I..., (sizeof...(I) + J)...> type;
+};
+
+// Built in halves, so long melodies stay far from the template instantiation depth limit
+template <size_t N>
+struct MakeIndexList : JoinIndexLists<typename MakeIndexList<N / 2>::type, typename MakeIndexList<N - N / 2>::type> {};
+
+template <>
+struct MakeIndexList<0> {
+  typedef IndexList<> type;
+};
+
+template <>
+struct MakeIndexList<1> {
+  typedef IndexList<0> type;
+};
+
+constexpr bool isDigit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+constexpr bool isSeparator(char c) {
+  return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+constexpr char toLower(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr size_t skipSeparators(const char* s, size_t i) {
+  return isSeparator(s[i]) ? skipSeparators(s, i + 1) : i;
+}
+
+constexpr size_t skipDigits(const char* s, size_t i) {
+  return isDigit(s[i]) ? skipDigits(s, i + 1) : i;
+}
+
+constexpr uint32_t parseNumber(const char* s, size_t i, uint32_t value) {
+  return isDigit(s[i]) ? parseNumber(s, i + 1, value * 10 + (s[i] - '0')) : value;
+}
+
+/** Position just after the next ':' (the string must contain one). */
+constexpr size_t afterColon(const char* s, size_t i) {
+  return s[i] == ':' ? i + 1 : s[i] == '\0' ? RTTTL_ERROR_missing_control_section() : afterColon(s, i + 1);
+}
+
+constexpr size_t controlStart(const char* s) {
+  return afterColon(s, 0);
+}
+
+constexpr size_t notesStart(const char* s) {
+  return afterColon(s, controlStart(s));
+}
+
+/** Position of the next control pair or of the closing ':'. */
+constexpr size_t nextControl(const char* s, size_t i) {
+  return (s[i] == ',' || s[i] == ':') ? (s[i] == ',' ? i + 1 : i) : nextControl(s, i + 1);
+}
+
+/** Value of control key (d, o or b) in the control section, or fallback if missing. */
+constexpr uint32_t controlValue(const char* s, size_t i, char key, uint32_t fallback) {
+  return s[i] == ':' ? fallback
+         : isSeparator(s[i]) ? controlValue(s, i + 1, key, fallback)
+         : toLower(s[i]) == key ? parseNumber(s, s[i + 1] == '=' ? i + 2 : i + 1, 0)
+         : controlValue(s, nextControl(s, i), key, fallback);
+}
+
+constexpr uint32_t defaultDivider(const char* s) {
+  return controlValue(s, controlStart(s), 'd', 4);
+}
+
+constexpr uint32_t defaultOctave(const char* s) {
+  return controlValue(s, controlStart(s), 'o', 6);
+}
+
+constexpr uint32_t bpmValue(uint32_t bpm) {
+  return (bpm < 4 || bpm > 60000) ? RTTTL_ERROR_invalid_bpm() : bpm;
+}
+
+/** Whole-note duration in ms, computed like parseRTTTLHeader(). */
+constexpr uint16_t wholeNote(const char* s) {
+  return static_cast<uint16_t>((60000 / bpmValue(controlValue(s, controlStart(s), 'b', 120))) * 4);
+}
+
+/** True if a note starts at i: a character other than a separator, after a separator or the closing ':'. */
+constexpr bool isNoteStart(const char* s, size_t i) {
+  return !isSeparator(s[i]) && (isSeparator(s[i - 1]) || s[i - 1] == ':');
+}
+
+/** Number of notes starting in [begin, end), split in halves to keep the recursion shallow. */
+constexpr size_t countFrom(const char* s, size_t begin, size_t end) {
+  return end - begin == 0 ? 0
+         : end - begin == 1 ? isNoteStart(s, begin)
+         : countFrom(s, begin, begin + (end - begin) / 2) + countFrom(s, begin + (end - begin) / 2, end);
+}
+
+/** Number of notes in an RTTTL string literal. */
+template <size_t L>
+constexpr size_t countNotes(const char (&s)[L]) {
+  return countFrom(s, notesStart(s), L - 1);
+}
+
+constexpr uint8_t durationCode(uint32_t divider) {
+  return divider == 1 ? 0 : divider == 2 ? 1 : divider == 4 ? 2 : divider == 8 ? 3 : divider == 16 ? 4 : divider == 32 ? 5 : RTTTL_ERROR_invalid_duration();
+}
+
+/** Semitone index of a note letter (0 = C), 12 for a pause. */
+constexpr uint8_t letterIndex(char c) {
+  return c == 'c' ? 0 : c == 'd' ? 2 : c == 'e' ? 4 : c == 'f' ? 5 : c == 'g' ? 7 : c == 'a' ? 9 : c == 'b' ? 11 : c == 'p' ? 12 : RTTTL_ERROR_invalid_note();
+}
+
+/** Packed pitch field: 0 for a pause, 1-12 for C to B. */
+constexpr uint8_t pitchField(uint8_t index, bool isSharp) {
+  return index == 12 ? 0 : (index + isSharp) >= 12 ? RTTTL_ERROR_invalid_note() : index + isSharp + 1;
+}
+
+constexpr uint8_t octaveValue(uint32_t octave) {
+  return octave > 7 ? RTTTL_ERROR_invalid_octave() : octave;
+}
+
+/** Optional dot. */
+constexpr uint16_t packDotted(const char* s, size_t i, uint8_t pitch, uint8_t octave, uint8_t code) {
+  return packNote(pitch, octave, code, s[i] == '.');
+}
+
+/** Optional octave digit (default from o=). */
+constexpr uint16_t packOctave(const char* s, size_t i, uint8_t pitch, uint8_t code) {
+  return isDigit(s[i]) ? packDotted(s, i + 1, pitch, octaveValue(s[i] - '0'), code)
+                       : packDotted(s, i, pitch, octaveValue(defaultOctave(s)), code);
+}
+
+/** Note letter and optional sharp. */
+constexpr uint16_t packPitch(const char* s, size_t i, uint8_t code) {
+  return s[i + 1] == '#' ? packOctave(s, i + 2, pitchField(letterIndex(toLower(s[i])), true), code)
+                         : packOctave(s, i + 1, pitchField(letterIndex(toLower(s[i])), false), code);
+}
+
+/** Optional duration divider (default from d=), then the rest of the note at i. */
+constexpr uint16_t packAt(const char* s, size_t i) {
+  return packPitch(s, skipDigits(s, i), durationCode(isDigit(s[i]) ? parseNumber(s, i, 0) : defaultDivider(s)));
+}
+
+constexpr bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+constexpr size_t skipBlanks(const char* s, size_t i) {
+  return isBlank(s[i]) ? skipBlanks(s, i + 1) : i;
+}
+
+/** Position after the ',' that ends a note whose text stops at i; anything else than blanks before it is an error. */
+constexpr size_t afterNote(const char* s, size_t i) {
+  return s[i] == ',' ? i + 1 : s[i] == '\0' ? i : RTTTL_ERROR_unexpected_character();
+}
+
+constexpr size_t noteDotEnd(const char* s, size_t i) {
+  return s[i] == '.' ? i + 1 : i;
+}
+
+constexpr size_t noteOctaveEnd(const char* s, size_t i) {
+  return noteDotEnd(s, isDigit(s[i]) ? i + 1 : i);
+}
+
+/** Position just after the text of the note whose letter is at i (sharp, octave and dot, as read by packPitch()). */
+constexpr size_t noteEnd(const char* s, size_t i) {
+  return noteOctaveEnd(s, s[i + 1] == '#' ? i + 2 : i + 1);
+}
+
+/** Position of the note after the one at i (or of the terminator). */
+constexpr size_t nextNote(const char* s, size_t i) {
+  return skipSeparators(s, afterNote(s, skipBlanks(s, noteEnd(s, skipDigits(s, i)))));
+}
+
+/**
+ * Packed notes of a run of Count notes and the position after it. Runs are compiled in halves, the second
+ * starting where the first stopped, so the string is read once and the recursion depth grows with log(Count).
+ */
+template <size_t Count>
+struct NoteRun {
+  uint16_t words[Count];
+  size_t end;
+};
+
+template <size_t Count>
+struct RunCompiler;
+
+template <size_t Left, size_t Right, size_t... I, size_t... J>
+constexpr NoteRun<Left + Right> joinRuns(const NoteRun<Left>& first, const NoteRun<Right>& second, IndexList<I...>, IndexList<J...>) {
+  return NoteRun<Left + Right>{ { first.words[I]..., second.words[J]... }, second.end };
+}
+
+template <size_t Left, size_t Right>
+constexpr NoteRun<Left + Right> continueRun(const char* s, const NoteRun<Left>& first) {
+  return joinRuns(first, RunCompiler<Right>::compile(s, first.end), typename MakeIndexList<Left>::type(), typename MakeIndexList<Right>::type());
+}
+
+template <size_t Count>
+struct RunCompiler {
+  static constexpr NoteRun<Count> compile(const char* s, size_t i) {
+    return continueRun<Count / 2, Count - Count / 2>(s, RunCompiler<Count / 2>::compile(s, i));
+  }
+};
+
+template <>
+struct RunCompiler<1> {
+  static constexpr NoteRun<1> compile(const char* s, size_t i) {
+    return NoteRun<1>{ { packAt(s, i) }, nextNote(s, i) };
+  }
+};
+
+template <size_t N, size_t... I>
+constexpr PackedMelody<N> finish(const char* s, const NoteRun<N>& notes, IndexList<I...>) {
+  return PackedMelody<N>{ { wholeNote(s), static_cast<uint16_t>(N), notes.words[I]... } };
+}
+
+template <size_t N>
+struct MelodyCompiler {
+  static constexpr PackedMelody<N> compile(const char* s) {
+    return finish(s, RunCompiler<N>::compile(s, skipSeparators(s, notesStart(s))), typename MakeIndexList<N>::type());
+  }
+};
+
+template <>
+struct MelodyCompiler<0> {
+  static constexpr PackedMelody<0> compile(const char* s) {
+    return PackedMelody<0>{ { wholeNote(s), 0 } };
+  }
+};
+
+template <size_t N>
+constexpr PackedMelody<N> compile(const char* s) {
+  return MelodyCompiler<N>::compile(s);
+}
+
+/** Same result as pitchFrequency() (before the MIN_FREQUENCY check), for note number k = octave * 12 + index. */
+constexpr uint16_t noteHz(uint8_t k) {
+  return k / NOTES_PER_OCTAVE >= 4 ? PITCH_TABLE[k % NOTES_PER_OCTAVE] << (k / NOTES_PER_OCTAVE - 4)
+                                   : (PITCH_TABLE[k % NOTES_PER_OCTAVE] + (1 << (3 - k / NOTES_PER_OCTAVE))) >> (4 - k / NOTES_PER_OCTAVE);
+}
+
+constexpr uint16_t distance(uint16_t a, uint16_t b) {
+  return a > b ? a - b : b - a;
+}
+
+/** Note number closest to frequency, searching from k up to the highest packable note. */
+constexpr uint8_t nearestNote(uint16_t frequency, uint8_t k, uint8_t best) {
+  return k >= (PACKED_MAX_OCTAVE + 1) * NOTES_PER_OCTAVE ? best
+         : nearestNote(frequency, k + 1, distance(frequency, noteHz(k)) < distance(frequency, noteHz(best)) ? k : best);
+}
+
+/** Reject frequencies more than about half a semitone away from the packable range. */
+constexpr uint8_t checkedNote(uint16_t frequency, uint8_t k) {
+  return distance(frequency, noteHz(k)) * 17 > noteHz(k) ? PACK_ERROR_frequency_out_of_range() : k;
+}
+
+constexpr uint8_t toneDurationCode(ToneDuration duration) {
+  return duration == VERY_SHORT_DURATION ? 0 : duration == SHORT_DURATION ? 1 : duration == MEDIUM_DURATION ? 2 : duration == LONG_DURATION ? 3 : PACK_ERROR_not_a_tone_duration();
+}
+
+constexpr uint16_t packToneNote(uint8_t k, uint8_t code) {
+  return packNote(k % NOTES_PER_OCTAVE + 1, k / NOTES_PER_OCTAVE, code, false);
+}
+
+constexpr uint16_t packTone(ToneFrequency frequency, ToneDuration duration) {
+  return frequency == PAUSE ? packNote(0, 0, toneDurationCode(duration), false)
+                            : packToneNote(checkedNote(frequency, nearestNote(frequency, NOTES_PER_OCTAVE - 1, NOTES_PER_OCTAVE - 1)), toneDurationCode(duration));
+}
+
+template <size_t N, size_t... I>
+constexpr PackedMelody<N> packTones(const ToneFrequency* melody, const ToneDuration* durations, IndexList<I...>) {
+  return PackedMelody<N>{ { PACKED_TONE_DURATIONS, static_cast<uint16_t>(N), packTone(melody[I], durations[I])... } };
+}
+
+template <size_t N>
+constexpr PackedMelody<N> packTones(const ToneFrequency* melody, const ToneDuration* durations) {
+  return packTones<N>(melody, durations, typename MakeIndexList<N>::type());
+}
+
+constexpr uint32_t toneDuration(uint8_t code) {
+  return code == 0 ? VERY_SHORT_DURATION : code == 1 ? SHORT_DURATION : code == 2 ? MEDIUM_DURATION : code == 3 ? LONG_DURATION : 0;
+}
+
+constexpr uint32_t baseDuration(uint16_t note, uint16_t wholeNote) {
+  return wholeNote != PACKED_TONE_DURATIONS ? wholeNote >> ((note >> PACKED_DURATION_SHIFT) & 0x07) : toneDuration((note >> PACKED_DURATION_SHIFT) & 0x07);
+}
+
+constexpr uint32_t clampDuration(uint32_t duration) {
+  return duration > MELODY_MAX_NOTE_DURATION ? MELODY_MAX_NOTE_DURATION : duration;
+}
+
+/** Same result as packedNoteDuration(). */
+constexpr uint32_t noteDuration(uint16_t note, uint16_t wholeNote) {
+  return clampDuration(baseDuration(note, wholeNote) + ((note & PACKED_DOTTED) ? baseDuration(note, wholeNote) / 2 : 0));
+}
+
+/** Sum of the durations of words[begin, end), split in halves to keep the recursion shallow. */
+constexpr uint32_t sumDurations(const uint16_t* words, size_t begin, size_t end) {
+  return end - begin == 0 ? 0
+         : end - begin == 1 ? noteDuration(words[begin], words[0])
+         : sumDurations(words, begin, begin + (end - begin) / 2) + sumDurations(words, begin + (end - begin) / 2, end);
+}
+
+template <size_t N, size_t... I>
+constexpr PackedMelodyIndex<N> indexNotes(const uint16_t* words, IndexList<I...>) {
+  return PackedMelodyIndex<N>{ { sumDurations(words, PACKED_HEADER_WORDS, PACKED_HEADER_WORDS + I)... } };
+}
+
+template <size_t N>
+constexpr PackedMelodyIndex<N> indexMelody(const PackedMelody<N>& melody) {
+  return indexNotes<N>(melody.words, typename MakeIndexList<N + 1>::type());
+}
+
+}  // namespace rtttl_compile_detail
+
+/**
+ * @brief Compile an RTTTL string literal into a PackedMelody image.
+ * Must initialize a constexpr variable, otherwise errors are not reported at compile time.
+ */
+#define RTTTL_COMPILE(text) rtttl_compile_detail::compile<rtttl_compile_detail::countNotes(text)>(text)
+
+/**
+ * @brief Define a packed melody in PROGMEM from an RTTTL string literal.
+ * Example: PROGMEM_RTTTL(NOKIA_PACKED, "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#");
+ */
+#define PROGMEM_RTTTL(name, text) constexpr auto name PROGMEM = RTTTL_COMPILE(text)
+
+/**
+ * @brief Define a packed melody in PROGMEM from constant ToneFrequency and ToneDuration arrays.
+ * Frequencies become the nearest note of the pitch engine; durations must be ToneDuration values.
+ * Example: PROGMEM_TONE_MELODY(TWINKLE_PACKED, twinkleMelody, twinkleDurations);
+ */
+#define PROGMEM_TONE_MELODY(name, melody, durations) \
+  static_assert(sizeof(melody) / sizeof((melody)[0]) == sizeof(durations) / sizeof((durations)[0]), "melody and durations differ in length"); \
+  constexpr auto name PROGMEM = rtttl_compile_detail::packTones<sizeof(melody) / sizeof((melody)[0])>(melody, durations)
+
+/**
+ * @brief Define the index of a compiled melody in PROGMEM, for melodyPosition() and seekMelody().
+ * Example: PROGMEM_MELODY_INDEX(NOKIA_INDEX, NOKIA_PACKED); then melodyIndex(NOKIA_INDEX, true).
+ */
+#define PROGMEM_MELODY_INDEX(name, melody) constexpr auto name PROGMEM = rtttl_compile_detail::indexMelody(melody)
+
+/**
+ * @brief Get a MelodyIndex for a compiled index.
+ * @param index The compiled index (PROGMEM_MELODY_INDEX).
+ * @param isProgmem True if the index is stored in PROGMEM.
+ * @return The MelodyIndex.
+ */
+template <size_t N>
+MelodyIndex melodyIndex(const PackedMelodyIndex<N>& index, bool isProgmem = false) {
+  return MelodyIndex{ index.starts, static_cast<uint16_t>(N), isProgmem };
+}
+
+/**
+ * @brief Play a compiled melody (non-blocking) with optional repeats.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @param state The MelodyState structure to manage the melody.
+ * @param melody The compiled melody.
+ * @param isProgmem True if the melody is stored in PROGMEM (PROGMEM_RTTTL, PROGMEM_TONE_MELODY).
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <size_t N>
+void playPackedMelody(MelodyState& state, const PackedMelody<N>& melody, bool isProgmem = false, uint8_t repeatCount = 1) {
+  playPackedMelody(state, melody.words, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Play a compiled melody (non-blocking) on an output with optional repeats.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param melody The compiled melody.
+ * @param isProgmem True if the melody is stored in PROGMEM (PROGMEM_RTTTL, PROGMEM_TONE_MELODY).
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <typename Output, size_t N>
+void playPackedMelody(Output& output, MelodyState& state, const PackedMelody<N>& melody, bool isProgmem = false, uint8_t repeatCount = 1) {
+  playPackedMelody(output, state, melody.words, isProgmem, repeatCount);
+}
+
+#endif  // RTTTL_COMPILE_H
@@ -0,0 +1,22 @@
+/**
+ * @file rtttl_compiled_melodies.h
+ * @brief Ringtones from rtttl_PROGMEM_melodies.h compiled to packed note tables in PROGMEM.
+ * Play them with playPackedMelody(state, NOKIA_PACKED, true); no parsing happens at runtime.
+ * Only the tables a sketch uses end up in flash.
+ */
+
+#ifndef RTTTL_COMPILED_MELODIES_H
+#define RTTTL_COMPILED_MELODIES_H
+
+#include "rtttl_compile.h"
+#include "rtttl_PROGMEM_melodies.h"
+
+PROGMEM_RTTTL(NOKIA_PACKED, NOKIA_RTTTL);
+PROGMEM_RTTTL(XFILES_PACKED, XFILES_RTTTL);
+PROGMEM_RTTTL(MISSION_PACKED, MISSION_RTTTL);
+PROGMEM_RTTTL(SIMPSONS_PACKED, SIMPSONS_RTTTL);
+PROGMEM_RTTTL(GADGET_PACKED, GADGET_RTTTL);
+PROGMEM_RTTTL(CANON_PACKED, CANON_RTTTL);
+PROGMEM_RTTTL(SUPERMARIO_PACKED, SUPERMARIO_RTTTL);
+
+#endif  // RTTTL_COMPILED_MELODIES_H
@@ -11,9 +11,15 @@
 #ifndef SOUNDFUNCTIONS_H
 #define SOUNDFUNCTIONS_H
 
+#ifdef ARDUINO
 #include <Arduino.h>
 #include <avr/pgmspace.h>
-#include <math.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+#else
+#include "sound_host_backend.h"
+#endif
 
 /** @brief Octave offset for tone frequencies. */
 #define OCTAVE 0
@@ -24,6 +30,29 @@
 #define MAX_FREQUENCY 65535
 /** @brief Maximum number of notes in an RTTTL melody. */
 #define MAX_RTTTL_NOTES 100
+/** @brief Time added after each note in MELODY_TIMING_RELATIVE mode (ms). */
+#define MELODY_NOTE_GAP 50
+/** @brief Longest melody note (ms): with its MELODY_NOTE_GAP it fits half the range of SoundTime, so the end of the note is seen by any update within the following 32 s. */
+#define MELODY_MAX_NOTE_DURATION (0x7FFF - MELODY_NOTE_GAP)
+/** @brief Default silence at the end of each note in MELODY_TIMING_ABSOLUTE mode (ms). */
+#define MELODY_ARTICULATION_GAP 10
+/** @brief Fractional bits of the note duration multiplier set by setMelodyTempo(). */
+#define MELODY_TEMPO_SHIFT 12
+/** @brief Slowest and fastest tempo accepted by setMelodyTempo() (percent of the written tempo). */
+#define MELODY_TEMPO_MIN 10
+#define MELODY_TEMPO_MAX 1000
+/** @brief Number of decoded notes an RTTTLStream can hold ahead of playback. */
+#ifndef RTTTL_STREAM_BUFFER_NOTES
+#define RTTTL_STREAM_BUFFER_NOTES 16
+#endif
+/** @brief Longest RTTTL note or control pair kept by an RTTTLStream (longer ones are cut). */
+#define RTTTL_STREAM_TOKEN_SIZE 8
+/** @brief Silence played while a streamed melody waits for its next note (ms). */
+#define RTTTL_STREAM_WAIT 10
+/** @brief Default time between two frequency updates of a sweep, glide or smooth effect (ms). */
+#ifndef SWEEP_RETUNE_INTERVAL
+#define SWEEP_RETUNE_INTERVAL 5
+#endif
 
 extern uint8_t speakerPin = DEFAULT_PIN_SPEAKER; /**< Global variable for speaker pin */
 
@@ -44,11 +73,36 @@ uint8_t getSpeakerPin() {
   return speakerPin;
 }
 
+/**
+ * @brief Default output of the play and update functions: tone() and noTone() on the speaker pin.
+ * Every play and update function also has an overload taking an output as first argument; any type
+ * with play(frequency) and stop() members can be used (see SynthVoiceOutput in sound_synth.h, and
+ * Speaker<Pin> and GpioSpeaker<Pin> in sound_speaker.h for several speakers).
+ */
+struct SpeakerOutput {
+  void play(uint16_t frequency) { tone(getSpeakerPin(), frequency); }
+  void stop() { noTone(getSpeakerPin()); }
+};
+
+/**
+ * @brief Play a melody note on an output. Outputs that keep per-note settings (TimerToneOutput in sound_timer.h)
+ * overload this for their type and use the note number; the others play the frequency.
+ * @tparam Output Output type with play(frequency) and stop() members.
+ * @param output The output the sound is sent to.
+ * @param frequency The frequency of the note (Hz).
+ * @param noteNumber The note number (octave * 12 + semitone), or NO_NOTE_NUMBER if the note came as a frequency.
+ */
+template <typename Output>
+void playOutputNote(Output& output, uint16_t frequency, uint8_t noteNumber) {
+  (void)noteNumber;
+  output.play(frequency);
+}
+
 /**
 * @brief Enumeration of tone frequencies.
 * This enumeration defines various tone frequencies for generating tones.
 */
-enum ToneFrequency {
+enum ToneFrequency : uint16_t {
   LOW_C = 261,
   LOW_C_SHARP = 277,
   LOW_D = 294,
@@ -98,48 +152,224 @@ enum ToneFrequency {
  * @brief Enumeration of tone durations.
  * This enumeration defines various durations for playing tones.
  */
-enum ToneDuration {
+enum ToneDuration : uint16_t {
   VERY_SHORT_DURATION = 50,
   SHORT_DURATION = 200,
   MEDIUM_DURATION = 500,
   LONG_DURATION = 1000
 };
 
+/**
+ * @brief Timestamp kept in the state structures: the low 16 bits of millis() (ms).
+ * Times are compared modulo 65536 (see soundElapsed()), so a playing sound must be updated at least every
+ * 65 seconds. Sounds frozen by a scheduler may stay paused for any time: their timestamps are shifted on resume.
+ */
+typedef uint16_t SoundTime;
+
+/**
+ * @brief Fields shared by the state structures of every playback kind (tones, alerts, tone series, melodies,
+ * sirens and sweeps), so the scheduler can tell whether any sound is playing without knowing its kind.
+ */
+struct SoundStateHeader {
+  bool isPlaying; /**< Whether the sound is playing. */
+  SoundTime time; /**< Time of the last transition of the sound: start of its tone, note, lapse or retune (ms). */
+};
+
+/**
+ * @brief Time elapsed since a SoundTime.
+ * @param time The timestamp.
+ * @param currentTime The current time (ms).
+ * @return The time elapsed (ms), modulo 65536.
+ */
+uint16_t soundElapsed(SoundTime time, uint32_t currentTime) {
+  return static_cast<uint16_t>(static_cast<uint16_t>(currentTime) - time);
+}
+
+/**
+ * @brief Full millis() value of a SoundTime: the latest time not after currentTime with the same low 16 bits.
+ * @param time The timestamp.
+ * @param currentTime The current time (ms).
+ * @return The time (ms).
+ */
+uint32_t soundTimeAt(SoundTime time, uint32_t currentTime) {
+  return currentTime - soundElapsed(time, currentTime);
+}
+
 /**
  * @brief Structure to manage tone playback state.
- * Used for non-blocking tone generation.
+ * Used for non-blocking tone generation; time is the start of the tone.
  */
-struct ToneState {
-  bool isPlaying;          /**< Whether a tone is currently playing. */
-  uint32_t startTime;      /**< Start time of the current tone (ms). */
+struct ToneState : SoundStateHeader {
   ToneFrequency frequency; /**< Frequency of the current tone. */
   ToneDuration duration;   /**< Duration of the current tone. */
 };
 
+/**
+ * @brief Default settings read from the control section of an RTTTL string.
+ */
+struct RTTTLHeader {
+  uint8_t defaultDuration; /**< Default note divider (d=). */
+  uint8_t defaultOctave;   /**< Default octave (o=). */
+  uint16_t bpm;            /**< Beats per minute (b=). */
+  uint32_t wholeNote;      /**< Duration of a whole note (ms), derived from bpm. */
+};
+
+/**
+ * @brief Source of the notes of a melody.
+ */
+enum MelodySource : uint8_t {
+  MELODY_SOURCE_ARRAYS,  /**< Parallel ToneFrequency and ToneDuration arrays. */
+  MELODY_SOURCE_RTTTL,   /**< RTTTL string decoded note by note (streaming mode). */
+  MELODY_SOURCE_PACKED,  /**< Packed note image (see packNote()). */
+  MELODY_SOURCE_STREAM,  /**< Notes decoded by an RTTTLStream as its input arrives. */
+  MELODY_SOURCE_COMPACT  /**< Compact image decoded note by note (see compactMelody()). */
+};
+
+/**
+ * @brief Where an RTTTLStream is in the RTTTL text.
+ */
+enum RTTTLStreamPhase {
+  RTTTL_STREAM_NAME,    /**< Skipping the name, up to the first ':'. */
+  RTTTL_STREAM_CONTROL, /**< Reading the control section, up to the second ':'. */
+  RTTTL_STREAM_NOTES,   /**< Decoding notes. */
+  RTTTL_STREAM_ENDED    /**< Input ended; the notes left in the buffer are still played. */
+};
+
+/**
+ * @brief One note decoded by an RTTTLStream.
+ */
+struct RTTTLStreamNote {
+  uint16_t frequency; /**< Frequency of the note (Hz), PAUSE for a rest. */
+  uint16_t duration;  /**< Duration of the note (ms). */
+};
+
+/**
+ * @brief Push parser for RTTTL text that arrives in chunks (UART, BLE...).
+ * Bytes are fed as they come; each complete note is decoded into a ring buffer that updateMelody() consumes,
+ * so RAM use is fixed whatever the melody length.
+ */
+struct RTTTLStream {
+  RTTTLStreamNote notes[RTTTL_STREAM_BUFFER_NOTES]; /**< Ring buffer of decoded notes. */
+  uint8_t head;                                     /**< Index of the oldest note in the buffer. */
+  uint8_t count;                                    /**< Number of notes in the buffer. */
+  uint8_t phase;                                    /**< RTTTLStreamPhase of the parser. */
+  uint8_t tokenLength;                              /**< Number of characters in token. */
+  char token[RTTTL_STREAM_TOKEN_SIZE];              /**< Note or control pair being received. */
+  RTTTLHeader header;                               /**< Control section, complete once phase is RTTTL_STREAM_NOTES. */
+  uint16_t underruns;                               /**< Times playback had to wait for a note. */
+};
+
+/**
+ * @brief Decoding position in a compact melody image (see compactMelody()).
+ */
+struct CompactCursor {
+  uint16_t position; /**< Index of the next nibble after the header. */
+  uint8_t octave;    /**< Octave of the following notes. */
+  uint8_t duration;  /**< Duration of the following notes: duration code in bits 0-2, dotted flag in bit 3. */
+};
+
+/**
+ * @brief Curve a sweep follows from its start to its end frequency.
+ */
+enum SweepCurve : uint8_t {
+  SWEEP_LINEAR,     /**< Equal steps in hertz. */
+  SWEEP_EXPONENTIAL /**< Equal steps in pitch: the same musical interval per unit of time. */
+};
+
+/**
+ * @brief Structure to manage a frequency sweep or glide.
+ * The position (frequency or pitch) is kept in 16.16 fixed point and moved by an increment computed when the
+ * sweep starts, so a retune costs one addition (plus a table interpolation on the exponential curve).
+ * time is the time of the last retune.
+ */
+struct SweepState : SoundStateHeader {
+  bool isRising : 1;     /**< Whether the position goes up. */
+  uint8_t curve : 1;     /**< SweepCurve of the sweep. */
+  uint16_t interval;     /**< Time between retunes (ms). */
+  uint16_t stepsLeft;    /**< Retunes left until the end frequency. */
+  uint16_t frequency;    /**< Frequency currently played (Hz). */
+  uint32_t position;     /**< Frequency (Hz) or pitch (semitones above C0), 16.16 fixed point. */
+  uint32_t increment;    /**< Change of position at each retune, 16.16 fixed point. */
+  uint16_t endFrequency; /**< Frequency at the end of the sweep (Hz). */
+};
+
+/**
+ * @brief How updateMelody() places note boundaries.
+ */
+enum MelodyTiming : uint8_t {
+  MELODY_TIMING_RELATIVE, /**< Each note starts when the previous one is seen to end, plus MELODY_NOTE_GAP (default). */
+  MELODY_TIMING_ABSOLUTE  /**< Note boundaries follow start time plus the sum of durations; loop latency does not accumulate. */
+};
+
+/**
+ * @brief Optional playback controls of a melody: tempo, transposition and portamento.
+ * Kept out of MelodyState so melodies that do not use them do not pay for them: attach one to a melody with
+ * setMelodyControls() before calling setMelodyTempo(), setMelodyTranspose() or setMelodyGlide().
+ * Must start zero-initialized (written tempo and key, no portamento).
+ */
+struct MelodyControls {
+  SweepState glide;       /**< Portamento of the current note; frequency is the pitch the melody last played. */
+  uint16_t glideTime;     /**< Portamento time from the previous note (ms, 0 = off, see setMelodyGlide()). */
+  uint16_t durationScale; /**< Note duration multiplier in 4.12 fixed point (0 = written tempo, see setMelodyTempo()). */
+  int8_t transpose;       /**< Semitones added to every note (see setMelodyTranspose()). */
+};
+
 /**
  * @brief Structure to manage melody playback state.
  * Used for non-blocking melody playback, including RTTTL melodies with repeat support.
+ * In streaming mode the RTTTL string is not copied: only a cursor and the parsed header are kept,
+ * and each note is decoded when the previous one ends. Packed melodies are read one word per note, compact
+ * melodies one nibble per note. Only the pointers and decoding position of the current source are kept (they
+ * share storage), so they are read after checking source. time is the start of the current note.
+ */
+struct MelodyState : SoundStateHeader {
+  bool isDynamic : 1;          /**< Whether the melody arrays are dynamically allocated (for RTTTL). */
+  bool isProgmem : 1;          /**< Whether the streamed RTTTL string or packed image is stored in PROGMEM. */
+  bool isArticulating : 1;     /**< Whether the articulation gap of the current note has started. */
+  uint8_t source : 3;          /**< MelodySource: where the notes of the melody come from. */
+  uint8_t timing : 1;          /**< MelodyTiming: how note boundaries are placed (kept across play calls, see setMelodyTiming()). */
+  uint8_t currentRepeat;       /**< Current repeat count. */
+  uint8_t totalRepeats;        /**< Total number of times to repeat the melody. */
+  uint8_t noteNumber;          /**< Note number of the note currently playing, NO_NOTE_NUMBER if it came as a frequency. */
+  uint8_t articulationGap;     /**< Silence at the end of each note in MELODY_TIMING_ABSOLUTE mode (ms). */
+  union {
+    ToneFrequency* melody;     /**< Array of melody frequencies (dynamic for RTTTL), MELODY_SOURCE_ARRAYS. */
+    const char* rtttl;         /**< First note of the streamed RTTTL string, MELODY_SOURCE_RTTTL. */
+    const uint16_t* packed;    /**< First note of the packed image, MELODY_SOURCE_PACKED. */
+    const uint8_t* compact;    /**< Compact image, header included, MELODY_SOURCE_COMPACT. */
+    RTTTLStream* stream;       /**< Parser feeding the melody, MELODY_SOURCE_STREAM. */
+  };
+  union {
+    ToneDuration* durations;   /**< Array of note durations (dynamic for RTTTL), MELODY_SOURCE_ARRAYS. */
+    const char* rtttlCursor;   /**< Next note to decode from the streamed RTTTL string, MELODY_SOURCE_RTTTL. */
+  };
+  MelodyControls* controls;    /**< Tempo, transposition and portamento, nullptr if none (kept across play calls, see setMelodyControls()). */
+  union {
+    RTTTLHeader rtttlHeader;     /**< Control section of the streamed RTTTL string (wholeNote also used by packed images). */
+    CompactCursor compactCursor; /**< Next note to decode from the compact image, MELODY_SOURCE_COMPACT. */
+  };
+  uint16_t currentNote;        /**< Index of the current note. */
+  uint16_t length;             /**< Total number of notes in the melody (0 in streaming mode). */
+  ToneFrequency noteFrequency; /**< Frequency of the note currently playing. */
+  ToneDuration noteDuration;   /**< Duration of the note currently playing. */
+};
+
+/**
+ * @brief Start time of every note of a melody, for position queries and seeking (see buildMelodyIndex()).
+ * Times are sums of the note durations; the gap added in MELODY_TIMING_RELATIVE mode is accounted for when they are read.
  */
-struct MelodyState {
-  bool isPlaying;          /**< Whether a melody is currently playing. */
-  size_t currentNote;      /**< Index of the current note. */
-  uint32_t lastNoteTime;   /**< Time the last note started (ms). */
-  ToneFrequency* melody;   /**< Array of melody frequencies (dynamic for RTTTL). */
-  ToneDuration* durations; /**< Array of note durations (dynamic for RTTTL). */
-  size_t length;           /**< Total number of notes in the melody. */
-  bool isDynamic;          /**< Whether the melody arrays are dynamically allocated (for RTTTL). */
-  uint8_t currentRepeat;   /**< Current repeat count. */
-  uint8_t totalRepeats;    /**< Total number of times to repeat the melody. */
+struct MelodyIndex {
+  const uint32_t* starts; /**< Sum of the durations before each note (ms); starts[count] is the length of one pass. */
+  uint16_t count;         /**< Number of notes. */
+  bool isProgmem;         /**< Whether starts is stored in PROGMEM (PROGMEM_MELODY_INDEX). */
 };
 
 /**
  * @brief Structure to manage tone series playback state.
- * Used for non-blocking tone series playback.
+ * Used for non-blocking tone series playback; time is the start of the current tone.
  */
-struct ToneSeriesState {
-  bool isPlaying;           /**< Whether a tone series is currently playing. */
+struct ToneSeriesState : SoundStateHeader {
   int16_t currentFrequency; /**< Current frequency in the series. */
-  uint32_t lastToneTime;    /**< Time the last tone started (ms). */
   uint16_t endFrequency;    /**< End frequency of the series. */
   int16_t step;             /**< Frequency step (positive or negative). */
   ToneDuration duration;    /**< Duration of each tone. */
@@ -147,393 +377,2391 @@ struct ToneSeriesState {
 
 /**
  * @brief Structure to manage alert or beep playback state.
- * Used for non-blocking alert or beep sequences.
+ * Used for non-blocking alert or beep sequences; time is the time the last tone started or stopped.
  */
-struct AlertState {
-  bool isPlaying;          /**< Whether an alert or beep sequence is currently playing. */
+struct AlertState : SoundStateHeader {
+  bool isToneOn;           /**< Whether a tone of the sequence is sounding (false during the lapse). */
   uint8_t currentCount;    /**< Current number of tones played. */
   uint8_t totalCount;      /**< Total number of tones to play. */
-  uint32_t lastToneTime;   /**< Time the last tone started (ms). */
   ToneFrequency frequency; /**< Frequency of the tones. */
   ToneDuration duration;   /**< Duration of each tone. */
   uint16_t lapse;          /**< Time lapse between tones (ms). */
 };
 
+/**
+ * @brief Flags of a SoundEffect.
+ */
+enum SoundEffectFlags {
+  EFFECT_SMOOTH = 0x01,    /**< Interpolate between wave points (retuned every SWEEP_RETUNE_INTERVAL ms); otherwise step. */
+  EFFECT_RELATIVE = 0x02,  /**< Depth in 1/1000 of the note frequency; otherwise in Hz. */
+  EFFECT_RETRIGGER = 0x04  /**< Restart the wave at every note played through an EffectOutput. */
+};
+
+/**
+ * @brief Frequency modulation effect: a waveform table read at a fixed rate and scaled by a depth.
+ * The frequency played is the note frequency plus depth * wave / 127. Presets (EFFECT_VIBRATO, EFFECT_SIREN...)
+ * are stored in PROGMEM; the wave points are always read from PROGMEM.
+ */
+struct SoundEffect {
+  const int8_t* wave; /**< Waveform points (PROGMEM), -127 to 127. */
+  uint8_t length;     /**< Number of points in wave. */
+  uint8_t flags;      /**< SoundEffectFlags. */
+  uint16_t stepTime;  /**< Time spent on each point (ms); the period of the effect is length * stepTime. */
+  int16_t depth;      /**< Frequency change at a wave point of 127 (Hz, or 1/1000 of the note with EFFECT_RELATIVE). */
+};
+
+/**
+ * @brief Structure to run a SoundEffect on top of a note.
+ * The wave position follows the start time plus multiples of stepTime; the amplitude is computed once per note,
+ * so an update costs a table read, a multiplication and a shift (plus the interpolation of smooth effects).
+ */
+struct EffectState {
+  SoundEffect effect;     /**< Copy of the effect being played. */
+  bool isActive;          /**< Whether an effect is set. */
+  uint8_t point;          /**< Current point of the wave. */
+  SoundTime pointTime;    /**< Time the current point started (ms). */
+  SoundTime lastUpdate;   /**< Time of the last retune of a smooth effect (ms). */
+  uint16_t fractionStep;  /**< 65536 / stepTime, to interpolate smooth effects. */
+  uint16_t baseFrequency; /**< Frequency of the note being modulated (PAUSE for silence). */
+  uint16_t frequency;     /**< Frequency currently played. */
+  int32_t amplitude;      /**< Frequency change per wave unit for the current note (Hz / 256 per 1/127). */
+};
+
 /**
  * @brief Structure to manage siren playback state.
- * Used for non-blocking siren effect.
+ * Used for non-blocking siren effect: the EFFECT_SIREN preset on the low frequency, with high - low as depth and
+ * duration / 10 as step time. The preset is read from PROGMEM at each switch, so only its position is kept.
+ * time is the start of the siren.
  */
-struct SirenState {
-  bool isPlaying;              /**< Whether the siren is currently playing. */
-  bool isLowFrequency;         /**< Whether the low frequency is currently playing. */
-  uint32_t startTime;          /**< Start time of the siren effect (ms). */
-  uint32_t lastSwitchTime;     /**< Time of the last frequency switch (ms). */
-  ToneFrequency lowFrequency;  /**< Low frequency of the siren. */
-  ToneFrequency highFrequency; /**< High frequency of the siren. */
-  ToneDuration duration;       /**< Total duration of the siren effect. */
+struct SirenState : SoundStateHeader {
+  uint8_t point;              /**< Current point of the EFFECT_SIREN wave. */
+  SoundTime pointTime;        /**< Time the current point started (ms). */
+  ToneFrequency lowFrequency; /**< Low frequency of the siren, the note EFFECT_SIREN modulates. */
+  int16_t depth;              /**< High frequency minus low frequency (Hz). */
+  ToneDuration duration;      /**< Total duration of the siren effect. */
 };
 
 /**
- * @brief Parse an RTTTL string into melody and duration arrays.
- * Converts an RTTTL string (RAM or PROGMEM) into arrays of ToneFrequency and ToneDuration.
- * The caller is responsible for freeing the allocated memory.
- * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
- * @param melody Pointer to store the allocated ToneFrequency array.
- * @param durations Pointer to store the allocated ToneDuration array.
- * @param length Pointer to store the number of notes parsed.
- * @param isProgmem True if the RTTTL string is stored in PROGMEM.
- * @return True if parsing was successful, false otherwise.
+ * @brief RAM budget of a state structure on the target (bytes): AVR (2-byte pointers, no padding), 32-bit and 64-bit targets.
+ * The state structures are checked against their budget at compile time, so a field added without care fails the build.
+ * Budgets stay within the sizes before the 16-bit timestamps (AVR/32-bit/64-bit: ToneState 9/16/16, AlertState 13/20/20,
+ * ToneSeriesState 13/16/16, SirenState 16/24/24, MelodyState 16/28/56), except MelodyState on 8 and 32-bit targets: the
+ * current note, the decoding position of the streamed sources and the pointer to its MelodyControls add 14 and 12 bytes.
  */
-bool parseRTTTL(const char* rtttl, ToneFrequency*& melody, ToneDuration*& durations, size_t& length, bool isProgmem = false) {
-  if (!rtttl) {
-    length = 0;
-    return false;
-  }
+#define SOUND_STATE_BUDGET(avr, bits32, bits64) (sizeof(void*) == 2 ? (avr) : sizeof(void*) == 4 ? (bits32) : (bits64))
 
-  ToneFrequency tempMelody[MAX_RTTTL_NOTES];
-  ToneDuration tempDurations[MAX_RTTTL_NOTES];
-  size_t noteCount = 0;
+static_assert(sizeof(ToneState) <= SOUND_STATE_BUDGET(7, 8, 8), "ToneState exceeds its RAM budget");
+static_assert(sizeof(AlertState) <= SOUND_STATE_BUDGET(12, 14, 14), "AlertState exceeds its RAM budget");
+static_assert(sizeof(ToneSeriesState) <= SOUND_STATE_BUDGET(11, 12, 12), "ToneSeriesState exceeds its RAM budget");
+static_assert(sizeof(SweepState) <= SOUND_STATE_BUDGET(20, 24, 24), "SweepState exceeds its RAM budget");
+static_assert(sizeof(MelodyState) <= SOUND_STATE_BUDGET(30, 40, 56), "MelodyState exceeds its RAM budget");
+static_assert(sizeof(MelodyControls) <= SOUND_STATE_BUDGET(25, 32, 32), "MelodyControls exceeds its RAM budget");
+static_assert(sizeof(SirenState) <= SOUND_STATE_BUDGET(12, 14, 14), "SirenState exceeds its RAM budget");
 
-  char rtttlCopy[256];
-  if (isProgmem) {
-    strncpy_P(rtttlCopy, rtttl, sizeof(rtttlCopy) - 1);
-  } else {
-    strncpy(rtttlCopy, rtttl, sizeof(rtttlCopy) - 1);
-  }
-  rtttlCopy[sizeof(rtttlCopy) - 1] = '\0';
-
-  char* headerEnd = strchr(rtttlCopy, ':');
-  if (!headerEnd) return false;
-  char* settings = headerEnd + 1;
-  char* notes = strchr(settings, ':');
-  if (!notes) return false;
-  notes++;
-
-  uint8_t defaultDuration = 4;
-  uint8_t defaultOctave = 6;
-  uint16_t bpm = 120;
-
-  char settingsCopy[32];
-  strncpy(settingsCopy, settings, notes - settings - 1);
-  settingsCopy[notes - settings - 1] = '\0';
-  char* token = strtok(settingsCopy, ",");
-  while (token) {
-    if (token[0] == 'd') defaultDuration = atoi(token + 2);
-    else if (token[0] == 'o') defaultOctave = atoi(token + 2);
-    else if (token[0] == 'b') bpm = atoi(token + 2);
-    token = strtok(NULL, ",");
-  }
-
-  uint32_t quarterNoteDuration = 60000 / bpm;
-
-  char* ptr = notes;
-  while (*ptr && noteCount < MAX_RTTTL_NOTES) {
-    while (*ptr == ',') ptr++;
-
-    uint8_t duration = defaultDuration;
-    if (isdigit(*ptr)) {
-      duration = atoi(ptr);
-      while (isdigit(*ptr)) ptr++;
-    }
-
-    char note = tolower(*ptr++);
-    bool isSharp = (*ptr == '#');
-    if (isSharp) ptr++;
-
-    bool isDotted = false;
-    uint8_t octave = defaultOctave;
-    if (isdigit(*ptr)) {
-      octave = *ptr - '0';
-      ptr++;
-    }
-
-    if (*ptr == '.') {
-      isDotted = true;
-      ptr++;
-    }
-
-    ToneFrequency frequency = PAUSE;
-    if (note != 'p') {
-      uint16_t baseFrequencies[12] = { 262, 277, 294, 311, 330, 349, 370, 392, 415, 440, 466, 494 };
-      int noteIndex = -1;
-      switch (note) {
-        case 'c': noteIndex = 0; break;
-        case 'd': noteIndex = 2; break;
-        case 'e': noteIndex = 4; break;
-        case 'f': noteIndex = 5; break;
-        case 'g': noteIndex = 7; break;
-        case 'a': noteIndex = 9; break;
-        case 'b': noteIndex = 11; break;
-      }
-      if (isSharp && noteIndex >= 0) noteIndex++;
-      if (noteIndex >= 0 && noteIndex < 12) {
-        uint32_t rawFreq = static_cast<uint32_t>(round(baseFrequencies[noteIndex] * pow(2, octave - 4)));
-        if (rawFreq >= MIN_FREQUENCY && rawFreq <= MAX_FREQUENCY) {
-          frequency = static_cast<ToneFrequency>(rawFreq);
-        }
-      }
-    }
+/**
+ * @brief Read one character of an RTTTL string.
+ * @param ptr Pointer to the character (RAM or PROGMEM).
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @return The character at ptr.
+ */
+char readRTTTLChar(const char* ptr, bool isProgmem) {
+  return isProgmem ? static_cast<char>(pgm_read_byte(ptr)) : *ptr;
+}
 
-    uint32_t noteDuration = quarterNoteDuration * 4 / duration;
-    if (isDotted) noteDuration += noteDuration / 2;
-    if (noteDuration > UINT16_MAX) noteDuration = UINT16_MAX;
+/** @brief Number of semitones in an octave. */
+#define NOTES_PER_OCTAVE 12
+/** @brief Highest octave whose notes fit in 16 bits (pitchFrequency() returns PAUSE above it). */
+#define MAX_NOTE_OCTAVE 11
 
-    tempMelody[noteCount] = frequency;
-    tempDurations[noteCount] = static_cast<ToneDuration>(noteDuration);
-    noteCount++;
-  }
+/**
+ * @brief Frequencies of octave 4 (C4 to B4, Hz), the base of the integer pitch engine.
+ * Other octaves are derived by shifting, so a note costs one table read and one shift.
+ */
+constexpr uint16_t PITCH_TABLE[NOTES_PER_OCTAVE] PROGMEM = { 262, 277, 294, 311, 330, 349, 370, 392, 415, 440, 466, 494 };
 
-  melody = new ToneFrequency[noteCount];
-  durations = new ToneDuration[noteCount];
-  for (size_t i = 0; i < noteCount; i++) {
-    melody[i] = tempMelody[i];
-    durations[i] = tempDurations[i];
+/**
+ * @brief Get the frequency of a note.
+ * Integer equivalent of round(PITCH_TABLE[noteIndex] * 2^(octave - 4)): higher octaves shift left,
+ * lower octaves shift right with rounding, so results match the floating-point formula to the hertz.
+ * @param noteIndex Semitone index within the octave (0 = C, 11 = B).
+ * @param octave The octave of the note (4 = A at 440 Hz).
+ * @return The frequency in Hz, or PAUSE if the note is invalid or out of range.
+ */
+ToneFrequency pitchFrequency(uint8_t noteIndex, uint8_t octave) {
+  if (noteIndex >= NOTES_PER_OCTAVE || octave > MAX_NOTE_OCTAVE) return PAUSE;
+  uint16_t frequency = pgm_read_word(&PITCH_TABLE[noteIndex]);
+  if (octave >= 4) {
+    frequency <<= (octave - 4);
+  } else {
+    uint8_t shift = 4 - octave;
+    frequency = (frequency + (1 << (shift - 1))) >> shift;
   }
-  length = noteCount;
-  return true;
+  if (frequency < MIN_FREQUENCY) return PAUSE;
+  return static_cast<ToneFrequency>(frequency);
 }
 
 /**
- * @brief Play a single tone (non-blocking).
- * This function starts playing a tone and updates its state for non-blocking operation.
- * Call updateTone() in the main loop to manage tone completion.
- * @param state The ToneState structure to manage the tone.
- * @param toneFrequency The frequency of the tone to be played.
- * @param toneDuration The duration of the tone to be played.
+ * @brief Find the note closest to a frequency.
+ * Binary search over the pitch engine, so ToneFrequency values and arbitrary frequencies map to a note
+ * without floating point (e.g. LOW_C = 261 Hz maps to C4).
+ * @param frequency The frequency in Hz.
+ * @param noteIndex Variable to store the semitone index (0 = C, 11 = B).
+ * @param octave Variable to store the octave.
+ * @return True if a note was found, false for frequencies below MIN_FREQUENCY (including PAUSE).
  */
-void playTone(ToneState& state, ToneFrequency toneFrequency, ToneDuration toneDuration) {
-  if (toneFrequency < MIN_FREQUENCY || toneFrequency > MAX_FREQUENCY || toneDuration <= 0) {
-    state.isPlaying = false;
-    return;
+bool frequencyToNote(uint16_t frequency, uint8_t& noteIndex, uint8_t& octave) {
+  if (frequency < MIN_FREQUENCY) return false;
+  const uint8_t lowest = NOTES_PER_OCTAVE - 1;  // B0 (31 Hz), the lowest note not below MIN_FREQUENCY
+  uint8_t low = lowest;
+  uint8_t high = (MAX_NOTE_OCTAVE + 1) * NOTES_PER_OCTAVE - 1;
+  while (low < high) {
+    uint8_t mid = (low + high) / 2;
+    if (pitchFrequency(mid % NOTES_PER_OCTAVE, mid / NOTES_PER_OCTAVE) < frequency) low = mid + 1;
+    else high = mid;
   }
-  state.isPlaying = true;
-  state.startTime = millis();
-  state.frequency = toneFrequency;
-  state.duration = toneDuration;
-  if (toneFrequency != PAUSE) {
-    tone(getSpeakerPin(), static_cast<uint16_t>(toneFrequency));
-  } else {
-    noTone(getSpeakerPin());
+  if (low > lowest) {
+    uint16_t above = pitchFrequency(low % NOTES_PER_OCTAVE, low / NOTES_PER_OCTAVE);
+    uint16_t below = pitchFrequency((low - 1) % NOTES_PER_OCTAVE, (low - 1) / NOTES_PER_OCTAVE);
+    if (frequency - below < above - frequency) low--;
   }
+  noteIndex = low % NOTES_PER_OCTAVE;
+  octave = low / NOTES_PER_OCTAVE;
+  return true;
 }
 
 /**
- * @brief Update the state of a playing tone.
- * Checks if the tone duration has elapsed and stops the tone if necessary.
- * Must be called repeatedly in the main loop.
- * @param state The ToneState structure to update.
+ * @brief Frequency ratios of the semitones of an octave (2^(k/12), 1.15 fixed point), for transposing frequencies.
  */
-void updateTone(ToneState& state) {
-  if (state.isPlaying && millis() - state.startTime >= static_cast<uint16_t>(state.duration)) {
-    noTone(getSpeakerPin());
-    state.isPlaying = false;
-  }
+constexpr uint16_t TRANSPOSE_RATIOS[NOTES_PER_OCTAVE] PROGMEM = { 32768, 34716, 36781, 38968, 41285, 43740, 46341, 49097, 52016, 55109, 58386, 61858 };
+
+/** @brief Note number of no note: pauses, and notes of melodies given as frequencies. */
+#define NO_NOTE_NUMBER 0xFF
+
+/**
+ * @brief Get the note number (octave * 12 + semitone) of a note moved by a number of semitones.
+ * Notes moved past the range of the pitch engine (B0 to B11) are played the octaves nearer that bring them back.
+ * @param noteIndex Semitone index within the octave (0 = C, 11 = B).
+ * @param octave The octave of the note.
+ * @param semitones Semitones to move the note by (negative = down).
+ * @return The note number, or NO_NOTE_NUMBER if the note itself is invalid or out of range.
+ */
+uint8_t transposedNoteNumber(uint8_t noteIndex, uint8_t octave, int8_t semitones) {
+  if (noteIndex >= NOTES_PER_OCTAVE || octave > MAX_NOTE_OCTAVE) return NO_NOTE_NUMBER;
+  int16_t semitone = octave * NOTES_PER_OCTAVE + noteIndex;
+  if (semitones == 0) return static_cast<uint8_t>(semitone);
+  const int16_t lowest = NOTES_PER_OCTAVE - 1;  // B0, the lowest note not below MIN_FREQUENCY
+  const int16_t highest = (MAX_NOTE_OCTAVE + 1) * NOTES_PER_OCTAVE - 1;
+  if (semitone < lowest) return NO_NOTE_NUMBER;
+  semitone += semitones;
+  while (semitone < lowest) semitone += NOTES_PER_OCTAVE;
+  while (semitone > highest) semitone -= NOTES_PER_OCTAVE;
+  return static_cast<uint8_t>(semitone);
 }
 
 /**
- * @brief Play an alert tone sequence (non-blocking).
- * This function starts a sequence of alert tones and updates its state.
- * Call updateAlert() in the main loop to manage the sequence.
- * @param state The AlertState structure to manage the alert.
- * @param nr The number of tones in the sequence.
- * @param toneFrequency The frequency of the alert tone.
- * @param toneDuration The duration of each alert tone.
- * @param lapse The time lapse between consecutive tones.
+ * @brief Get the frequency of a note number (see transposedNoteNumber()).
+ * @param noteNumber The note number (octave * 12 + semitone).
+ * @return The frequency in Hz, or PAUSE for NO_NOTE_NUMBER and notes out of range.
  */
-void playAlert(AlertState& state, uint8_t nr, ToneFrequency toneFrequency, ToneDuration toneDuration, uint16_t lapse) {
-  if (nr == 0 || toneFrequency < MIN_FREQUENCY || toneFrequency > MAX_FREQUENCY || toneDuration <= 0) {
-    state.isPlaying = false;
-    return;
-  }
-  state.isPlaying = true;
-  state.currentCount = 0;
-  state.totalCount = nr;
-  state.lastToneTime = millis();
-  state.frequency = toneFrequency;
-  state.duration = toneDuration;
-  state.lapse = lapse;
+ToneFrequency noteNumberFrequency(uint8_t noteNumber) {
+  return pitchFrequency(noteNumber % NOTES_PER_OCTAVE, noteNumber / NOTES_PER_OCTAVE);
 }
 
 /**
- * @brief Update the state of an alert sequence.
- * Manages tone playback and pauses for the alert sequence.
- * Must be called repeatedly in the main loop.
- * @param state The AlertState structure to update.
+ * @brief Get the frequency of a note moved by a number of semitones.
+ * The result is exactly the pitchFrequency() of the moved note; notes moved past the range of the pitch
+ * engine (B0 to B11) are played the octaves nearer that bring them back.
+ * @param noteIndex Semitone index within the octave (0 = C, 11 = B).
+ * @param octave The octave of the note.
+ * @param semitones Semitones to move the note by (negative = down).
+ * @return The frequency in Hz, or PAUSE if the note itself is invalid or out of range.
  */
-void updateAlert(AlertState& state) {
-  if (!state.isPlaying || state.currentCount >= state.totalCount) {
-    state.isPlaying = false;
-    noTone(getSpeakerPin());
-    return;
-  }
+ToneFrequency transposedNoteFrequency(uint8_t noteIndex, uint8_t octave, int8_t semitones) {
+  return noteNumberFrequency(transposedNoteNumber(noteIndex, octave, semitones));
+}
 
-  uint32_t currentTime = millis();
-  if (currentTime - state.lastToneTime >= state.lapse && !state.isPlaying) {
-    tone(getSpeakerPin(), static_cast<uint16_t>(state.frequency));
-    state.isPlaying = true;
-    state.lastToneTime = currentTime;
-  }
-  if (currentTime - state.lastToneTime >= state.duration && state.isPlaying) {
-    noTone(getSpeakerPin());
-    state.isPlaying = false;
-    state.currentCount++;
-    state.lastToneTime = currentTime;
+/**
+ * @brief Move an arbitrary frequency by a number of semitones: one TRANSPOSE_RATIOS product and octave shifts.
+ * Frequencies moved past MIN_FREQUENCY or MAX_FREQUENCY are played the octaves nearer that bring them back.
+ * @param frequency The frequency (Hz); PAUSE and frequencies below MIN_FREQUENCY are returned unchanged.
+ * @param semitones Semitones to move the frequency by (negative = down).
+ * @return The moved frequency (Hz).
+ */
+uint16_t transposeFrequency(uint16_t frequency, int8_t semitones) {
+  if (frequency < MIN_FREQUENCY || semitones == 0) return frequency;
+  int8_t octaves = semitones / NOTES_PER_OCTAVE;
+  int8_t step = semitones % NOTES_PER_OCTAVE;
+  if (step < 0) {
+    step += NOTES_PER_OCTAVE;
+    octaves--;
   }
+  uint32_t result = (static_cast<uint32_t>(frequency) * pgm_read_word(&TRANSPOSE_RATIOS[step]) + 0x4000) >> 15;
+  for (; octaves > 0 && result <= MAX_FREQUENCY / 2; octaves--) result <<= 1;
+  for (; octaves < 0 && (result + 1) / 2 >= MIN_FREQUENCY; octaves++) result = (result + 1) >> 1;
+  while (result > MAX_FREQUENCY) result = (result + 1) >> 1;
+  return static_cast<uint16_t>(result);
 }
 
 /**
- * @brief Play a melody (non-blocking).
- * This function starts playing a melody (standard or RTTTL) and updates its state.
- * Call updateMelody() in the main loop to manage note progression.
- * For RTTTL melodies, set isDynamic to true and free melody/durations after playback.
- * @param state The MelodyState structure to manage the melody.
- * @param melody Array of ToneFrequency values representing the melody.
- * @param durations Array of ToneDuration values representing the durations.
- * @param length The number of notes in the melody.
- * @param isDynamic True if the melody arrays are dynamically allocated (e.g., from RTTTL).
- * @param repeatCount Number of times to repeat the melody (default: 1).
+ * @brief Get the frequency of a semitone of the pitch engine with 8 fractional bits.
+ * @param semitone Semitones above C0 (up to C12).
+ * @return The frequency (Hz) in 24.8 fixed point.
  */
-void playMelody(MelodyState& state, ToneFrequency* melody, ToneDuration* durations, size_t length, bool isDynamic = false, uint8_t repeatCount = 1) {
-  if (length == 0 || melody == nullptr || durations == nullptr) {
-    state.isPlaying = false;
-    return;
-  }
-  state.isPlaying = true;
-  state.currentNote = 0;
-  state.lastNoteTime = millis();
-  state.melody = melody;
-  state.durations = durations;
-  state.length = length;
-  state.isDynamic = isDynamic;
-  state.currentRepeat = 0;
-  state.totalRepeats = (repeatCount > 0) ? repeatCount : 1;
-  ToneState toneState = { false, 0, melody[0], durations[0] };
-  playTone(toneState, melody[0], durations[0]);
+uint32_t semitoneFrequency(uint8_t semitone) {
+  uint32_t frequency = static_cast<uint32_t>(pgm_read_word(&PITCH_TABLE[semitone % NOTES_PER_OCTAVE])) << 8;
+  uint8_t octave = semitone / NOTES_PER_OCTAVE;
+  return (octave >= 4) ? frequency << (octave - 4) : frequency >> (4 - octave);
 }
 
 /**
- * @brief Update the state of a melody.
- * Advances to the next note when the current note’s duration has elapsed.
- * Handles melody repeats and frees dynamic memory for RTTTL melodies after completion.
- * Must be called repeatedly in the main loop.
- * @param state The MelodyState structure to update.
+ * @brief Convert a frequency to a pitch, interpolating between the semitones of the pitch engine.
+ * @param frequency The frequency (Hz), at least MIN_FREQUENCY.
+ * @return Semitones above C0 in 16.16 fixed point.
  */
- /*
-void updateMelody(MelodyState& state) {
-  if (!state.isPlaying) {
-    return;
+uint32_t frequencyToPitch(uint16_t frequency) {
+  uint32_t target = static_cast<uint32_t>(frequency) << 8;
+  uint8_t low = NOTES_PER_OCTAVE - 1;  // B0, just below MIN_FREQUENCY
+  uint8_t high = (MAX_NOTE_OCTAVE + 1) * NOTES_PER_OCTAVE;
+  while (high - low > 1) {
+    uint8_t mid = (low + high) / 2;
+    if (semitoneFrequency(mid) <= target) low = mid;
+    else high = mid;
   }
-
-  if (state.currentNote >= state.length) {
-    if (state.currentRepeat + 1 < state.totalRepeats) {
-      // Restart melody for the next repeat
-      state.currentRepeat++;
-      state.currentNote = 0;
-      state.lastNoteTime = millis();
-      ToneState toneState = { false, 0, state.melody[0], state.durations[0] };
-      playTone(toneState, state.melody[0], state.durations[0]);
-      return;
-    }
-    // Melody and repeats complete
-    if (state.isDynamic) {
-      delete[] state.melody;
-      delete[] state.durations;
-      state.melody = nullptr;
-      state.durations = nullptr;
-    }
-    state.isPlaying = false;
-    noTone(getSpeakerPin());
-    return;
+  uint32_t below = semitoneFrequency(low);
+  uint32_t offset = target > below ? target - below : 0;
+  uint32_t span = semitoneFrequency(low + 1) - below;
+  while (span > 0xFFFF) {
+    offset >>= 1;
+    span >>= 1;
   }
+  return (static_cast<uint32_t>(low) << 16) + (offset << 16) / span;
+}
 
-  uint32_t currentTime = millis();
-  if (currentTime - state.lastNoteTime >= static_cast<uint16_t>(state.durations[state.currentNote]) + 50) {
-    state.currentNote++;
-    if (state.currentNote < state.length) {
-      ToneState toneState = { false, 0, state.melody[state.currentNote], state.durations[state.currentNote] };
-      playTone(toneState, state.melody[state.currentNote], state.durations[state.currentNote]);
-      state.lastNoteTime = currentTime;
-    }
-  }
-}*/
+/**
+ * @brief Convert a pitch back to a frequency, interpolating between the semitones of the pitch engine.
+ * @param pitch Semitones above C0 in 16.16 fixed point.
+ * @return The frequency (Hz), rounded.
+ */
+uint16_t pitchToFrequency(uint32_t pitch) {
+  uint8_t semitone = pitch >> 16;
+  uint32_t below = semitoneFrequency(semitone);
+  uint32_t span = semitoneFrequency(semitone + 1) - below;
+  uint32_t frequency = below + ((span * ((pitch >> 8) & 0xFF)) >> 8);
+  frequency = (frequency + 0x80) >> 8;
+  return frequency > MAX_FREQUENCY ? MAX_FREQUENCY : static_cast<uint16_t>(frequency);
+}
 
-void updateMelody(MelodyState& state) {
-  //Serial.print("isPlaying: "); Serial.println(state.isPlaying);
-  if (!state.isPlaying) {
-    return;
-  }
+/**
+ * @brief Check whether an RTTTL duration divider is one of 1, 2, 4, 8, 16 or 32.
+ * @param divider The duration divider.
+ * @return True if the divider is valid.
+ */
+bool isRTTTLDivider(uint16_t divider) {
+  return divider >= 1 && divider <= 32 && (divider & (divider - 1)) == 0;
+}
 
-  //Serial.print("currentNote: "); Serial.println(state.currentNote);
-  //Serial.print("currentRepeat: "); Serial.println(state.currentRepeat);
-  //Serial.print("totalRepeats: "); Serial.println(state.totalRepeats);
+/**
+ * @brief Parse the name and control section of an RTTTL string.
+ * Missing settings default to d=4, o=6, b=120; a d= other than 1, 2, 4, 8, 16 or 32 is ignored.
+ * @param cursor Start of the RTTTL string; on success it is left at the first note.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param header Structure to store the parsed settings.
+ * @return True if the name and control section were found, false otherwise.
+ */
+bool parseRTTTLHeader(const char*& cursor, bool isProgmem, RTTTLHeader& header) {
+  header.defaultDuration = 4;
+  header.defaultOctave = 6;
+  header.bpm = 120;
 
-  if (state.currentNote >= state.length) {
-    //Serial.println("Reached end of melody");
-    if (state.currentRepeat + 1 < state.totalRepeats) {
-      //Serial.println("Starting repeat");
-      state.currentRepeat++;
-      state.currentNote = 0;
-      state.lastNoteTime = millis();
-      ToneState toneState = { false, 0, state.melody[0], state.durations[0] };
-      playTone(toneState, state.melody[0], state.durations[0]);
-      return;
-    }
-    //Serial.println("Melody complete");
-    if (state.isDynamic) {
-      delete[] state.melody;
-      delete[] state.durations;
-      state.melody = nullptr;
-      state.durations = nullptr;
-    }
-    state.isPlaying = false;
-    noTone(getSpeakerPin());
-    return;
+  char c;
+  while ((c = readRTTTLChar(cursor, isProgmem)) != ':') {
+    if (!c) return false;
+    cursor++;
   }
+  cursor++;
 
-  uint32_t currentTime = millis();
-  if (currentTime - state.lastNoteTime >= static_cast<uint16_t>(state.durations[state.currentNote]) + 50) {
-    state.currentNote++;
-    Serial.print("Advancing to note: "); Serial.println(state.currentNote);
-    if (state.currentNote < state.length) {
-      ToneState toneState = { false, 0, state.melody[state.currentNote], state.durations[state.currentNote] };
-      playTone(toneState, state.melody[state.currentNote], state.durations[state.currentNote]);
-      state.lastNoteTime = currentTime;
+  while ((c = readRTTTLChar(cursor, isProgmem)) != ':') {
+    if (!c) return false;
+    if (c == ',' || isspace(c)) {
+      cursor++;
+      continue;
+    }
+    char key = tolower(c);
+    cursor++;
+    if (readRTTTLChar(cursor, isProgmem) == '=') cursor++;
+    uint16_t value = 0;
+    while (isdigit(c = readRTTTLChar(cursor, isProgmem))) {
+      value = value * 10 + (c - '0');
+      cursor++;
     }
+    if (key == 'd' && isRTTTLDivider(value)) header.defaultDuration = value;
+    else if (key == 'o') header.defaultOctave = value;
+    else if (key == 'b' && value > 0) header.bpm = value;
+    while ((c = readRTTTLChar(cursor, isProgmem)) && c != ',' && c != ':') cursor++;
   }
+  cursor++;
+
+  header.wholeNote = (60000 / header.bpm) * 4;
+  return true;
 }
 
 /**
- * @brief Play an RTTTL melody (non-blocking) with optional repeats.
- * This function parses an RTTTL string (RAM or PROGMEM) and starts playing the melody.
- * Call updateMelody() in the main loop to manage note progression.
- * @param state The MelodyState structure to manage the melody.
- * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
+ * @brief Fields of one RTTTL note, before conversion to frequency and duration.
+ */
+struct RTTTLNote {
+  uint8_t noteIndex; /**< Semitone index (0 = C, 11 = B); 12 or more for a pause. */
+  uint8_t octave;    /**< Octave of the note. */
+  uint8_t divider;   /**< Duration divider (4 = quarter note). */
+  bool isDotted;     /**< Whether the note is dotted (duration x 1.5). */
+};
+
+/**
+ * @brief Read the fields of the next note of an RTTTL string.
+ * Reads directly from RAM or PROGMEM without copying the string. A divider other than 1, 2, 4, 8, 16 or 32 is
+ * replaced by the default one.
+ * @param cursor Position of the next note; it is advanced past the note.
  * @param isProgmem True if the RTTTL string is stored in PROGMEM.
- * @param repeatCount Number of times to repeat the melody (default: 1).
+ * @param header Settings from parseRTTTLHeader().
+ * @param note Structure to store the note fields.
+ * @return True if a note was read, false at the end of the string.
  */
-void playRTTTLMelody(MelodyState& state, const char* rtttl, bool isProgmem = false, uint8_t repeatCount = 1) {
+bool readRTTTLNote(const char*& cursor, bool isProgmem, const RTTTLHeader& header, RTTTLNote& note) {
+  char c = readRTTTLChar(cursor, isProgmem);
+  while (c == ',' || isspace(c)) c = readRTTTLChar(++cursor, isProgmem);
+  if (!c) return false;
+
+  uint16_t divider = 0;
+  while (isdigit(c)) {
+    if (divider <= 32) divider = divider * 10 + (c - '0');
+    c = readRTTTLChar(++cursor, isProgmem);
+  }
+  note.divider = isRTTTLDivider(divider) ? divider : header.defaultDuration;
+  if (!c) return false;
+
+  switch (tolower(c)) {
+    case 'c': note.noteIndex = 0; break;
+    case 'd': note.noteIndex = 2; break;
+    case 'e': note.noteIndex = 4; break;
+    case 'f': note.noteIndex = 5; break;
+    case 'g': note.noteIndex = 7; break;
+    case 'a': note.noteIndex = 9; break;
+    case 'b': note.noteIndex = 11; break;
+    default: note.noteIndex = NOTES_PER_OCTAVE; break;
+  }
+  c = readRTTTLChar(++cursor, isProgmem);
+  if (c == '#') {
+    if (note.noteIndex < NOTES_PER_OCTAVE) note.noteIndex++;
+    c = readRTTTLChar(++cursor, isProgmem);
+  }
+
+  note.octave = header.defaultOctave;
+  if (isdigit(c)) {
+    note.octave = c - '0';
+    c = readRTTTLChar(++cursor, isProgmem);
+  }
+
+  note.isDotted = (c == '.');
+  if (note.isDotted) c = readRTTTLChar(++cursor, isProgmem);
+
+  while (c && c != ',') c = readRTTTLChar(++cursor, isProgmem);
+  return true;
+}
+
+/**
+ * @brief Get the duration of an RTTTL note.
+ * @param header Settings from parseRTTTLHeader().
+ * @param note The note from readRTTTLNote().
+ * @return The duration in ms, clamped to MELODY_MAX_NOTE_DURATION.
+ */
+ToneDuration rtttlNoteDuration(const RTTTLHeader& header, const RTTTLNote& note) {
+  uint32_t duration = header.wholeNote / note.divider;
+  if (note.isDotted) duration += duration / 2;
+  if (duration > MELODY_MAX_NOTE_DURATION) duration = MELODY_MAX_NOTE_DURATION;
+  return static_cast<ToneDuration>(duration);
+}
+
+/**
+ * @brief Decode the next note of an RTTTL string.
+ * Reads directly from RAM or PROGMEM without copying the string.
+ * @param cursor Position of the next note; it is advanced past the decoded note.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param header Settings from parseRTTTLHeader().
+ * @param frequency Variable to store the note frequency (PAUSE for rests).
+ * @param duration Variable to store the note duration.
+ * @return True if a note was decoded, false at the end of the string.
+ */
+bool parseRTTTLNote(const char*& cursor, bool isProgmem, const RTTTLHeader& header, ToneFrequency& frequency, ToneDuration& duration) {
+  RTTTLNote note;
+  if (!readRTTTLNote(cursor, isProgmem, header, note)) {
+    return false;
+  }
+  frequency = pitchFrequency(note.noteIndex, note.octave);
+  duration = rtttlNoteDuration(header, note);
+  return true;
+}
+
+/**
+ * @brief Initialize an RTTTLStream before feeding it a new melody.
+ * @param stream The RTTTLStream structure to initialize.
+ */
+void initRTTTLStream(RTTTLStream& stream) {
+  stream.head = 0;
+  stream.count = 0;
+  stream.phase = RTTTL_STREAM_NAME;
+  stream.tokenLength = 0;
+  stream.underruns = 0;
+  stream.header.defaultDuration = 4;
+  stream.header.defaultOctave = 6;
+  stream.header.bpm = 120;
+  stream.header.wholeNote = (60000 / stream.header.bpm) * 4;
+}
+
+/**
+ * @brief Apply the control pair held in the token of an RTTTLStream, with the rules of parseRTTTLHeader().
+ * @param stream The RTTTLStream structure.
+ */
+void applyRTTTLStreamControl(RTTTLStream& stream) {
+  stream.token[stream.tokenLength] = '\0';
+  stream.tokenLength = 0;
+  const char* cursor = stream.token;
+  if (!*cursor) {
+    return;
+  }
+  char key = tolower(*cursor++);
+  if (*cursor == '=') cursor++;
+  uint16_t value = 0;
+  while (isdigit(*cursor)) {
+    value = value * 10 + (*cursor++ - '0');
+  }
+  if (key == 'd' && isRTTTLDivider(value)) stream.header.defaultDuration = value;
+  else if (key == 'o') stream.header.defaultOctave = value;
+  else if (key == 'b' && value > 0) stream.header.bpm = value;
+}
+
+/**
+ * @brief Decode the note held in the token of an RTTTLStream into its ring buffer.
+ * @param stream The RTTTLStream structure.
+ * @return False if the buffer is full (the token is kept), true otherwise.
+ */
+bool flushRTTTLStreamNote(RTTTLStream& stream) {
+  if (stream.tokenLength == 0) {
+    return true;
+  }
+  if (stream.count >= RTTTL_STREAM_BUFFER_NOTES) {
+    return false;
+  }
+  stream.token[stream.tokenLength] = '\0';
+  stream.tokenLength = 0;
+  const char* cursor = stream.token;
+  ToneFrequency frequency;
+  ToneDuration duration;
+  if (parseRTTTLNote(cursor, false, stream.header, frequency, duration)) {
+    RTTTLStreamNote& note = stream.notes[(stream.head + stream.count) % RTTTL_STREAM_BUFFER_NOTES];
+    note.frequency = static_cast<uint16_t>(frequency);
+    note.duration = static_cast<uint16_t>(duration);
+    stream.count++;
+  }
+  return true;
+}
+
+/**
+ * @brief Feed one character of RTTTL text to an RTTTLStream.
+ * A newline or NUL character after the first note ends the melody (see also endRTTTLStream()).
+ * @param stream The RTTTLStream structure.
+ * @param c The character.
+ * @return False if the character completes a note but the buffer is full; feed it again once a note has been played.
+ */
+bool pushRTTTLStreamChar(RTTTLStream& stream, char c) {
+  switch (stream.phase) {
+    case RTTTL_STREAM_NAME:
+      if (c == ':') stream.phase = RTTTL_STREAM_CONTROL;
+      return true;
+    case RTTTL_STREAM_CONTROL:
+      if (c == ',' || c == ':') {
+        applyRTTTLStreamControl(stream);
+        if (c == ':') {
+          stream.header.wholeNote = (60000 / stream.header.bpm) * 4;
+          stream.phase = RTTTL_STREAM_NOTES;
+        }
+      } else if (!isspace(c) && stream.tokenLength < RTTTL_STREAM_TOKEN_SIZE - 1) {
+        stream.token[stream.tokenLength++] = c;
+      }
+      return true;
+    case RTTTL_STREAM_NOTES:
+      if (c == ',' || c == '\n' || c == '\0') {
+        if (!flushRTTTLStreamNote(stream)) return false;
+        if (c != ',') stream.phase = RTTTL_STREAM_ENDED;
+      } else if (!isspace(c) && stream.tokenLength < RTTTL_STREAM_TOKEN_SIZE - 1) {
+        stream.token[stream.tokenLength++] = c;
+      }
+      return true;
+  }
+  return true;
+}
+
+/**
+ * @brief Feed a chunk of RTTTL text to an RTTTLStream.
+ * @param stream The RTTTLStream structure.
+ * @param data The characters received.
+ * @param length The number of characters.
+ * @return The number of characters taken; fewer than length when the buffer is full (feed the rest later).
+ */
+size_t feedRTTTLStream(RTTTLStream& stream, const char* data, size_t length) {
+  size_t taken = 0;
+  while (taken < length && pushRTTTLStreamChar(stream, data[taken])) {
+    taken++;
+  }
+  return taken;
+}
+
+/**
+ * @brief Feed an RTTTLStream from an input with available(), peek() and read(), such as Serial or any Arduino Stream.
+ * Reads only what is already received and what the buffer can take, so it never blocks.
+ * @tparam Input Input type (e.g. HardwareSerial).
+ * @param stream The RTTTLStream structure.
+ * @param input The input to read from.
+ * @return The number of characters taken.
+ */
+template <typename Input>
+size_t feedRTTTLStream(RTTTLStream& stream, Input& input) {
+  size_t taken = 0;
+  while (input.available() > 0 && pushRTTTLStreamChar(stream, static_cast<char>(input.peek()))) {
+    input.read();
+    taken++;
+  }
+  return taken;
+}
+
+/**
+ * @brief Mark the end of the input of an RTTTLStream, decoding its last note.
+ * @param stream The RTTTLStream structure.
+ * @return False if the last note did not fit in the buffer; call it again once a note has been played.
+ */
+bool endRTTTLStream(RTTTLStream& stream) {
+  if (stream.phase != RTTTL_STREAM_NOTES) {
+    stream.phase = RTTTL_STREAM_ENDED;
+    return true;
+  }
+  return pushRTTTLStreamChar(stream, '\0');
+}
+
+/**
+ * @brief Get the number of decoded notes waiting in an RTTTLStream.
+ * @param stream The RTTTLStream structure.
+ * @return The number of notes in the buffer.
+ */
+uint8_t rtttlStreamAvailable(const RTTTLStream& stream) {
+  return stream.count;
+}
+
+/**
+ * @brief Take the oldest decoded note of an RTTTLStream.
+ * @param stream The RTTTLStream structure.
+ * @param frequency Variable to store the note frequency (PAUSE for rests).
+ * @param duration Variable to store the note duration.
+ * @return True if a note was taken, false if the buffer is empty.
+ */
+bool popRTTTLStreamNote(RTTTLStream& stream, ToneFrequency& frequency, ToneDuration& duration) {
+  if (stream.count == 0) {
+    return false;
+  }
+  const RTTTLStreamNote& note = stream.notes[stream.head];
+  frequency = static_cast<ToneFrequency>(note.frequency);
+  duration = static_cast<ToneDuration>(note.duration);
+  stream.head = (stream.head + 1) % RTTTL_STREAM_BUFFER_NOTES;
+  stream.count--;
+  return true;
+}
+
+/**
+ * @brief Parse an RTTTL string into melody and duration arrays.
+ * Converts an RTTTL string (RAM or PROGMEM) into arrays of ToneFrequency and ToneDuration.
+ * The string is decoded in place in two passes (count, then fill), so only the returned arrays are allocated.
+ * The caller is responsible for freeing the allocated memory.
+ * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
+ * @param melody Pointer to store the allocated ToneFrequency array.
+ * @param durations Pointer to store the allocated ToneDuration array.
+ * @param length Pointer to store the number of notes parsed.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @return True if parsing was successful, false otherwise.
+ */
+bool parseRTTTL(const char* rtttl, ToneFrequency*& melody, ToneDuration*& durations, size_t& length, bool isProgmem = false) {
+  length = 0;
+  if (!rtttl) {
+    return false;
+  }
+
+  RTTTLHeader header;
+  const char* notes = rtttl;
+  if (!parseRTTTLHeader(notes, isProgmem, header)) return false;
+
+  ToneFrequency frequency;
+  ToneDuration duration;
+  size_t noteCount = 0;
+  const char* ptr = notes;
+  while (noteCount < MAX_RTTTL_NOTES && parseRTTTLNote(ptr, isProgmem, header, frequency, duration)) {
+    noteCount++;
+  }
+
+  melody = new ToneFrequency[noteCount];
+  durations = new ToneDuration[noteCount];
+  ptr = notes;
+  for (size_t i = 0; i < noteCount; i++) {
+    parseRTTTLNote(ptr, isProgmem, header, melody[i], durations[i]);
+  }
+  length = noteCount;
+  return true;
+}
+
+/**
+ * @brief Get the start time of the next step of a periodic sound.
+ * Steps follow the previous step time plus the period, so loop latency does not accumulate;
+ * if the loop is more than a whole period late, the timeline restarts at the current time.
+ * @param stepTime The time the step that just ended started (ms).
+ * @param period The length of that step (ms).
+ * @param currentTime The current time (ms).
+ * @return The time the next step starts (ms).
+ */
+uint32_t nextStepTime(uint32_t stepTime, uint16_t period, uint32_t currentTime) {
+  uint32_t nextTime = stepTime + period;
+  return (currentTime - nextTime >= period) ? currentTime : nextTime;
+}
+
+/**
+ * @brief Play a single tone (non-blocking).
+ * This function starts playing a tone and updates its state for non-blocking operation.
+ * Call updateTone() in the main loop to manage tone completion.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The ToneState structure to manage the tone.
+ * @param toneFrequency The frequency of the tone to be played.
+ * @param toneDuration The duration of the tone to be played.
+ */
+template <typename Output>
+void playTone(Output& output, ToneState& state, ToneFrequency toneFrequency, ToneDuration toneDuration) {
+  if (toneFrequency < MIN_FREQUENCY || toneDuration == 0) {
+    state.isPlaying = false;
+    return;
+  }
+  state.isPlaying = true;
+  state.time = millis();
+  state.frequency = toneFrequency;
+  state.duration = toneDuration;
+  if (toneFrequency != PAUSE) {
+    output.play(static_cast<uint16_t>(toneFrequency));
+  } else {
+    output.stop();
+  }
+}
+
+/**
+ * @brief Same as playTone(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playTone(ToneState& state, ToneFrequency toneFrequency, ToneDuration toneDuration) {
+  SpeakerOutput output;
+  playTone(output, state, toneFrequency, toneDuration);
+}
+
+/**
+ * @brief Update the state of a playing tone.
+ * Checks if the tone duration has elapsed and stops the tone if necessary.
+ * Must be called repeatedly in the main loop.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The ToneState structure to update.
+ */
+template <typename Output>
+void updateTone(Output& output, ToneState& state) {
+  if (state.isPlaying && soundElapsed(state.time, millis()) >= static_cast<uint16_t>(state.duration)) {
+    output.stop();
+    state.isPlaying = false;
+  }
+}
+
+/**
+ * @brief Same as updateTone(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateTone(ToneState& state) {
+  SpeakerOutput output;
+  updateTone(output, state);
+}
+
+/**
+ * @brief Play an alert tone sequence (non-blocking).
+ * This function starts a sequence of alert tones (the first one sounds immediately) and updates its state.
+ * Call updateAlert() in the main loop to manage the sequence.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The AlertState structure to manage the alert.
+ * @param nr The number of tones in the sequence.
+ * @param toneFrequency The frequency of the alert tone.
+ * @param toneDuration The duration of each alert tone.
+ * @param lapse The time lapse between consecutive tones.
+ */
+template <typename Output>
+void playAlert(Output& output, AlertState& state, uint8_t nr, ToneFrequency toneFrequency, ToneDuration toneDuration, uint16_t lapse) {
+  if (nr == 0 || toneFrequency < MIN_FREQUENCY || toneDuration == 0) {
+    state.isPlaying = false;
+    return;
+  }
+  state.isPlaying = true;
+  state.isToneOn = true;
+  state.currentCount = 0;
+  state.totalCount = nr;
+  state.time = millis();
+  state.frequency = toneFrequency;
+  state.duration = toneDuration;
+  state.lapse = lapse;
+  output.play(static_cast<uint16_t>(toneFrequency));
+}
+
+/**
+ * @brief Same as playAlert(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playAlert(AlertState& state, uint8_t nr, ToneFrequency toneFrequency, ToneDuration toneDuration, uint16_t lapse) {
+  SpeakerOutput output;
+  playAlert(output, state, nr, toneFrequency, toneDuration, lapse);
+}
+
+/**
+ * @brief Update the state of an alert sequence.
+ * Alternates each tone (duration) with a silent lapse until all tones have been played.
+ * Must be called repeatedly in the main loop.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The AlertState structure to update.
+ */
+template <typename Output>
+void updateAlert(Output& output, AlertState& state) {
+  if (!state.isPlaying) {
+    return;
+  }
+
+  uint32_t currentTime = millis();
+  if (state.isToneOn) {
+    if (soundElapsed(state.time, currentTime) >= static_cast<uint16_t>(state.duration)) {
+      output.stop();
+      state.isToneOn = false;
+      state.currentCount++;
+      state.time = nextStepTime(soundTimeAt(state.time, currentTime), static_cast<uint16_t>(state.duration), currentTime);
+      if (state.currentCount >= state.totalCount) {
+        state.isPlaying = false;
+      }
+    }
+  } else if (soundElapsed(state.time, currentTime) >= state.lapse) {
+    output.play(static_cast<uint16_t>(state.frequency));
+    state.isToneOn = true;
+    state.time = nextStepTime(soundTimeAt(state.time, currentTime), state.lapse, currentTime);
+  }
+}
+
+/**
+ * @brief Same as updateAlert(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateAlert(AlertState& state) {
+  SpeakerOutput output;
+  updateAlert(output, state);
+}
+
+/** @brief Number of header words in a packed melody image (whole-note duration in ms, note count). */
+#define PACKED_HEADER_WORDS 2
+/** @brief Whole-note value marking an image whose duration codes index TONE_DURATIONS instead. */
+#define PACKED_TONE_DURATIONS 0
+/** @brief Pitch field of a packed note, bits 12-15 (0 = pause, 1-12 = C to B). */
+#define PACKED_PITCH_SHIFT 12
+/** @brief Octave field of a packed note, bits 9-11. */
+#define PACKED_OCTAVE_SHIFT 9
+/** @brief Highest octave a packed note can hold. */
+#define PACKED_MAX_OCTAVE 7
+/** @brief Duration code of a packed note, bits 6-8 (duration = whole note >> code, or TONE_DURATIONS[code]). */
+#define PACKED_DURATION_SHIFT 6
+/** @brief Dotted flag of a packed note, bit 5. Bits 0-4 are reserved and must be zero. */
+#define PACKED_DOTTED 0x0020
+
+/** @brief ToneDuration values addressed by duration codes in PACKED_TONE_DURATIONS images. */
+const uint16_t TONE_DURATIONS[] PROGMEM = { VERY_SHORT_DURATION, SHORT_DURATION, MEDIUM_DURATION, LONG_DURATION };
+
+/**
+ * @brief Pack a note into a single 16-bit word.
+ * @param pitch 0 for a pause, 1-12 for C to B.
+ * @param octave The octave of the note (0 to PACKED_MAX_OCTAVE).
+ * @param durationCode Power-of-two divider of the whole note (0 = whole, 2 = quarter, 5 = 1/32),
+ * or index into TONE_DURATIONS for PACKED_TONE_DURATIONS images.
+ * @param isDotted True for a dotted note (duration x 1.5).
+ * @return The packed note.
+ */
+constexpr uint16_t packNote(uint8_t pitch, uint8_t octave, uint8_t durationCode, bool isDotted) {
+  return static_cast<uint16_t>(((pitch & 0x0F) << PACKED_PITCH_SHIFT) | ((octave & 0x07) << PACKED_OCTAVE_SHIFT) | ((durationCode & 0x07) << PACKED_DURATION_SHIFT) | (isDotted ? PACKED_DOTTED : 0));
+}
+
+/**
+ * @brief Read one word of a packed melody image.
+ * @param ptr Pointer to the word (RAM or PROGMEM).
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @return The word at ptr.
+ */
+uint16_t readPackedWord(const uint16_t* ptr, bool isProgmem) {
+  return isProgmem ? pgm_read_word(ptr) : *ptr;
+}
+
+/**
+ * @brief Get the frequency of a packed note.
+ * @param note The packed note.
+ * @return The frequency in Hz, or PAUSE.
+ */
+ToneFrequency packedNoteFrequency(uint16_t note) {
+  uint8_t pitch = note >> PACKED_PITCH_SHIFT;
+  if (pitch == 0) return PAUSE;
+  return pitchFrequency(pitch - 1, (note >> PACKED_OCTAVE_SHIFT) & 0x07);
+}
+
+/**
+ * @brief Check whether the whole note of an RTTTL header can be stored in a packed image.
+ * Tempos above 60000 bpm give a whole note of 0 ms, which packed images reserve for PACKED_TONE_DURATIONS.
+ * @param header Settings from parseRTTTLHeader().
+ * @return True if the whole note is 1..UINT16_MAX ms.
+ */
+bool isPackedWholeNote(const RTTTLHeader& header) {
+  return header.wholeNote != PACKED_TONE_DURATIONS && header.wholeNote <= UINT16_MAX;
+}
+
+/**
+ * @brief Get the duration of a packed note.
+ * @param note The packed note.
+ * @param wholeNote Duration of a whole note (ms), or PACKED_TONE_DURATIONS.
+ * @return The duration in ms, clamped to MELODY_MAX_NOTE_DURATION.
+ */
+ToneDuration packedNoteDuration(uint16_t note, uint32_t wholeNote) {
+  uint8_t code = (note >> PACKED_DURATION_SHIFT) & 0x07;
+  uint32_t duration;
+  if (wholeNote != PACKED_TONE_DURATIONS) {
+    duration = wholeNote >> code;
+  } else {
+    duration = (code < sizeof(TONE_DURATIONS) / sizeof(TONE_DURATIONS[0])) ? pgm_read_word(&TONE_DURATIONS[code]) : 0;
+  }
+  if (note & PACKED_DOTTED) duration += duration / 2;
+  if (duration > MELODY_MAX_NOTE_DURATION) duration = MELODY_MAX_NOTE_DURATION;
+  return static_cast<ToneDuration>(duration);
+}
+
+/**
+ * @brief Pack the fields of an RTTTL note.
+ * @param note The note fields from readRTTTLNote().
+ * @param packed Variable to store the packed note.
+ * @return False if the divider is not a power of two up to 128 or the octave is above PACKED_MAX_OCTAVE.
+ */
+bool packRTTTLNote(const RTTTLNote& note, uint16_t& packed) {
+  uint8_t code = 0;
+  while (code < 8 && (1 << code) != note.divider) code++;
+  if (code == 8) return false;
+  if (note.noteIndex >= NOTES_PER_OCTAVE) {
+    packed = packNote(0, 0, code, note.isDotted);
+    return true;
+  }
+  if (note.octave > PACKED_MAX_OCTAVE) return false;
+  packed = packNote(note.noteIndex + 1, note.octave, code, note.isDotted);
+  return true;
+}
+
+/**
+ * @brief Parse an RTTTL string into a packed melody image.
+ * Allocates a single array of note count + PACKED_HEADER_WORDS words (2 bytes per note instead of
+ * separate frequency and duration arrays). The caller is responsible for freeing it with delete[].
+ * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
+ * @param packed Pointer to store the allocated image.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @return True if parsing was successful, false if the string is invalid, its tempo or a note cannot be packed.
+ */
+bool parseRTTTLPacked(const char* rtttl, uint16_t*& packed, bool isProgmem = false) {
+  if (!rtttl) {
+    return false;
+  }
+
+  RTTTLHeader header;
+  const char* notes = rtttl;
+  if (!parseRTTTLHeader(notes, isProgmem, header) || !isPackedWholeNote(header)) return false;
+
+  RTTTLNote note;
+  uint16_t word;
+  size_t noteCount = 0;
+  const char* ptr = notes;
+  while (noteCount < MAX_RTTTL_NOTES && readRTTTLNote(ptr, isProgmem, header, note)) {
+    if (!packRTTTLNote(note, word)) return false;
+    noteCount++;
+  }
+
+  packed = new uint16_t[noteCount + PACKED_HEADER_WORDS];
+  packed[0] = header.wholeNote;
+  packed[1] = noteCount;
+  ptr = notes;
+  for (size_t i = 0; i < noteCount; i++) {
+    readRTTTLNote(ptr, isProgmem, header, note);
+    packRTTTLNote(note, packed[PACKED_HEADER_WORDS + i]);
+  }
+  return true;
+}
+
+/**
+ * @brief Convert ToneFrequency and ToneDuration arrays into a packed melody image.
+ * Frequencies are mapped to the nearest note of the pitch engine (e.g. MEDIUM_C = 523 Hz plays as 524 Hz).
+ * Durations must be ToneDuration values; the image uses PACKED_TONE_DURATIONS.
+ * @param melody Array of ToneFrequency values.
+ * @param durations Array of ToneDuration values.
+ * @param length The number of notes.
+ * @param packed Array of at least length + PACKED_HEADER_WORDS words to store the image.
+ * @return True if every note could be packed, false otherwise.
+ */
+bool packMelody(const ToneFrequency* melody, const ToneDuration* durations, size_t length, uint16_t* packed) {
+  if (!melody || !durations || !packed || length > UINT16_MAX) {
+    return false;
+  }
+  packed[0] = PACKED_TONE_DURATIONS;
+  packed[1] = length;
+  for (size_t i = 0; i < length; i++) {
+    uint8_t code = 0;
+    while (code < sizeof(TONE_DURATIONS) / sizeof(TONE_DURATIONS[0]) && pgm_read_word(&TONE_DURATIONS[code]) != durations[i]) code++;
+    if (code == sizeof(TONE_DURATIONS) / sizeof(TONE_DURATIONS[0])) return false;
+    uint8_t noteIndex = 0;
+    uint8_t octave = 0;
+    if (melody[i] == PAUSE) {
+      packed[PACKED_HEADER_WORDS + i] = packNote(0, 0, code, false);
+    } else if (frequencyToNote(melody[i], noteIndex, octave) && octave <= PACKED_MAX_OCTAVE) {
+      packed[PACKED_HEADER_WORDS + i] = packNote(noteIndex + 1, octave, code, false);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Parse an RTTTL string into a caller-provided packed melody image, without allocating.
+ * Keeps at most MAX_RTTTL_NOTES notes, like parseRTTTLPacked().
+ * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
+ * @param packed Array of at least maxNotes + PACKED_HEADER_WORDS words to store the image, or nullptr to only check
+ * that the melody can be packed into maxNotes notes.
+ * @param maxNotes The number of notes packed can hold.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @return True if parsing was successful, false if the string is invalid, its tempo or a note cannot be packed or the
+ * melody does not fit.
+ */
+bool packRTTTL(const char* rtttl, uint16_t* packed, size_t maxNotes, bool isProgmem = false) {
+  if (!rtttl) {
+    return false;
+  }
+
+  RTTTLHeader header;
+  const char* ptr = rtttl;
+  if (!parseRTTTLHeader(ptr, isProgmem, header) || !isPackedWholeNote(header)) return false;
+
+  RTTTLNote note;
+  size_t noteCount = 0;
+  while (noteCount < MAX_RTTTL_NOTES && readRTTTLNote(ptr, isProgmem, header, note)) {
+    uint16_t word;
+    if (noteCount >= maxNotes || !packRTTTLNote(note, word)) return false;
+    if (packed) packed[PACKED_HEADER_WORDS + noteCount] = word;
+    noteCount++;
+  }
+  if (packed) {
+    packed[0] = header.wholeNote;
+    packed[1] = noteCount;
+  }
+  return true;
+}
+
+/** @brief Number of header bytes in a compact melody image (whole-note duration and note count, little-endian, then start byte). */
+#define COMPACT_HEADER_BYTES 5
+/** @brief Nibble raising the octave of the following notes by one. Nibbles 0-12 are a pause or C to B, as in packed notes. */
+#define COMPACT_OCTAVE_UP 13
+/** @brief Nibble lowering the octave of the following notes by one. */
+#define COMPACT_OCTAVE_DOWN 14
+/** @brief Nibble followed by the duration of the following notes: duration code in bits 0-2, dotted flag in bit 3. */
+#define COMPACT_DURATION 15
+
+/**
+ * @brief Read one byte of a compact melody image.
+ * @param ptr Pointer to the byte (RAM or PROGMEM).
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @return The byte at ptr.
+ */
+uint8_t readCompactByte(const uint8_t* ptr, bool isProgmem) {
+  return isProgmem ? pgm_read_byte(ptr) : *ptr;
+}
+
+/**
+ * @brief Read a little-endian 16-bit field of a compact melody image header.
+ * @param ptr Pointer to the low byte.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @return The field.
+ */
+uint16_t readCompactWord(const uint8_t* ptr, bool isProgmem) {
+  return static_cast<uint16_t>(readCompactByte(ptr, isProgmem) | (readCompactByte(ptr + 1, isProgmem) << 8));
+}
+
+/**
+ * @brief Set a cursor on the first note of a compact melody image, with the octave and duration of its header.
+ * @param compact The compact image.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @param cursor The cursor to set.
+ */
+void startCompactCursor(const uint8_t* compact, bool isProgmem, CompactCursor& cursor) {
+  uint8_t start = readCompactByte(compact + 4, isProgmem);
+  cursor.position = 0;
+  cursor.octave = start & 0x07;
+  cursor.duration = start >> 4;
+}
+
+/**
+ * @brief Read the nibble at a cursor and move the cursor past it (high nibble of each byte first).
+ * @param compact The compact image.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @param cursor The cursor.
+ * @return The nibble.
+ */
+uint8_t readCompactNibble(const uint8_t* compact, bool isProgmem, CompactCursor& cursor) {
+  uint8_t byte = readCompactByte(compact + COMPACT_HEADER_BYTES + (cursor.position >> 1), isProgmem);
+  uint8_t nibble = (cursor.position & 1) ? (byte & 0x0F) : (byte >> 4);
+  cursor.position++;
+  return nibble;
+}
+
+/**
+ * @brief Decode the next note of a compact melody image as a packed note.
+ * Octave and duration changes in front of the note are applied to the cursor, so the following notes keep them.
+ * @param compact The compact image.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @param cursor The cursor, moved past the note.
+ * @param note Variable to store the packed note.
+ * @return False if the image is malformed (octave out of range, or no note after the longest valid run of changes).
+ */
+bool readCompactNote(const uint8_t* compact, bool isProgmem, CompactCursor& cursor, uint16_t& note) {
+  // At most PACKED_MAX_OCTAVE octave steps and one duration change (two nibbles) come before a note
+  for (uint8_t i = 0; i < PACKED_MAX_OCTAVE + 3; i++) {
+    uint8_t nibble = readCompactNibble(compact, isProgmem, cursor);
+    if (nibble <= NOTES_PER_OCTAVE) {
+      note = packNote(nibble, nibble ? cursor.octave : 0, cursor.duration & 0x07, cursor.duration & 0x08);
+      return true;
+    }
+    if (nibble == COMPACT_DURATION) {
+      cursor.duration = readCompactNibble(compact, isProgmem, cursor);
+      i++;
+    } else if (nibble == COMPACT_OCTAVE_UP) {
+      if (cursor.octave == PACKED_MAX_OCTAVE) return false;
+      cursor.octave++;
+    } else {
+      if (cursor.octave == 0) return false;
+      cursor.octave--;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Get the duration nibble of a packed note as written in a compact image.
+ * @param note The packed note.
+ * @return The duration code in bits 0-2 and the dotted flag in bit 3.
+ */
+uint8_t compactNoteDuration(uint16_t note) {
+  return static_cast<uint8_t>(((note >> PACKED_DURATION_SHIFT) & 0x07) | ((note & PACKED_DOTTED) ? 0x08 : 0));
+}
+
+/**
+ * @brief Append a nibble to a compact melody image being written.
+ * @param compact The image, or nullptr when only its size is computed.
+ * @param capacity Size of compact (bytes).
+ * @param position Index of the nibble after the header, incremented.
+ * @return False if the nibble does not fit.
+ */
+bool writeCompactNibble(uint8_t* compact, size_t capacity, size_t& position, uint8_t nibble) {
+  if (position >= UINT16_MAX) return false;
+  size_t index = COMPACT_HEADER_BYTES + (position >> 1);
+  if (compact) {
+    if (index >= capacity) return false;
+    compact[index] = (position & 1) ? static_cast<uint8_t>(compact[index] | nibble) : static_cast<uint8_t>(nibble << 4);
+  }
+  position++;
+  return true;
+}
+
+/**
+ * @brief Convert a packed melody image into a compact melody image (see playCompactMelody()).
+ * A note is one nibble (a pause or C to B) played in the current octave for the current duration. Changing the
+ * octave costs one nibble per octave and changing the duration two, so a melody takes about one byte per note
+ * instead of two. The compact image plays exactly like the packed one (only the unused octave of pauses is dropped).
+ * @param packed The packed melody image.
+ * @param compact Array to store the compact image, or nullptr to only compute its size.
+ * @param capacity Size of compact (bytes).
+ * @param isProgmem True if the packed image is stored in PROGMEM.
+ * @return The size of the compact image (bytes), or 0 if it does not fit or a note is not a valid packed note.
+ */
+size_t compactMelody(const uint16_t* packed, uint8_t* compact, size_t capacity, bool isProgmem = false) {
+  if (!packed || (compact && capacity < COMPACT_HEADER_BYTES)) {
+    return 0;
+  }
+  uint16_t length = readPackedWord(packed + 1, isProgmem);
+  const uint16_t* notes = packed + PACKED_HEADER_WORDS;
+  // Start in the octave of the first note (not of a leading pause) and with the duration of the first note
+  uint8_t octave = 4;
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t note = readPackedWord(notes + i, isProgmem);
+    if (note >> PACKED_PITCH_SHIFT) {
+      octave = (note >> PACKED_OCTAVE_SHIFT) & 0x07;
+      break;
+    }
+  }
+  uint8_t duration = length ? compactNoteDuration(readPackedWord(notes, isProgmem)) : 0;
+  if (compact) {
+    uint16_t wholeNote = readPackedWord(packed, isProgmem);
+    compact[0] = wholeNote & 0xFF;
+    compact[1] = wholeNote >> 8;
+    compact[2] = length & 0xFF;
+    compact[3] = length >> 8;
+    compact[4] = static_cast<uint8_t>((duration << 4) | octave);
+  }
+
+  size_t position = 0;
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t note = readPackedWord(notes + i, isProgmem);
+    uint8_t pitch = note >> PACKED_PITCH_SHIFT;
+    if (pitch > NOTES_PER_OCTAVE || (note & (PACKED_DOTTED - 1))) return 0;
+    uint8_t noteDuration = compactNoteDuration(note);
+    if (noteDuration != duration) {
+      if (!writeCompactNibble(compact, capacity, position, COMPACT_DURATION) || !writeCompactNibble(compact, capacity, position, noteDuration)) return 0;
+      duration = noteDuration;
+    }
+    uint8_t noteOctave = (note >> PACKED_OCTAVE_SHIFT) & 0x07;
+    while (pitch && octave != noteOctave) {
+      if (!writeCompactNibble(compact, capacity, position, octave < noteOctave ? COMPACT_OCTAVE_UP : COMPACT_OCTAVE_DOWN)) return 0;
+      octave = (octave < noteOctave) ? octave + 1 : octave - 1;
+    }
+    if (!writeCompactNibble(compact, capacity, position, pitch)) return 0;
+  }
+  return COMPACT_HEADER_BYTES + (position + 1) / 2;
+}
+
+/** @brief Number of melodies the parsed-melody cache holds (0 disables the cache). Define before including. */
+#ifndef RTTTL_CACHE_SLOTS
+#define RTTTL_CACHE_SLOTS 0
+#endif
+/** @brief Notes of each cache slot; longer melodies are not cached. */
+#ifndef RTTTL_CACHE_SLOT_NOTES
+#define RTTTL_CACHE_SLOT_NOTES 64
+#endif
+
+#if RTTTL_CACHE_SLOTS > 0
+/**
+ * @brief One melody held by the parsed-melody cache.
+ */
+struct RTTTLCacheSlot {
+  const char* rtttl;         /**< Source string the image was parsed from (nullptr if the slot is free). */
+  bool isProgmem;            /**< Whether the source string is stored in PROGMEM. */
+  uint32_t lastUse;          /**< Value of RTTTLCache::clock when the slot was last used. */
+  const MelodyState* player; /**< State last started from the slot; the slot is kept while it plays it. */
+};
+
+/**
+ * @brief Cache of packed melody images keyed by RTTTL source pointer, in a static arena.
+ * playRTTTLMelody() looks strings up here first: a hit plays the cached image with no parsing and no
+ * allocation. When every slot is taken, the least recently used one that is not playing is replaced.
+ * The key is the pointer, so a RAM string that is rewritten in place must be dropped with forgetRTTTLCache().
+ * MelodyState structures played through the cache must stay valid (global or static), since slots refer to them.
+ */
+struct RTTTLCache {
+  RTTTLCacheSlot slots[RTTTL_CACHE_SLOTS];                                          /**< Cached melodies. */
+  uint16_t images[RTTTL_CACHE_SLOTS][PACKED_HEADER_WORDS + RTTTL_CACHE_SLOT_NOTES]; /**< Packed image of each slot. */
+  uint32_t clock;                                                                   /**< Lookup counter used for LRU order. */
+  uint32_t hits;                                                                    /**< Lookups served from the cache. */
+  uint32_t misses;                                                                  /**< Lookups that had to parse. */
+  uint32_t evictions;                                                               /**< Cached melodies replaced by others. */
+};
+
+RTTTLCache rtttlCache = {}; /**< Global parsed-melody cache. */
+
+/**
+ * @brief Check whether a cache slot is in use by the state last started from it.
+ * @param index Index of the slot.
+ * @return True if the slot must not be replaced.
+ */
+bool isRTTTLCacheSlotPlaying(uint8_t index) {
+  const MelodyState* player = rtttlCache.slots[index].player;
+  return player && player->isPlaying && player->source == MELODY_SOURCE_PACKED && player->packed == rtttlCache.images[index] + PACKED_HEADER_WORDS;
+}
+
+/**
+ * @brief Get the packed image of an RTTTL string from the cache, parsing it into a slot on a miss.
+ * @param rtttl The RTTTL string.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param player The state that will play the image (keeps the slot while it plays), or nullptr.
+ * @return The packed image (RAM), or nullptr if the melody cannot be cached (too long, not packable, every slot playing,
+ * or its slot playing on another state).
+ */
+const uint16_t* cacheRTTTLMelody(const char* rtttl, bool isProgmem, const MelodyState* player) {
+  if (!rtttl) {
+    return nullptr;
+  }
+  rtttlCache.clock++;
+  uint8_t victim = RTTTL_CACHE_SLOTS;
+  for (uint8_t i = 0; i < RTTTL_CACHE_SLOTS; i++) {
+    RTTTLCacheSlot& slot = rtttlCache.slots[i];
+    if (slot.rtttl == rtttl && slot.isProgmem == isProgmem) {
+      if (slot.player != player && isRTTTLCacheSlotPlaying(i)) {
+        // Another state still plays the slot and keeps it; this one parses its own copy
+        rtttlCache.misses++;
+        return nullptr;
+      }
+      rtttlCache.hits++;
+      slot.lastUse = rtttlCache.clock;
+      slot.player = player;
+      return rtttlCache.images[i];
+    }
+    if (!slot.rtttl) {
+      if (victim == RTTTL_CACHE_SLOTS || rtttlCache.slots[victim].rtttl) victim = i;
+    } else if (!isRTTTLCacheSlotPlaying(i) && (victim == RTTTL_CACHE_SLOTS || (rtttlCache.slots[victim].rtttl && slot.lastUse < rtttlCache.slots[victim].lastUse))) {
+      victim = i;
+    }
+  }
+
+  rtttlCache.misses++;
+  if (victim == RTTTL_CACHE_SLOTS) {
+    return nullptr;
+  }
+  RTTTLCacheSlot& slot = rtttlCache.slots[victim];
+  if (slot.rtttl) {
+    // Check the melody first, so one that cannot be cached does not throw out a valid entry
+    if (!packRTTTL(rtttl, nullptr, RTTTL_CACHE_SLOT_NOTES, isProgmem)) {
+      return nullptr;
+    }
+    rtttlCache.evictions++;
+    slot.rtttl = nullptr;
+  }
+  if (!packRTTTL(rtttl, rtttlCache.images[victim], RTTTL_CACHE_SLOT_NOTES, isProgmem)) {
+    return nullptr;
+  }
+  slot.rtttl = rtttl;
+  slot.isProgmem = isProgmem;
+  slot.lastUse = rtttlCache.clock;
+  slot.player = player;
+  return rtttlCache.images[victim];
+}
+
+/**
+ * @brief Drop a string from the cache, e.g. after rewriting a RAM buffer in place.
+ * @param rtttl The RTTTL string.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ */
+void forgetRTTTLCache(const char* rtttl, bool isProgmem) {
+  for (uint8_t i = 0; i < RTTTL_CACHE_SLOTS; i++) {
+    if (rtttlCache.slots[i].rtttl == rtttl && rtttlCache.slots[i].isProgmem == isProgmem && !isRTTTLCacheSlotPlaying(i)) {
+      rtttlCache.slots[i].rtttl = nullptr;
+    }
+  }
+}
+
+/**
+ * @brief Empty the cache and reset its counters. Slots still playing are kept.
+ */
+void clearRTTTLCache() {
+  for (uint8_t i = 0; i < RTTTL_CACHE_SLOTS; i++) {
+    if (!isRTTTLCacheSlotPlaying(i)) rtttlCache.slots[i].rtttl = nullptr;
+  }
+  rtttlCache.hits = 0;
+  rtttlCache.misses = 0;
+  rtttlCache.evictions = 0;
+}
+#endif
+
+/**
+ * @brief Result of checking an RTTTL string with checkRTTTL().
+ */
+enum RTTTLStatus {
+  RTTTL_OK,                      /**< The string is valid. */
+  RTTTL_MISSING_CONTROL_SECTION, /**< No "name:settings:" prefix. */
+  RTTTL_INVALID_SETTING,         /**< A setting other than d=, o= or b=, or one without a value. */
+  RTTTL_INVALID_BPM,             /**< Tempo outside 4..60000. */
+  RTTTL_INVALID_DURATION,        /**< Duration other than 1, 2, 4, 8, 16 or 32. */
+  RTTTL_INVALID_NOTE,            /**< Note name other than a-g or p, or b#. */
+  RTTTL_INVALID_OCTAVE,          /**< Octave above 7. */
+  RTTTL_UNEXPECTED_CHARACTER,    /**< Anything else where a note, ',' or the end was expected. */
+  RTTTL_NO_NOTES                 /**< The control section is not followed by any note. */
+};
+
+/**
+ * @brief Strictly validate an RTTTL string.
+ * parseRTTTLHeader() and parseRTTTLNote() skip what they do not understand so that a device plays
+ * whatever it can; this function applies the rules of the compile-time parser (rtttl_compile.h) instead
+ * and reports the first error, so corpora can be checked before they are shipped.
+ * @param rtttl The RTTTL string.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param errorOffset Set to the offset of the first invalid character (unchanged if the string is valid).
+ * @param noteCount Set to the number of notes read before the first error, or in the whole string.
+ * @return RTTTL_OK if the string is valid, otherwise the first error found.
+ */
+RTTTLStatus checkRTTTL(const char* rtttl, bool isProgmem, size_t& errorOffset, size_t& noteCount) {
+  noteCount = 0;
+  const char* cursor = rtttl;
+  char c;
+  while ((c = readRTTTLChar(cursor, isProgmem)) != ':') {
+    if (!c) {
+      errorOffset = 0;
+      return RTTTL_MISSING_CONTROL_SECTION;
+    }
+    cursor++;
+  }
+  cursor++;
+
+  while ((c = readRTTTLChar(cursor, isProgmem)) != ':') {
+    if (!c) {
+      errorOffset = cursor - rtttl;
+      return RTTTL_MISSING_CONTROL_SECTION;
+    }
+    if (c == ',' || isspace(c)) {
+      cursor++;
+      continue;
+    }
+    const char* setting = cursor;
+    char key = tolower(c);
+    if ((key != 'd' && key != 'o' && key != 'b') || readRTTTLChar(++cursor, isProgmem) != '=' || !isdigit(readRTTTLChar(++cursor, isProgmem))) {
+      errorOffset = setting - rtttl;
+      return RTTTL_INVALID_SETTING;
+    }
+    uint32_t value = 0;
+    while (isdigit(c = readRTTTLChar(cursor, isProgmem))) {
+      if (value <= 60000) value = value * 10 + (c - '0');
+      cursor++;
+    }
+    RTTTLStatus status = RTTTL_OK;
+    if (key == 'd' && !isRTTTLDivider(value)) status = RTTTL_INVALID_DURATION;
+    else if (key == 'o' && value > PACKED_MAX_OCTAVE) status = RTTTL_INVALID_OCTAVE;
+    else if (key == 'b' && (value < 4 || value > 60000)) status = RTTTL_INVALID_BPM;
+    if (status != RTTTL_OK) {
+      errorOffset = setting - rtttl;
+      return status;
+    }
+  }
+  cursor++;
+
+  while (true) {
+    while (isspace(c = readRTTTLChar(cursor, isProgmem))) cursor++;
+    if (!c && noteCount > 0) return RTTTL_OK;
+    const char* note = cursor;
+    errorOffset = note - rtttl;
+    uint32_t divider = 0;
+    while (isdigit(c)) {
+      if (divider <= 32) divider = divider * 10 + (c - '0');
+      c = readRTTTLChar(++cursor, isProgmem);
+    }
+    if (cursor != note && !isRTTTLDivider(divider)) return RTTTL_INVALID_DURATION;
+    char name = tolower(c);
+    if (!c) return noteCount > 0 ? RTTTL_UNEXPECTED_CHARACTER : RTTTL_NO_NOTES;
+    if ((name < 'a' || name > 'g') && name != 'p') {
+      errorOffset = cursor - rtttl;
+      return RTTTL_INVALID_NOTE;
+    }
+    c = readRTTTLChar(++cursor, isProgmem);
+    if (c == '#') {
+      if (name == 'b') {
+        errorOffset = cursor - rtttl;
+        return RTTTL_INVALID_NOTE;
+      }
+      c = readRTTTLChar(++cursor, isProgmem);
+    }
+    if (isdigit(c)) {
+      if (c - '0' > PACKED_MAX_OCTAVE) {
+        errorOffset = cursor - rtttl;
+        return RTTTL_INVALID_OCTAVE;
+      }
+      c = readRTTTLChar(++cursor, isProgmem);
+    }
+    if (c == '.') c = readRTTTLChar(++cursor, isProgmem);
+    while (isspace(c)) c = readRTTTLChar(++cursor, isProgmem);
+    noteCount++;
+    if (!c) return RTTTL_OK;
+    if (c != ',') {
+      errorOffset = cursor - rtttl;
+      return RTTTL_UNEXPECTED_CHARACTER;
+    }
+    cursor++;
+  }
+}
+
+/**
+ * @brief Scale a time of a melody by its tempo (see setMelodyTempo()).
+ * @param state The MelodyState structure of the melody.
+ * @param time The time at the written tempo (ms).
+ * @return The time at the tempo of the melody (ms).
+ */
+uint32_t scaleMelodyTime(const MelodyState& state, uint32_t time) {
+  uint16_t scale = state.controls ? state.controls->durationScale : 0;
+  if (scale == 0) return time;
+  const uint32_t fraction = (1UL << MELODY_TEMPO_SHIFT) - 1;
+  return (time >> MELODY_TEMPO_SHIFT) * scale + (((time & fraction) * scale + (fraction + 1) / 2) >> MELODY_TEMPO_SHIFT);
+}
+
+/**
+ * @brief Convert a time played at the tempo of a melody back to the written tempo.
+ * @param state The MelodyState structure of the melody.
+ * @param time The time at the tempo of the melody (ms).
+ * @return The time at the written tempo (ms).
+ */
+uint32_t unscaleMelodyTime(const MelodyState& state, uint32_t time) {
+  uint16_t scale = state.controls ? state.controls->durationScale : 0;
+  if (scale == 0) return time;
+  if (time > (UINT32_MAX >> MELODY_TEMPO_SHIFT)) time = UINT32_MAX >> MELODY_TEMPO_SHIFT;
+  return ((time << MELODY_TEMPO_SHIFT) + scale / 2) / scale;
+}
+
+/**
+ * @brief Scale a note duration by the tempo of a melody.
+ * @param state The MelodyState structure of the melody.
+ * @param duration The duration at the written tempo.
+ * @return The duration at the tempo of the melody, clamped to MELODY_MAX_NOTE_DURATION.
+ */
+ToneDuration scaleNoteDuration(const MelodyState& state, ToneDuration duration) {
+  uint32_t scaled = scaleMelodyTime(state, static_cast<uint16_t>(duration));
+  return static_cast<ToneDuration>(scaled > MELODY_MAX_NOTE_DURATION ? MELODY_MAX_NOTE_DURATION : scaled);
+}
+
+/**
+ * @brief Load the note at state.currentNote into state.noteFrequency and state.noteDuration.
+ * Array and packed melodies are indexed directly; streaming RTTTL and compact melodies decode the next note at their cursor,
+ * and RTTTLStream melodies take the next decoded note (or a RTTTL_STREAM_WAIT rest while it has not arrived).
+ * The tempo and transposition of its MelodyControls are applied here, so changing them takes effect at the next note:
+ * notes read as note names (RTTTL, packed and compact) are moved exactly, frequencies with transposeFrequency().
+ * Notes read as note names also keep their note number, for outputs that map notes to settings directly.
+ * @param state The MelodyState structure of the melody.
+ * @return True if a note was loaded, false at the end of the melody.
+ */
+bool loadMelodyNote(MelodyState& state) {
+  int8_t transpose = state.controls ? state.controls->transpose : 0;
+  if (state.source == MELODY_SOURCE_RTTTL) {
+    RTTTLNote note;
+    if (!readRTTTLNote(state.rtttlCursor, state.isProgmem, state.rtttlHeader, note)) {
+      return false;
+    }
+    state.noteNumber = transposedNoteNumber(note.noteIndex, note.octave, transpose);
+    state.noteFrequency = noteNumberFrequency(state.noteNumber);
+    state.noteDuration = scaleNoteDuration(state, rtttlNoteDuration(state.rtttlHeader, note));
+    return true;
+  }
+  state.noteNumber = NO_NOTE_NUMBER;
+  if (state.source == MELODY_SOURCE_STREAM) {
+    if (popRTTTLStreamNote(*state.stream, state.noteFrequency, state.noteDuration)) {
+      state.noteFrequency = static_cast<ToneFrequency>(transposeFrequency(static_cast<uint16_t>(state.noteFrequency), transpose));
+      state.noteDuration = scaleNoteDuration(state, state.noteDuration);
+      return true;
+    }
+    if (state.stream->phase == RTTTL_STREAM_ENDED) {
+      return false;
+    }
+    // The next note has not arrived yet: wait in silence (only a gap inside the notes counts as an underrun)
+    if (state.stream->phase == RTTTL_STREAM_NOTES) {
+      state.stream->underruns++;
+    }
+    state.noteFrequency = PAUSE;
+    state.noteDuration = static_cast<ToneDuration>(RTTTL_STREAM_WAIT);
+    return true;
+  }
+  if (state.currentNote >= state.length) {
+    return false;
+  }
+  if (state.source == MELODY_SOURCE_PACKED || state.source == MELODY_SOURCE_COMPACT) {
+    uint16_t note;
+    uint32_t wholeNote;
+    if (state.source == MELODY_SOURCE_PACKED) {
+      note = readPackedWord(state.packed + state.currentNote, state.isProgmem);
+      wholeNote = state.rtttlHeader.wholeNote;
+    } else if (readCompactNote(state.compact, state.isProgmem, state.compactCursor, note)) {
+      wholeNote = readCompactWord(state.compact, state.isProgmem);
+    } else {
+      return false;
+    }
+    uint8_t pitch = note >> PACKED_PITCH_SHIFT;
+    if (pitch) state.noteNumber = transposedNoteNumber(pitch - 1, (note >> PACKED_OCTAVE_SHIFT) & 0x07, transpose);
+    state.noteFrequency = noteNumberFrequency(state.noteNumber);
+    state.noteDuration = scaleNoteDuration(state, packedNoteDuration(note, wholeNote));
+    return true;
+  }
+  state.noteFrequency = static_cast<ToneFrequency>(transposeFrequency(static_cast<uint16_t>(state.melody[state.currentNote]), transpose));
+  state.noteDuration = scaleNoteDuration(state, state.durations[state.currentNote]);
+  return true;
+}
+
+/**
+ * @brief Rewind a melody to its first note.
+ * @param state The MelodyState structure of the melody.
+ */
+void rewindMelody(MelodyState& state) {
+  state.currentNote = 0;
+  if (state.source == MELODY_SOURCE_RTTTL) {
+    state.rtttlCursor = state.rtttl;
+  } else if (state.source == MELODY_SOURCE_COMPACT) {
+    startCompactCursor(state.compact, state.isProgmem, state.compactCursor);
+  }
+}
+
+/**
+ * @brief Set up a sweep without playing it: the start position and the increment of each retune.
+ * @param state The SweepState structure to set up.
+ * @param startFrequency The frequency at the start (Hz).
+ * @param endFrequency The frequency reached after duration (Hz).
+ * @param duration The length of the sweep (ms).
+ * @param curve SWEEP_LINEAR or SWEEP_EXPONENTIAL.
+ * @param interval The time between retunes (ms).
+ * @return True if the sweep is valid and started, false otherwise.
+ */
+bool initSweep(SweepState& state, uint16_t startFrequency, uint16_t endFrequency, uint16_t duration, SweepCurve curve, uint16_t interval) {
+  state.isPlaying = false;
+  if (startFrequency < MIN_FREQUENCY || endFrequency < MIN_FREQUENCY || duration == 0 || interval == 0) {
+    return false;
+  }
+  uint16_t steps = (duration >= interval) ? duration / interval : 1;
+  uint32_t start = static_cast<uint32_t>(startFrequency) << 16;
+  uint32_t end = static_cast<uint32_t>(endFrequency) << 16;
+  if (curve == SWEEP_EXPONENTIAL) {
+    start = frequencyToPitch(startFrequency);
+    end = frequencyToPitch(endFrequency);
+  }
+  state.isPlaying = true;
+  state.isRising = end >= start;
+  state.curve = curve;
+  state.interval = interval;
+  state.stepsLeft = steps;
+  state.time = millis();
+  state.position = start;
+  state.increment = (state.isRising ? end - start : start - end) / steps;
+  state.frequency = startFrequency;
+  state.endFrequency = endFrequency;
+  return true;
+}
+
+/**
+ * @brief Apply the retunes of a sweep that are due and play the new frequency.
+ * Retunes follow the start time plus multiples of the interval, so the sweep reaches its end on time
+ * whatever the loop latency. The end frequency is not played: the caller decides what happens at the end.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The SweepState structure of the sweep.
+ * @param currentTime The current time (ms).
+ * @return True if the sweep has reached its end frequency.
+ */
+template <typename Output>
+bool advanceSweep(Output& output, SweepState& state, uint32_t currentTime) {
+  if (state.stepsLeft == 0 || soundElapsed(state.time, currentTime) < state.interval) {
+    return state.stepsLeft == 0;
+  }
+  do {
+    state.time += state.interval;
+    state.stepsLeft--;
+    state.position = state.isRising ? state.position + state.increment : state.position - state.increment;
+  } while (state.stepsLeft > 0 && soundElapsed(state.time, currentTime) >= state.interval);
+  if (state.stepsLeft == 0) {
+    state.frequency = state.endFrequency;
+    return true;
+  }
+  uint16_t frequency = (state.curve == SWEEP_EXPONENTIAL) ? pitchToFrequency(state.position) : static_cast<uint16_t>((state.position + 0x8000) >> 16);
+  if (frequency != state.frequency) {
+    state.frequency = frequency;
+    output.play(frequency);
+  }
+  return false;
+}
+
+/**
+ * @brief Start sounding the loaded note of a melody.
+ * Pauses silence the speaker. A scheduled start more than the whole note in the past (the loop stalled)
+ * is moved to now, so the melody skips ahead instead of rushing through the missed notes.
+ * With a portamento (see setMelodyGlide()), the note starts at the pitch the melody last played and glides to its own.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure of the melody.
+ * @param startTime The time the note is scheduled to start (ms).
+ */
+template <typename Output>
+void startMelodyNote(Output& output, MelodyState& state, uint32_t startTime) {
+  uint32_t currentTime = millis();
+  state.time = (currentTime - startTime >= static_cast<uint16_t>(state.noteDuration)) ? currentTime : startTime;
+  state.isArticulating = false;
+  uint16_t frequency = static_cast<uint16_t>(state.noteFrequency);
+  uint16_t previousFrequency = PAUSE;
+  if (state.controls) {
+    previousFrequency = state.controls->glide.frequency;
+    state.controls->glide.isPlaying = false;
+    state.controls->glide.frequency = frequency;
+  }
+  if (frequency == PAUSE) {
+    output.stop();
+    return;
+  }
+  if (previousFrequency != PAUSE && previousFrequency != frequency && (state.currentNote > 0 || state.currentRepeat > 0)) {
+    MelodyControls& controls = *state.controls;
+    uint16_t glideTime = controls.glideTime < static_cast<uint16_t>(state.noteDuration) ? controls.glideTime : static_cast<uint16_t>(state.noteDuration);
+    if (glideTime > 0 && initSweep(controls.glide, previousFrequency, frequency, glideTime, static_cast<SweepCurve>(controls.glide.curve), controls.glide.interval)) {
+      controls.glide.time = state.time;
+      output.play(controls.glide.frequency);
+      return;
+    }
+  }
+  playOutputNote(output, frequency, state.noteNumber);
+}
+
+/**
+ * @brief Same as startMelodyNote(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void startMelodyNote(MelodyState& state, uint32_t startTime) {
+  SpeakerOutput output;
+  startMelodyNote(output, state, startTime);
+}
+
+/**
+ * @brief Choose how a melody places its note boundaries.
+ * In MELODY_TIMING_ABSOLUTE mode each note lasts exactly its duration on a timeline that starts with the
+ * first note, so the melody keeps its tempo whatever the loop latency; the last articulationGap ms of each
+ * note are silent. The setting is kept across play calls (MelodyState must start zero-initialized).
+ * @param state The MelodyState structure of the melody.
+ * @param timing MELODY_TIMING_RELATIVE (default) or MELODY_TIMING_ABSOLUTE.
+ * @param articulationGap Silence at the end of each note in absolute mode (ms, default: MELODY_ARTICULATION_GAP).
+ */
+void setMelodyTiming(MelodyState& state, MelodyTiming timing, uint8_t articulationGap = MELODY_ARTICULATION_GAP) {
+  state.timing = timing;
+  state.articulationGap = articulationGap;
+}
+
+/**
+ * @brief Attach the controls (tempo, transposition and portamento) a melody is played with.
+ * Melodies without controls play as written and do not store them. The controls are kept across play calls
+ * (MelodyState must start zero-initialized); each melody needs its own MelodyControls.
+ * @param state The MelodyState structure of the melody.
+ * @param controls Zero-initialized MelodyControls, or nullptr to play as written again.
+ */
+void setMelodyControls(MelodyState& state, MelodyControls* controls) {
+  state.controls = controls;
+}
+
+/**
+ * @brief Set the portamento of a melody: each note starts at the pitch of the previous one and glides to its own.
+ * The glide lasts glideTime ms (at most the note) and retunes every interval ms; the first note and the notes
+ * after a rest do not glide. Works with every note source, RTTTL included. The setting is kept in the
+ * MelodyControls of the melody (see setMelodyControls()).
+ * @param state The MelodyState structure of the melody.
+ * @param glideTime Length of the glide (ms, 0 = no portamento).
+ * @param curve SWEEP_EXPONENTIAL (default) or SWEEP_LINEAR.
+ * @param interval Time between retunes (ms, default: SWEEP_RETUNE_INTERVAL).
+ * @return False if the melody has no MelodyControls (nothing is set).
+ */
+bool setMelodyGlide(MelodyState& state, uint16_t glideTime, SweepCurve curve = SWEEP_EXPONENTIAL, uint16_t interval = SWEEP_RETUNE_INTERVAL) {
+  if (!state.controls) {
+    return false;
+  }
+  state.controls->glideTime = (interval > 0) ? glideTime : 0;
+  state.controls->glide.curve = curve;
+  state.controls->glide.interval = interval;
+  return true;
+}
+
+/**
+ * @brief Set the tempo of a melody as a percentage of its written tempo, e.g. to speed up an alarm.
+ * Note durations are multiplied by 100 / tempoPercent (computed once here, in 4.12 fixed point) as each note is
+ * loaded, so the change takes effect at the next note without parsing the melody again. MELODY_NOTE_GAP and the
+ * articulation gap keep their length. The index functions (melodyPosition(), seekMelody()...) keep counting in
+ * written time. The setting is kept in the MelodyControls of the melody (see setMelodyControls()).
+ * @param state The MelodyState structure of the melody.
+ * @param tempoPercent The tempo (100 = as written, 200 = twice as fast), clamped to MELODY_TEMPO_MIN..MELODY_TEMPO_MAX.
+ * @return False if the melody has no MelodyControls (nothing is set).
+ */
+bool setMelodyTempo(MelodyState& state, uint16_t tempoPercent) {
+  if (!state.controls) {
+    return false;
+  }
+  if (tempoPercent < MELODY_TEMPO_MIN) tempoPercent = MELODY_TEMPO_MIN;
+  if (tempoPercent > MELODY_TEMPO_MAX) tempoPercent = MELODY_TEMPO_MAX;
+  state.controls->durationScale = (tempoPercent == 100) ? 0 : static_cast<uint16_t>(((100UL << MELODY_TEMPO_SHIFT) + tempoPercent / 2) / tempoPercent);
+  return true;
+}
+
+/**
+ * @brief Transpose a melody by a number of semitones.
+ * Applied as each note is loaded, so the change takes effect at the next note without parsing the melody again.
+ * The setting is kept in the MelodyControls of the melody (see setMelodyControls()).
+ * @param state The MelodyState structure of the melody.
+ * @param semitones Semitones to move every note by (negative = down, 0 = as written).
+ * @return False if the melody has no MelodyControls (nothing is set).
+ */
+bool setMelodyTranspose(MelodyState& state, int8_t semitones) {
+  if (!state.controls) {
+    return false;
+  }
+  state.controls->transpose = semitones;
+  return true;
+}
+
+/**
+ * @brief Play a melody (non-blocking).
+ * This function starts playing a melody (standard or RTTTL) and updates its state.
+ * Call updateMelody() in the main loop to manage note progression.
+ * For RTTTL melodies, set isDynamic to true and free melody/durations after playback.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param melody Array of ToneFrequency values representing the melody.
+ * @param durations Array of ToneDuration values representing the durations.
+ * @param length The number of notes in the melody (at most 65535).
+ * @param isDynamic True if the melody arrays are dynamically allocated (e.g., from RTTTL).
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <typename Output>
+void playMelody(Output& output, MelodyState& state, ToneFrequency* melody, ToneDuration* durations, size_t length, bool isDynamic = false, uint8_t repeatCount = 1) {
+  if (length == 0 || length > UINT16_MAX || melody == nullptr || durations == nullptr) {
+    state.isPlaying = false;
+    return;
+  }
+  state.isPlaying = true;
+  state.currentNote = 0;
+  state.melody = melody;
+  state.durations = durations;
+  state.length = length;
+  state.isDynamic = isDynamic;
+  state.currentRepeat = 0;
+  state.totalRepeats = (repeatCount > 0) ? repeatCount : 1;
+  state.source = MELODY_SOURCE_ARRAYS;
+  state.isProgmem = false;
+  loadMelodyNote(state);
+  startMelodyNote(output, state, millis());
+}
+
+/**
+ * @brief Same as playMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playMelody(MelodyState& state, ToneFrequency* melody, ToneDuration* durations, size_t length, bool isDynamic = false, uint8_t repeatCount = 1) {
+  SpeakerOutput output;
+  playMelody(output, state, melody, durations, length, isDynamic, repeatCount);
+}
+
+/** @brief Set to 1 before including the library to trace melody playback (see SoundTrace); 0 compiles the hooks out. */
+#ifndef SOUND_TRACE
+#define SOUND_TRACE 0
+#endif
+/** @brief Note onsets kept by the trace ring buffer (the oldest are overwritten). */
+#ifndef SOUND_TRACE_EVENTS
+#define SOUND_TRACE_EVENTS 16
+#endif
+
+#if SOUND_TRACE
+/**
+ * @brief A note started by updateMelody().
+ */
+struct SoundTraceEvent {
+  uint32_t time;      /**< Time the note started (ms). */
+  uint16_t note;      /**< Note number within the melody. */
+  uint16_t frequency; /**< Frequency of the note (PAUSE for rests). */
+  uint16_t lateness;  /**< Time between the scheduled and the actual onset (ms). */
+};
+
+/**
+ * @brief Counters and onset lateness of all traced melodies since the last resetSoundTrace().
+ */
+struct SoundTraceStats {
+  uint32_t updates;       /**< Calls to updateMelody() on a playing melody. */
+  uint32_t onsets;        /**< Notes started by updateMelody(). */
+  uint32_t overwritten;   /**< Events lost because the ring buffer was full. */
+  uint16_t minLateness;   /**< Smallest onset lateness (ms, 0xFFFF before the first onset). */
+  uint16_t maxLateness;   /**< Largest onset lateness (ms). */
+  uint32_t totalLateness; /**< Sum of the onset latenesses (ms), for the mean. */
+};
+
+/**
+ * @brief Playback trace: a ring buffer of the latest note onsets and running statistics.
+ * With SOUND_TRACE set, updateMelody() counts its calls and records every note it starts with its lateness: the time
+ * between the end of the previous note (plus MELODY_NOTE_GAP in relative mode) and the call that started it, i.e.
+ * the timing jitter added by the main loop. Read the events with readSoundTraceEvent() and the statistics from
+ * soundTrace.stats; on the host, hostWriteSoundTrace() exports both.
+ */
+struct SoundTrace {
+  SoundTraceEvent events[SOUND_TRACE_EVENTS]; /**< Latest onsets, oldest at head. */
+  uint8_t head;                               /**< Oldest event. */
+  uint8_t count;                              /**< Number of events held. */
+  SoundTraceStats stats;                      /**< Running statistics. */
+};
+
+SoundTrace soundTrace = { {}, 0, 0, { 0, 0, 0, 0xFFFF, 0, 0 } }; /**< Global playback trace. */
+
+/**
+ * @brief Clear the trace events and statistics.
+ */
+void resetSoundTrace() {
+  soundTrace.head = 0;
+  soundTrace.count = 0;
+  soundTrace.stats = { 0, 0, 0, 0xFFFF, 0, 0 };
+}
+
+/**
+ * @brief Record a note onset (called by updateMelody()).
+ * @param note The note number.
+ * @param frequency The frequency of the note.
+ * @param due The time the note was due (ms).
+ * @param time The time it started (ms).
+ */
+void traceMelodyOnset(size_t note, uint16_t frequency, uint32_t due, uint32_t time) {
+  uint32_t late = time - due;
+  uint16_t lateness = (late > UINT16_MAX) ? UINT16_MAX : static_cast<uint16_t>(late);
+  SoundTraceStats& stats = soundTrace.stats;
+  stats.onsets++;
+  stats.totalLateness += lateness;
+  if (lateness < stats.minLateness) stats.minLateness = lateness;
+  if (lateness > stats.maxLateness) stats.maxLateness = lateness;
+  uint8_t slot = (soundTrace.head + soundTrace.count) % SOUND_TRACE_EVENTS;
+  if (soundTrace.count < SOUND_TRACE_EVENTS) {
+    soundTrace.count++;
+  } else {
+    soundTrace.head = (soundTrace.head + 1) % SOUND_TRACE_EVENTS;
+    stats.overwritten++;
+  }
+  soundTrace.events[slot] = { time, static_cast<uint16_t>(note), frequency, lateness };
+}
+
+/**
+ * @brief Take the oldest recorded onset out of the trace.
+ * @param event Variable to store the event.
+ * @return False if no event is held.
+ */
+bool readSoundTraceEvent(SoundTraceEvent& event) {
+  if (soundTrace.count == 0) {
+    return false;
+  }
+  event = soundTrace.events[soundTrace.head];
+  soundTrace.head = (soundTrace.head + 1) % SOUND_TRACE_EVENTS;
+  soundTrace.count--;
+  return true;
+}
+
+/**
+ * @brief Get the mean onset lateness.
+ * @return The mean (ms), 0 before the first onset.
+ */
+uint16_t soundTraceMeanLateness() {
+  return soundTrace.stats.onsets ? static_cast<uint16_t>(soundTrace.stats.totalLateness / soundTrace.stats.onsets) : 0;
+}
+
+#ifndef ARDUINO
+/**
+ * @brief Export the trace on the host: the held onsets as CSV rows (taken out of the ring buffer), then the
+ * statistics as a comment line.
+ * @param file The file to write to (e.g. stdout).
+ */
+void hostWriteSoundTrace(FILE* file) {
+  SoundTraceEvent event;
+  fprintf(file, "time_ms,note,frequency_hz,lateness_ms\n");
+  while (readSoundTraceEvent(event)) {
+    fprintf(file, "%lu,%u,%u,%u\n", static_cast<unsigned long>(event.time), event.note, event.frequency, event.lateness);
+  }
+  const SoundTraceStats& stats = soundTrace.stats;
+  fprintf(file, "# updates=%lu onsets=%lu overwritten=%lu min_lateness_ms=%u max_lateness_ms=%u mean_lateness_ms=%.2f\n",
+          static_cast<unsigned long>(stats.updates), static_cast<unsigned long>(stats.onsets), static_cast<unsigned long>(stats.overwritten),
+          stats.onsets ? stats.minLateness : 0, stats.maxLateness, stats.onsets ? static_cast<double>(stats.totalLateness) / stats.onsets : 0.0);
+}
+#endif
+
+#define SOUND_TRACE_UPDATE() (soundTrace.stats.updates++)
+#define SOUND_TRACE_ONSET(note, frequency, due, time) traceMelodyOnset(note, frequency, due, time)
+#else
+#define SOUND_TRACE_UPDATE() ((void)0)
+#define SOUND_TRACE_ONSET(note, frequency, due, time) ((void)0)
+#endif
+
+/**
+ * @brief Get the time the note after the current one is due: its end, plus MELODY_NOTE_GAP in relative mode.
+ * @param state The MelodyState structure of the melody.
+ * @param duration The duration of the current note (ms).
+ * @param currentTime The current time (ms).
+ * @return The time (ms).
+ */
+uint32_t melodyNoteDue(const MelodyState& state, uint16_t duration, uint32_t currentTime) {
+  return soundTimeAt(state.time, currentTime) + duration + (state.timing == MELODY_TIMING_ABSOLUTE ? 0 : MELODY_NOTE_GAP);
+}
+
+/**
+ * @brief Update the state of a melody.
+ * Advances to the next note when the current note has ended, handles repeats and frees dynamic memory after completion.
+ * Also retunes the portamento glide of the current note (see setMelodyGlide()).
+ * Must be called repeatedly in the main loop.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to update.
+ */
+template <typename Output>
+void updateMelody(Output& output, MelodyState& state) {
+  if (!state.isPlaying) {
+    return;
+  }
+  SOUND_TRACE_UPDATE();
+
+  uint32_t currentTime = millis();
+  MelodyControls* controls = state.controls;
+  if (controls && controls->glide.isPlaying && !state.isArticulating && advanceSweep(output, controls->glide, currentTime)) {
+    controls->glide.isPlaying = false;
+    playOutputNote(output, controls->glide.frequency, state.noteNumber);
+  }
+  uint16_t noteDuration = static_cast<uint16_t>(state.noteDuration);
+  uint32_t noteStart = currentTime;
+  uint16_t elapsed = soundElapsed(state.time, currentTime);
+  if (state.timing == MELODY_TIMING_ABSOLUTE) {
+    if (elapsed < noteDuration) {
+      if (!state.isArticulating && state.articulationGap > 0 && state.articulationGap < noteDuration && elapsed >= noteDuration - state.articulationGap) {
+        state.isArticulating = true;
+        output.stop();
+      }
+      return;
+    }
+    noteStart = currentTime - elapsed + noteDuration;
+  } else if (elapsed < static_cast<uint32_t>(noteDuration) + MELODY_NOTE_GAP) {
+    return;
+  }
+
+  state.currentNote++;
+  if (loadMelodyNote(state)) {
+    SOUND_TRACE_ONSET(state.currentNote, state.noteFrequency, melodyNoteDue(state, noteDuration, currentTime), currentTime);
+    startMelodyNote(output, state, noteStart);
+    return;
+  }
+
+  if (state.currentRepeat + 1 < state.totalRepeats) {
+    state.currentRepeat++;
+    rewindMelody(state);
+    if (loadMelodyNote(state)) {
+      SOUND_TRACE_ONSET(state.currentNote, state.noteFrequency, melodyNoteDue(state, noteDuration, currentTime), currentTime);
+      startMelodyNote(output, state, noteStart);
+      return;
+    }
+  }
+
+  if (state.isDynamic) {
+    if (state.source == MELODY_SOURCE_PACKED) {
+      delete[] (state.packed - PACKED_HEADER_WORDS);
+      state.packed = nullptr;
+    } else {
+      delete[] state.melody;
+      delete[] state.durations;
+      state.melody = nullptr;
+      state.durations = nullptr;
+    }
+  }
+  state.isPlaying = false;
+  output.stop();
+}
+
+/**
+ * @brief Same as updateMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateMelody(MelodyState& state) {
+  SpeakerOutput output;
+  updateMelody(output, state);
+}
+
+/**
+ * @brief Play a packed melody image (non-blocking) with optional repeats.
+ * The image holds the whole-note duration (ms) or PACKED_TONE_DURATIONS, the note count and one packed
+ * note per word, as produced by RTTTL_COMPILE(), PROGMEM_TONE_MELODY() or packMelody(). Nothing is parsed or allocated.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param packed The packed melody image.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <typename Output>
+void playPackedMelody(Output& output, MelodyState& state, const uint16_t* packed, bool isProgmem = false, uint8_t repeatCount = 1) {
+  state.isPlaying = false;
+  if (!packed) {
+    return;
+  }
+  state.length = readPackedWord(packed + 1, isProgmem);
+  if (state.length == 0) {
+    return;
+  }
+  state.currentNote = 0;
+  state.isDynamic = false;
+  state.currentRepeat = 0;
+  state.totalRepeats = (repeatCount > 0) ? repeatCount : 1;
+  state.source = MELODY_SOURCE_PACKED;
+  state.isProgmem = isProgmem;
+  state.rtttlHeader.wholeNote = readPackedWord(packed, isProgmem);
+  state.packed = packed + PACKED_HEADER_WORDS;
+  state.durations = nullptr;
+  loadMelodyNote(state);
+  state.isPlaying = true;
+  startMelodyNote(output, state, millis());
+}
+
+/**
+ * @brief Same as playPackedMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playPackedMelody(MelodyState& state, const uint16_t* packed, bool isProgmem = false, uint8_t repeatCount = 1) {
+  SpeakerOutput output;
+  playPackedMelody(output, state, packed, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Play a compact melody image (non-blocking) with optional repeats.
+ * The image comes from compactMelody() or the melody_compact tool (extras/tools); each note is decoded from
+ * its nibbles when the previous one ends, so nothing is unpacked or allocated.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param compact The compact melody image.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <typename Output>
+void playCompactMelody(Output& output, MelodyState& state, const uint8_t* compact, bool isProgmem = false, uint8_t repeatCount = 1) {
+  state.isPlaying = false;
+  if (!compact) {
+    return;
+  }
+  state.length = readCompactWord(compact + 2, isProgmem);
+  if (state.length == 0) {
+    return;
+  }
+  state.currentNote = 0;
+  state.isDynamic = false;
+  state.currentRepeat = 0;
+  state.totalRepeats = (repeatCount > 0) ? repeatCount : 1;
+  state.source = MELODY_SOURCE_COMPACT;
+  state.isProgmem = isProgmem;
+  state.compact = compact;
+  state.durations = nullptr;
+  startCompactCursor(compact, isProgmem, state.compactCursor);
+  if (!loadMelodyNote(state)) {
+    return;
+  }
+  state.isPlaying = true;
+  startMelodyNote(output, state, millis());
+}
+
+/**
+ * @brief Same as playCompactMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playCompactMelody(MelodyState& state, const uint8_t* compact, bool isProgmem = false, uint8_t repeatCount = 1) {
+  SpeakerOutput output;
+  playCompactMelody(output, state, compact, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Build the index of a started melody: the sum of the note durations before each note.
+ * The notes are read from a copy of the state, so playback is not disturbed; call it right after the play call.
+ * Times are at the written tempo, whatever setMelodyTempo() is set to.
+ * Melodies fed by an RTTTLStream cannot be indexed (their notes are not known in advance).
+ * @param state The MelodyState of the started melody.
+ * @param starts Array to store the start times (ms): note count + 1 entries.
+ * @param capacity Number of entries of starts.
+ * @param index Set to the index of the melody.
+ * @return False if the melody is not playing, comes from an RTTTLStream or does not fit starts.
+ */
+bool buildMelodyIndex(const MelodyState& state, uint32_t* starts, size_t capacity, MelodyIndex& index) {
+  if (!state.isPlaying || state.source == MELODY_SOURCE_STREAM || !starts) {
+    return false;
+  }
+  MelodyState reader = state;
+  rewindMelody(reader);
+  reader.controls = nullptr;
+  uint32_t total = 0;
+  size_t count = 0;
+  while (loadMelodyNote(reader)) {
+    if (count + 1 >= capacity || count >= UINT16_MAX) return false;
+    starts[count++] = total;
+    total += static_cast<uint16_t>(reader.noteDuration);
+    reader.currentNote++;
+  }
+  if (count == 0 || capacity == 0) return false;
+  starts[count] = total;
+  index.starts = starts;
+  index.count = static_cast<uint16_t>(count);
+  index.isProgmem = false;
+  return true;
+}
+
+/**
+ * @brief Get the time a note starts on the timeline of one pass of a melody.
+ * In MELODY_TIMING_RELATIVE mode every note is followed by MELODY_NOTE_GAP, which is added here.
+ * @param state The MelodyState of the melody (for its timing mode).
+ * @param index The index of the melody.
+ * @param note The note number (index.count for the end of the pass).
+ * @return The start time (ms from the start of the pass).
+ */
+uint32_t melodyNoteStart(const MelodyState& state, const MelodyIndex& index, size_t note) {
+  uint32_t start = index.isProgmem ? pgm_read_dword(index.starts + note) : index.starts[note];
+  return (state.timing == MELODY_TIMING_ABSOLUTE) ? start : start + note * MELODY_NOTE_GAP;
+}
+
+/**
+ * @brief Get the length of one pass of a melody.
+ * @param state The MelodyState of the melody.
+ * @param index The index of the melody.
+ * @return The length (ms).
+ */
+uint32_t melodyPassLength(const MelodyState& state, const MelodyIndex& index) {
+  return melodyNoteStart(state, index, index.count);
+}
+
+/**
+ * @brief Find the note playing at a time of one pass of a melody (binary search in the index).
+ * @param state The MelodyState of the melody.
+ * @param index The index of the melody.
+ * @param position The time (ms from the start of the pass).
+ * @return The last note starting at or before position.
+ */
+size_t findMelodyNote(const MelodyState& state, const MelodyIndex& index, uint32_t position) {
+  size_t low = 0;
+  size_t high = index.count;
+  while (high - low > 1) {
+    size_t middle = low + (high - low) / 2;
+    if (melodyNoteStart(state, index, middle) <= position) low = middle;
+    else high = middle;
+  }
+  return low;
+}
+
+/**
+ * @brief Get where a playing melody is in its current pass.
+ * @param state The MelodyState of the melody.
+ * @param index The index of the melody.
+ * @return The position (ms from the start of the pass), 0 if the melody is not playing.
+ */
+uint32_t melodyPosition(const MelodyState& state, const MelodyIndex& index) {
+  if (!state.isPlaying || state.currentNote >= index.count) {
+    return 0;
+  }
+  uint32_t start = melodyNoteStart(state, index, state.currentNote);
+  uint32_t slot = melodyNoteStart(state, index, state.currentNote + 1) - start;
+  uint32_t elapsed = unscaleMelodyTime(state, soundElapsed(state.time, millis()));
+  return start + (elapsed < slot ? elapsed : slot);
+}
+
+/**
+ * @brief Get the time a playing melody has played, repeats included.
+ * @param state The MelodyState of the melody.
+ * @param index The index of the melody.
+ * @return The elapsed time (ms), 0 if the melody is not playing.
+ */
+uint32_t melodyElapsed(const MelodyState& state, const MelodyIndex& index) {
+  if (!state.isPlaying) {
+    return 0;
+  }
+  return state.currentRepeat * melodyPassLength(state, index) + melodyPosition(state, index);
+}
+
+/**
+ * @brief Get the time left until a playing melody ends, repeats included.
+ * @param state The MelodyState of the melody.
+ * @param index The index of the melody.
+ * @return The remaining time (ms), 0 if the melody is not playing.
+ */
+uint32_t melodyRemaining(const MelodyState& state, const MelodyIndex& index) {
+  if (!state.isPlaying) {
+    return 0;
+  }
+  return (state.totalRepeats - state.currentRepeat) * melodyPassLength(state, index) - melodyPosition(state, index);
+}
+
+/**
+ * @brief Move a playing melody to a time of its current pass, e.g. to resume it where it was interrupted.
+ * The note at position is found in the index and starts sounding as if it had started at its own start time,
+ * so it ends exactly when it would have. Array and packed melodies jump to the note; streamed RTTTL and compact
+ * melodies are read forward to it (from the first note when seeking back).
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState of the melody.
+ * @param index The index of this melody.
+ * @param position The time to move to (ms from the start of the pass, e.g. from melodyPosition()).
+ * @return False if the melody is not playing, comes from an RTTTLStream or position is past the end of the pass.
+ */
+template <typename Output>
+bool seekMelody(Output& output, MelodyState& state, const MelodyIndex& index, uint32_t position) {
+  if (!state.isPlaying || state.source == MELODY_SOURCE_STREAM || index.count == 0 || position >= melodyPassLength(state, index)) {
+    return false;
+  }
+  size_t note = findMelodyNote(state, index, position);
+  if (state.source == MELODY_SOURCE_RTTTL || state.source == MELODY_SOURCE_COMPACT) {
+    if (note <= state.currentNote) {
+      rewindMelody(state);
+    } else {
+      state.currentNote++;
+    }
+    while (state.currentNote < note && loadMelodyNote(state)) {
+      state.currentNote++;
+    }
+  } else {
+    state.currentNote = note;
+  }
+  if (state.currentNote != note || !loadMelodyNote(state)) {
+    // The index does not match the melody
+    state.isPlaying = false;
+    output.stop();
+    return false;
+  }
+  uint32_t currentTime = millis();
+  if (state.controls) state.controls->glide.frequency = PAUSE;  // No portamento into the note
+  startMelodyNote(output, state, currentTime);
+  state.time = currentTime - scaleMelodyTime(state, position - melodyNoteStart(state, index, note));
+  return true;
+}
+
+/**
+ * @brief Same as seekMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+bool seekMelody(MelodyState& state, const MelodyIndex& index, uint32_t position) {
+  SpeakerOutput output;
+  return seekMelody(output, state, index, position);
+}
+
+/**
+ * @brief Play an RTTTL melody (non-blocking) with optional repeats.
+ * This function parses an RTTTL string (RAM or PROGMEM) and starts playing the melody.
+ * The notes are parsed into a packed image (2 bytes per note); melodies with notes that cannot be packed
+ * fall back to separate frequency and duration arrays. With RTTTL_CACHE_SLOTS set, strings played before
+ * come from the parsed-melody cache (see RTTTLCache) and are neither parsed nor allocated again.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <typename Output>
+void playRTTTLMelody(Output& output, MelodyState& state, const char* rtttl, bool isProgmem = false, uint8_t repeatCount = 1) {
+#if RTTTL_CACHE_SLOTS > 0
+  const uint16_t* cached = cacheRTTTLMelody(rtttl, isProgmem, &state);
+  if (cached) {
+    playPackedMelody(output, state, cached, false, repeatCount);
+    return;
+  }
+#endif
+  uint16_t* packed = nullptr;
+  if (parseRTTTLPacked(rtttl, packed, isProgmem)) {
+    playPackedMelody(output, state, packed, false, repeatCount);
+    if (state.isPlaying) {
+      state.isDynamic = true;
+    } else {
+      delete[] packed;
+    }
+    return;
+  }
+
   ToneFrequency* melody = nullptr;
   ToneDuration* durations = nullptr;
   size_t length = 0;
   if (parseRTTTL(rtttl, melody, durations, length, isProgmem)) {
-    playMelody(state, melody, durations, length, true, repeatCount);
+    playMelody(output, state, melody, durations, length, true, repeatCount);
   } else {
     state.isPlaying = false;
   }
 }
 
+/**
+ * @brief Same as playRTTTLMelody(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playRTTTLMelody(MelodyState& state, const char* rtttl, bool isProgmem = false, uint8_t repeatCount = 1) {
+  SpeakerOutput output;
+  playRTTTLMelody(output, state, rtttl, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Play an RTTTL melody in streaming mode (non-blocking) with optional repeats.
+ * Only the control section is parsed up front; each note is decoded from the RAM or PROGMEM string
+ * when the previous one ends. No copy of the string is made and no memory is allocated, so the
+ * melody length is not limited by MAX_RTTTL_NOTES. The string must stay valid during playback.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param rtttl The RTTTL string (e.g., "Nokia:d=4,o=5,b=225:8e6,8d6,f#,g#").
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param repeatCount Number of times to repeat the melody (default: 1).
+ */
+template <typename Output>
+void playRTTTLMelodyStreaming(Output& output, MelodyState& state, const char* rtttl, bool isProgmem = false, uint8_t repeatCount = 1) {
+  state.isPlaying = false;
+  const char* notes = rtttl;
+  if (!rtttl || !parseRTTTLHeader(notes, isProgmem, state.rtttlHeader)) {
+    return;
+  }
+  state.currentNote = 0;
+  state.length = 0;
+  state.isDynamic = false;
+  state.currentRepeat = 0;
+  state.totalRepeats = (repeatCount > 0) ? repeatCount : 1;
+  state.source = MELODY_SOURCE_RTTTL;
+  state.isProgmem = isProgmem;
+  state.rtttl = notes;
+  state.rtttlCursor = notes;
+  if (!loadMelodyNote(state)) {
+    return;
+  }
+  state.isPlaying = true;
+  startMelodyNote(output, state, millis());
+}
+
+/**
+ * @brief Same as playRTTTLMelodyStreaming(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playRTTTLMelodyStreaming(MelodyState& state, const char* rtttl, bool isProgmem = false, uint8_t repeatCount = 1) {
+  SpeakerOutput output;
+  playRTTTLMelodyStreaming(output, state, rtttl, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Play the notes decoded by an RTTTLStream (non-blocking).
+ * Playback starts right away and takes each note from the stream buffer as the previous one ends; while the
+ * next note has not arrived, the melody waits in silence (RTTTL_STREAM_WAIT ms at a time). The melody ends
+ * once the input has ended (newline, NUL or endRTTTLStream()) and the buffer is empty. Keep feeding the
+ * stream while it plays. Streamed melodies cannot repeat, since the text is not kept.
+ * Call updateMelody() in the main loop to manage note progression.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The MelodyState structure to manage the melody.
+ * @param stream The RTTTLStream the notes come from; it must stay valid during playback.
+ */
+template <typename Output>
+void playRTTTLStream(Output& output, MelodyState& state, RTTTLStream& stream) {
+  state.currentNote = 0;
+  state.length = 0;
+  state.isDynamic = false;
+  state.currentRepeat = 0;
+  state.totalRepeats = 1;
+  state.source = MELODY_SOURCE_STREAM;
+  state.isProgmem = false;
+  state.stream = &stream;
+  state.durations = nullptr;
+  state.isPlaying = loadMelodyNote(state);
+  if (state.isPlaying) {
+    startMelodyNote(output, state, millis());
+  }
+}
+
+/**
+ * @brief Same as playRTTTLStream(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playRTTTLStream(MelodyState& state, RTTTLStream& stream) {
+  SpeakerOutput output;
+  playRTTTLStream(output, state, stream);
+}
+
 /**
  * @brief Play a series of tones with a specified frequency change (non-blocking).
  * This function starts a series of tones and updates its state.
  * Call updateToneSeries() in the main loop to manage the series.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
  * @param state The ToneSeriesState structure to manage the series.
  * @param startFrequency The starting frequency of the tone series.
  * @param endFrequency The ending frequency of the tone series.
  * @param step The frequency increment (positive for rising, negative for falling).
  * @param toneDuration The duration of each tone.
  */
-void playToneSeries(ToneSeriesState& state, uint16_t startFrequency, uint16_t endFrequency, int16_t step, ToneDuration toneDuration) {
-  if (startFrequency < MIN_FREQUENCY || startFrequency > MAX_FREQUENCY || endFrequency < MIN_FREQUENCY || endFrequency > MAX_FREQUENCY || step == 0 || toneDuration <= 0) {
+template <typename Output>
+void playToneSeries(Output& output, ToneSeriesState& state, uint16_t startFrequency, uint16_t endFrequency, int16_t step, ToneDuration toneDuration) {
+  if (startFrequency < MIN_FREQUENCY || endFrequency < MIN_FREQUENCY || step == 0 || toneDuration == 0) {
     state.isPlaying = false;
     return;
   }
@@ -542,119 +2770,760 @@ void playToneSeries(ToneSeriesState& state, uint16_t startFrequency, uint16_t en
   state.endFrequency = endFrequency;
   state.step = step;
   state.duration = toneDuration;
-  state.lastToneTime = millis();
-  tone(getSpeakerPin(), startFrequency);
+  state.time = millis();
+  output.play(startFrequency);
+}
+
+/**
+ * @brief Same as playToneSeries(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playToneSeries(ToneSeriesState& state, uint16_t startFrequency, uint16_t endFrequency, int16_t step, ToneDuration toneDuration) {
+  SpeakerOutput output;
+  playToneSeries(output, state, startFrequency, endFrequency, step, toneDuration);
+}
+
+/**
+ * @brief Update the state of a tone series.
+ * Advances to the next frequency when the current tone’s duration has elapsed.
+ * Must be called repeatedly in the main loop.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The ToneSeriesState structure to update.
+ */
+template <typename Output>
+void updateToneSeries(Output& output, ToneSeriesState& state) {
+  if (!state.isPlaying) {
+    return;
+  }
+
+  uint32_t currentTime = millis();
+  if (soundElapsed(state.time, currentTime) >= static_cast<uint16_t>(state.duration)) {
+    state.currentFrequency += state.step;
+    if ((state.step > 0 && state.currentFrequency > state.endFrequency) || (state.step < 0 && state.currentFrequency < state.endFrequency)) {
+      state.isPlaying = false;
+      output.stop();
+      return;
+    }
+    output.play(static_cast<uint16_t>(state.currentFrequency));
+    state.time = nextStepTime(soundTimeAt(state.time, currentTime), static_cast<uint16_t>(state.duration), currentTime);
+  }
+}
+
+/**
+ * @brief Same as updateToneSeries(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateToneSeries(ToneSeriesState& state) {
+  SpeakerOutput output;
+  updateToneSeries(output, state);
+}
+
+/**
+ * @brief Play a frequency sweep (non-blocking).
+ * The frequency moves from startFrequency to endFrequency over duration ms, retuned every interval ms;
+ * the sweep stops when duration has elapsed. Unlike playToneSeries(), the resolution is set by the retune
+ * interval, not by the shortest ToneDuration, and each retune only adds a precomputed increment.
+ * Call updateSweep() in the main loop to manage the sweep.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The SweepState structure to manage the sweep.
+ * @param startFrequency The starting frequency (Hz).
+ * @param endFrequency The ending frequency (Hz).
+ * @param duration The length of the sweep (ms).
+ * @param curve SWEEP_LINEAR (default, equal steps in hertz) or SWEEP_EXPONENTIAL (equal steps in pitch).
+ * @param interval Time between retunes (ms, default: SWEEP_RETUNE_INTERVAL).
+ */
+template <typename Output>
+void playSweep(Output& output, SweepState& state, uint16_t startFrequency, uint16_t endFrequency, uint16_t duration, SweepCurve curve = SWEEP_LINEAR, uint16_t interval = SWEEP_RETUNE_INTERVAL) {
+  if (initSweep(state, startFrequency, endFrequency, duration, curve, interval)) {
+    output.play(startFrequency);
+  }
 }
 
 /**
- * @brief Update the state of a tone series.
- * Advances to the next frequency when the current tone’s duration has elapsed.
+ * @brief Same as playSweep(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playSweep(SweepState& state, uint16_t startFrequency, uint16_t endFrequency, uint16_t duration, SweepCurve curve = SWEEP_LINEAR, uint16_t interval = SWEEP_RETUNE_INTERVAL) {
+  SpeakerOutput output;
+  playSweep(output, state, startFrequency, endFrequency, duration, curve, interval);
+}
+
+/**
+ * @brief Update the state of a sweep.
+ * Retunes the frequency when a retune is due and stops the sweep at its end.
  * Must be called repeatedly in the main loop.
- * @param state The ToneSeriesState structure to update.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The SweepState structure to update.
  */
-void updateToneSeries(ToneSeriesState& state) {
+template <typename Output>
+void updateSweep(Output& output, SweepState& state) {
   if (!state.isPlaying) {
     return;
   }
-
-  uint32_t currentTime = millis();
-  if (currentTime - state.lastToneTime >= static_cast<uint16_t>(state.duration)) {
-    state.currentFrequency += state.step;
-    if ((state.step > 0 && state.currentFrequency > state.endFrequency) || (state.step < 0 && state.currentFrequency < state.endFrequency)) {
-      state.isPlaying = false;
-      noTone(getSpeakerPin());
-      return;
-    }
-    tone(getSpeakerPin(), static_cast<uint16_t>(state.currentFrequency));
-    state.lastToneTime = currentTime;
+  if (advanceSweep(output, state, millis())) {
+    state.isPlaying = false;
+    output.stop();
   }
 }
 
+/**
+ * @brief Same as updateSweep(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateSweep(SweepState& state) {
+  SpeakerOutput output;
+  updateSweep(output, state);
+}
+
 /**
  * @brief Play a beeping sound (non-blocking).
  * This function starts a sequence of beeps and updates its state.
  * Call updateAlert() in the main loop to manage the sequence (reuses AlertState).
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
  * @param state The AlertState structure to manage the beeps.
  * @param nr The number of beeps.
  * @param toneFrequency The frequency of the beep.
  * @param toneDuration The duration of each beep.
  * @param lapse The time lapse between consecutive beeps.
  */
+template <typename Output>
+void playBeep(Output& output, AlertState& state, uint8_t nr, ToneFrequency toneFrequency, ToneDuration toneDuration, uint16_t lapse) {
+  playAlert(output, state, nr, toneFrequency, toneDuration, lapse);
+}
+
+/**
+ * @brief Same as playBeep(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
 void playBeep(AlertState& state, uint8_t nr, ToneFrequency toneFrequency, ToneDuration toneDuration, uint16_t lapse) {
-  playAlert(state, nr, toneFrequency, toneDuration, lapse);
+  SpeakerOutput output;
+  playBeep(output, state, nr, toneFrequency, toneDuration, lapse);
 }
 
 /**
  * @brief Play a random tone.
  * This function plays a random tone with a frequency and duration within specified ranges.
  * Includes validation to ensure frequencies are within safe limits.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
  * @param minFrequency The minimum frequency of the random tone.
  * @param maxFrequency The maximum frequency of the random tone.
  * @param minDuration The minimum duration of the random tone.
  * @param maxDuration The maximum duration of the random tone.
  */
-void playRandomTone(ToneFrequency minFrequency, ToneFrequency maxFrequency, ToneDuration minDuration, ToneDuration maxDuration) {
-  if (minFrequency < MIN_FREQUENCY || maxFrequency > MAX_FREQUENCY || minFrequency > maxFrequency || minDuration <= 0 || maxDuration <= 0 || minDuration > maxDuration) {
+template <typename Output>
+void playRandomTone(Output& output, ToneFrequency minFrequency, ToneFrequency maxFrequency, ToneDuration minDuration, ToneDuration maxDuration) {
+  if (minFrequency < MIN_FREQUENCY || minFrequency > maxFrequency || minDuration == 0 || maxDuration == 0 || minDuration > maxDuration) {
     return;
   }
   ToneFrequency randomFrequency = static_cast<ToneFrequency>(random(static_cast<uint16_t>(minFrequency), static_cast<uint16_t>(maxFrequency) + 1));
   ToneDuration randomDuration = static_cast<ToneDuration>(random(static_cast<uint16_t>(minDuration), static_cast<uint16_t>(maxDuration) + 1));
-  ToneState toneState = { false, 0, randomFrequency, randomDuration };
-  playTone(toneState, randomFrequency, randomDuration);
+  ToneState toneState = {};
+  playTone(output, toneState, randomFrequency, randomDuration);
+}
+
+/**
+ * @brief Same as playRandomTone(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playRandomTone(ToneFrequency minFrequency, ToneFrequency maxFrequency, ToneDuration minDuration, ToneDuration maxDuration) {
+  SpeakerOutput output;
+  playRandomTone(output, minFrequency, maxFrequency, minDuration, maxDuration);
+}
+
+/** @brief Sine wave, for vibrato and LFO effects. */
+constexpr int8_t EFFECT_WAVE_SINE[16] PROGMEM = { 0, 49, 90, 117, 127, 117, 90, 49, 0, -49, -90, -117, -127, -117, -90, -49 };
+/** @brief The note, then the note plus depth: trills and sirens. */
+constexpr int8_t EFFECT_WAVE_TOGGLE[2] PROGMEM = { 0, 127 };
+/** @brief Four tones: the note, plus half the depth, plus the depth, plus half the depth. */
+constexpr int8_t EFFECT_WAVE_WARBLE[4] PROGMEM = { 0, 64, 127, 64 };
+/** @brief Rising staircase, for chirps. */
+constexpr int8_t EFFECT_WAVE_RAMP[8] PROGMEM = { -127, -91, -54, -18, 18, 54, 91, 127 };
+
+/** @brief Vibrato: sine of +-1.5% of the note at about 5 Hz. */
+constexpr SoundEffect EFFECT_VIBRATO PROGMEM = { EFFECT_WAVE_SINE, 16, EFFECT_SMOOTH | EFFECT_RELATIVE, 12, 15 };
+/** @brief Slow, wide wobble: sine of +-10% of the note at about 1 Hz. */
+constexpr SoundEffect EFFECT_LFO PROGMEM = { EFFECT_WAVE_SINE, 16, EFFECT_SMOOTH | EFFECT_RELATIVE, 60, 100 };
+/** @brief Trill: the note and a whole tone above, 60 ms each. */
+constexpr SoundEffect EFFECT_TRILL PROGMEM = { EFFECT_WAVE_TOGGLE, 2, EFFECT_RELATIVE | EFFECT_RETRIGGER, 60, 122 };
+/** @brief Warble: four tones spanning 6% of the note, 25 ms each. */
+constexpr SoundEffect EFFECT_WARBLE PROGMEM = { EFFECT_WAVE_WARBLE, 4, EFFECT_RELATIVE | EFFECT_RETRIGGER, 25, 60 };
+/** @brief Chirp: rising staircase over +-25% of the note, 10 ms per step, repeated. */
+constexpr SoundEffect EFFECT_CHIRP PROGMEM = { EFFECT_WAVE_RAMP, 8, EFFECT_RELATIVE | EFFECT_RETRIGGER, 10, 250 };
+/** @brief Siren: the low and the high frequency in turn; playSiren() sets depth and stepTime. */
+constexpr SoundEffect EFFECT_SIREN PROGMEM = { EFFECT_WAVE_TOGGLE, 2, 0, 100, 0 };
+
+/**
+ * @brief Get the amplitude of an effect on a note (the only division of the effect engine).
+ * @param effect The effect.
+ * @param frequency The note frequency (Hz).
+ * @return The frequency change per wave unit (Hz / 256 per 1/127).
+ */
+int32_t effectAmplitude(const SoundEffect& effect, uint16_t frequency) {
+  int32_t depth = effect.depth;
+  if (effect.flags & EFFECT_RELATIVE) {
+    return static_cast<int32_t>(frequency) * depth / 496;  // 127 * 1000 / 256
+  }
+  return depth * 256 / 127;
+}
+
+/**
+ * @brief Apply a wave value to a note.
+ * @param frequency The note frequency (Hz).
+ * @param amplitude The amplitude of the effect on the note (see effectAmplitude()).
+ * @param wave The wave value, -127 to 127.
+ * @return The modulated frequency, kept within MIN_FREQUENCY and MAX_FREQUENCY.
+ */
+uint16_t modulateFrequency(uint16_t frequency, int32_t amplitude, int32_t wave) {
+  int32_t modulated = static_cast<int32_t>(frequency) + ((amplitude * wave + 128) >> 8);
+  if (modulated < MIN_FREQUENCY) return MIN_FREQUENCY;
+  if (modulated > MAX_FREQUENCY) return MAX_FREQUENCY;
+  return static_cast<uint16_t>(modulated);
+}
+
+/**
+ * @brief Set the note an effect modulates and compute its amplitude.
+ * @param state The EffectState structure.
+ * @param frequency The note frequency (Hz), or PAUSE for silence.
+ */
+void setEffectNote(EffectState& state, uint16_t frequency) {
+  state.baseFrequency = frequency;
+  state.amplitude = effectAmplitude(state.effect, frequency);
+}
+
+/**
+ * @brief Set the effect of an EffectState and restart its wave; the note is kept.
+ * @param state The EffectState structure.
+ * @param effect The effect: a preset such as EFFECT_VIBRATO, or any SoundEffect.
+ * @param isProgmem True if the SoundEffect itself is stored in PROGMEM (default; its wave always is).
+ * @return True if the effect is valid (a wave, at least one point and a step time), false otherwise (no effect).
+ */
+bool startEffect(EffectState& state, const SoundEffect* effect, bool isProgmem = true) {
+  state.isActive = false;
+  if (!effect) {
+    return false;
+  }
+  if (isProgmem) {
+    memcpy_P(&state.effect, effect, sizeof(SoundEffect));
+  } else {
+    state.effect = *effect;
+  }
+  if (!state.effect.wave || state.effect.length == 0 || state.effect.stepTime == 0) {
+    return false;
+  }
+  state.isActive = true;
+  state.point = 0;
+  state.pointTime = millis();
+  state.lastUpdate = state.pointTime;
+  state.fractionStep = static_cast<uint16_t>(65535U / state.effect.stepTime);
+  setEffectNote(state, state.baseFrequency);
+  return true;
+}
+
+/**
+ * @brief Remove the effect of an EffectState: notes play unmodulated.
+ * @param state The EffectState structure.
+ */
+void stopEffect(EffectState& state) {
+  state.isActive = false;
+}
+
+/**
+ * @brief Move an effect to the current time and get the frequency to play.
+ * Wave points follow the start time plus multiples of stepTime (see nextStepTime()); smooth effects
+ * interpolate between the current point and the next one.
+ * @param state The EffectState structure.
+ * @param currentTime The current time (ms).
+ * @return The modulated note frequency (kept within MIN_FREQUENCY and MAX_FREQUENCY), or PAUSE for silence.
+ */
+uint16_t effectFrequency(EffectState& state, uint32_t currentTime) {
+  if (state.baseFrequency == PAUSE) {
+    return PAUSE;
+  }
+  if (!state.isActive) {
+    return state.baseFrequency;
+  }
+  if (soundElapsed(state.pointTime, currentTime) >= state.effect.stepTime) {
+    state.point = (state.point + 1 < state.effect.length) ? state.point + 1 : 0;
+    state.pointTime = nextStepTime(soundTimeAt(state.pointTime, currentTime), state.effect.stepTime, currentTime);
+  }
+  int32_t wave = static_cast<int8_t>(pgm_read_byte(&state.effect.wave[state.point]));
+  if (state.effect.flags & EFFECT_SMOOTH) {
+    uint8_t nextPoint = (state.point + 1 < state.effect.length) ? state.point + 1 : 0;
+    int32_t nextWave = static_cast<int8_t>(pgm_read_byte(&state.effect.wave[nextPoint]));
+    int32_t fraction = static_cast<int32_t>(static_cast<uint32_t>(soundElapsed(state.pointTime, currentTime)) * state.fractionStep);
+    wave += ((nextWave - wave) * fraction) >> 16;
+    state.lastUpdate = currentTime;
+  }
+  return modulateFrequency(state.baseFrequency, state.amplitude, wave);
+}
+
+/**
+ * @brief Update an effect: when a wave point (or, for smooth effects, a retune) is due, play the new frequency.
+ * Must be called repeatedly in the main loop while a note is modulated.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param state The EffectState structure to update.
+ */
+template <typename Output>
+void updateEffect(Output& output, EffectState& state) {
+  if (!state.isActive || state.baseFrequency == PAUSE) {
+    return;
+  }
+  uint32_t currentTime = millis();
+  if ((state.effect.flags & EFFECT_SMOOTH) ? soundElapsed(state.lastUpdate, currentTime) < SWEEP_RETUNE_INTERVAL : soundElapsed(state.pointTime, currentTime) < state.effect.stepTime) {
+    return;
+  }
+  uint16_t frequency = effectFrequency(state, currentTime);
+  if (frequency != state.frequency) {
+    state.frequency = frequency;
+    output.play(frequency);
+  }
+}
+
+/**
+ * @brief Same as updateEffect(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateEffect(EffectState& state) {
+  SpeakerOutput output;
+  updateEffect(output, state);
+}
+
+/**
+ * @brief Output that plays every note through an effect, so any tone or melody can be modulated, e.g.
+ * EffectOutput<> voice; startEffect(voice.effect, &EFFECT_VIBRATO); then updateMelody(voice, state) and updateEffect(voice).
+ * The wave runs freely across notes, or restarts at each note with EFFECT_RETRIGGER.
+ * @tparam Output The output the modulated notes are sent to (default: SpeakerOutput).
+ */
+template <typename Output = SpeakerOutput>
+struct EffectOutput {
+  Output output;      /**< Output the modulated frequency is sent to. */
+  EffectState effect; /**< Effect applied to every note. */
+
+  void play(uint16_t frequency) {
+    uint32_t currentTime = millis();
+    if (effect.effect.flags & EFFECT_RETRIGGER) {
+      effect.point = 0;
+      effect.pointTime = currentTime;
+      effect.lastUpdate = currentTime;
+    }
+    setEffectNote(effect, frequency);
+    effect.frequency = effectFrequency(effect, currentTime);
+    if (effect.frequency != PAUSE) {
+      output.play(effect.frequency);
+    } else {
+      output.stop();
+    }
+  }
+
+  void stop() {
+    setEffectNote(effect, PAUSE);
+    effect.frequency = PAUSE;
+    output.stop();
+  }
+};
+
+/**
+ * @brief Update the effect of an EffectOutput; call it in the main loop next to the update of the sound it plays.
+ * @param output The EffectOutput.
+ */
+template <typename Output>
+void updateEffect(EffectOutput<Output>& output) {
+  updateEffect(output.output, output.effect);
+}
+
+/**
+ * @brief Get the time a siren spends on each point of the EFFECT_SIREN wave.
+ * @param state The SirenState structure of the siren.
+ * @return duration / 10 (ms), at least 1.
+ */
+uint16_t sirenStepTime(const SirenState& state) {
+  return (state.duration >= 10) ? static_cast<uint16_t>(state.duration) / 10 : 1;
+}
+
+/**
+ * @brief Get the EFFECT_SIREN preset as a siren plays it: high - low as depth, sirenStepTime() as step time.
+ * @param state The SirenState structure of the siren.
+ * @return The effect.
+ */
+SoundEffect sirenEffect(const SirenState& state) {
+  SoundEffect effect;
+  memcpy_P(&effect, &EFFECT_SIREN, sizeof(SoundEffect));
+  effect.depth = state.depth;
+  effect.stepTime = sirenStepTime(state);
+  return effect;
+}
+
+/**
+ * @brief Get the frequency of a siren at the current point of its wave.
+ * @param state The SirenState structure of the siren.
+ * @param effect The effect of the siren (see sirenEffect()).
+ * @return The low or high frequency of the siren.
+ */
+uint16_t sirenFrequency(const SirenState& state, const SoundEffect& effect) {
+  uint16_t frequency = static_cast<uint16_t>(state.lowFrequency);
+  return modulateFrequency(frequency, effectAmplitude(effect, frequency), static_cast<int8_t>(pgm_read_byte(&effect.wave[state.point])));
 }
 
 /**
  * @brief Play a siren effect (non-blocking).
- * This function starts a siren effect by alternating between two frequencies.
+ * This function starts a siren effect by alternating between two frequencies: the EFFECT_SIREN preset
+ * on the low frequency, with the high frequency as depth.
  * Call updateSiren() in the main loop to manage the effect.
  * The siren alternates frequencies every duration/10 milliseconds.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
  * @param state The SirenState structure to manage the siren.
  * @param lowFrequency The lower frequency of the siren.
- * @param highFrequency The higher frequency of the siren.
+ * @param highFrequency The higher frequency of the siren (at most 32767 Hz away from the lower one).
  * @param duration The total duration of the siren effect.
  */
-void playSiren(SirenState& state, ToneFrequency lowFrequency, ToneFrequency highFrequency, ToneDuration duration) {
-  if (lowFrequency < MIN_FREQUENCY || highFrequency > MAX_FREQUENCY || duration <= 0) {
+template <typename Output>
+void playSiren(Output& output, SirenState& state, ToneFrequency lowFrequency, ToneFrequency highFrequency, ToneDuration duration) {
+  int32_t depth = static_cast<int32_t>(highFrequency) - static_cast<int32_t>(lowFrequency);
+  if (lowFrequency < MIN_FREQUENCY || duration == 0 || depth > INT16_MAX || depth < INT16_MIN) {
     state.isPlaying = false;
     return;
   }
   state.isPlaying = true;
-  state.startTime = millis();
-  state.lastSwitchTime = state.startTime;
+  state.time = millis();
+  state.point = 0;
+  state.pointTime = state.time;
   state.lowFrequency = lowFrequency;
-  state.highFrequency = highFrequency;
+  state.depth = static_cast<int16_t>(depth);
   state.duration = duration;
-  state.isLowFrequency = true;
-  tone(getSpeakerPin(), static_cast<uint16_t>(lowFrequency));
+  output.play(sirenFrequency(state, sirenEffect(state)));
+}
+
+/**
+ * @brief Same as playSiren(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void playSiren(SirenState& state, ToneFrequency lowFrequency, ToneFrequency highFrequency, ToneDuration duration) {
+  SpeakerOutput output;
+  playSiren(output, state, lowFrequency, highFrequency, duration);
 }
 
 /**
  * @brief Update the state of a siren effect.
  * Switches between low and high frequencies until the total duration has elapsed.
  * Must be called repeatedly in the main loop.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
  * @param state The SirenState structure to update.
  */
-void updateSiren(SirenState& state) {
-  if (!state.isPlaying || millis() - state.startTime >= static_cast<uint32_t>(state.duration)) {
+template <typename Output>
+void updateSiren(Output& output, SirenState& state) {
+  if (!state.isPlaying) {
+    return;
+  }
+
+  uint32_t currentTime = millis();
+  if (soundElapsed(state.time, currentTime) >= static_cast<uint16_t>(state.duration)) {
     state.isPlaying = false;
-    noTone(getSpeakerPin());
+    output.stop();
     return;
   }
+  uint16_t stepTime = sirenStepTime(state);
+  if (soundElapsed(state.pointTime, currentTime) < stepTime) {
+    return;
+  }
+  SoundEffect effect = sirenEffect(state);
+  uint16_t previousFrequency = sirenFrequency(state, effect);
+  state.point = (state.point + 1 < effect.length) ? state.point + 1 : 0;
+  state.pointTime = nextStepTime(soundTimeAt(state.pointTime, currentTime), stepTime, currentTime);
+  uint16_t frequency = sirenFrequency(state, effect);
+  if (frequency != previousFrequency) {
+    output.play(frequency);
+  }
+}
+
+/**
+ * @brief Same as updateSiren(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updateSiren(SirenState& state) {
+  SpeakerOutput output;
+  updateSiren(output, state);
+}
+
+/**
+ * @brief Get the time a playing tone needs its next update.
+ * @param state The ToneState structure of the tone.
+ * @param deadline Set to the time (ms) updateTone() will stop the tone.
+ * @return True if the tone is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const ToneState& state, uint32_t& deadline) {
+  if (!state.isPlaying) {
+    return false;
+  }
+  deadline = soundTimeAt(state.time, millis()) + static_cast<uint16_t>(state.duration);
+  return true;
+}
+
+/**
+ * @brief Get the time a playing alert sequence needs its next update.
+ * @param state The AlertState structure of the alert.
+ * @param deadline Set to the time (ms) the current tone or lapse ends.
+ * @return True if the alert is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const AlertState& state, uint32_t& deadline) {
+  if (!state.isPlaying) {
+    return false;
+  }
+  deadline = soundTimeAt(state.time, millis()) + (state.isToneOn ? static_cast<uint16_t>(state.duration) : state.lapse);
+  return true;
+}
+
+/**
+ * @brief Get the time a playing melody needs its next update.
+ * @param state The MelodyState structure of the melody.
+ * @param deadline Set to the time (ms) updateMelody() will advance to the next note, or retune a glide if earlier.
+ * @return True if the melody is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const MelodyState& state, uint32_t& deadline) {
+  if (!state.isPlaying) {
+    return false;
+  }
+  uint32_t currentTime = millis();
+  uint32_t noteTime = soundTimeAt(state.time, currentTime);
+  uint16_t noteDuration = static_cast<uint16_t>(state.noteDuration);
+  if (state.timing != MELODY_TIMING_ABSOLUTE) {
+    deadline = noteTime + noteDuration + MELODY_NOTE_GAP;
+  } else if (!state.isArticulating && state.articulationGap > 0 && state.articulationGap < noteDuration) {
+    deadline = noteTime + noteDuration - state.articulationGap;
+  } else {
+    deadline = noteTime + noteDuration;
+  }
+  if (state.controls && state.controls->glide.isPlaying && !state.isArticulating) {
+    uint32_t retuneTime = soundTimeAt(state.controls->glide.time, currentTime) + state.controls->glide.interval;
+    if (static_cast<int32_t>(retuneTime - deadline) < 0) deadline = retuneTime;
+  }
+  return true;
+}
+
+/**
+ * @brief Get the time a playing tone series needs its next update.
+ * @param state The ToneSeriesState structure of the series.
+ * @param deadline Set to the time (ms) updateToneSeries() will move to the next frequency.
+ * @return True if the series is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const ToneSeriesState& state, uint32_t& deadline) {
+  if (!state.isPlaying) {
+    return false;
+  }
+  deadline = soundTimeAt(state.time, millis()) + static_cast<uint16_t>(state.duration);
+  return true;
+}
+
+/**
+ * @brief Get the time a playing sweep needs its next update.
+ * @param state The SweepState structure of the sweep.
+ * @param deadline Set to the time (ms) of the next retune.
+ * @return True if the sweep is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const SweepState& state, uint32_t& deadline) {
+  if (!state.isPlaying) {
+    return false;
+  }
+  deadline = soundTimeAt(state.time, millis()) + state.interval;
+  return true;
+}
+
+/**
+ * @brief Get the time a playing siren needs its next update.
+ * @param state The SirenState structure of the siren.
+ * @param deadline Set to the time (ms) of the next frequency switch, or of the end of the siren if earlier.
+ * @return True if the siren is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const SirenState& state, uint32_t& deadline) {
+  if (!state.isPlaying) {
+    return false;
+  }
+  uint32_t currentTime = millis();
+  uint32_t switchTime = soundTimeAt(state.pointTime, currentTime) + sirenStepTime(state);
+  uint32_t endTime = soundTimeAt(state.time, currentTime) + static_cast<uint16_t>(state.duration);
+  deadline = (static_cast<int32_t>(endTime - switchTime) < 0) ? endTime : switchTime;
+  return true;
+}
 
+/**
+ * @brief Get the time a modulated note needs its next updateEffect().
+ * @param state The EffectState structure of the effect.
+ * @param deadline Set to the time (ms) of the next wave point, or of the next retune of a smooth effect.
+ * @return True if an effect is modulating a note, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const EffectState& state, uint32_t& deadline) {
+  if (!state.isActive || state.baseFrequency == PAUSE) {
+    return false;
+  }
   uint32_t currentTime = millis();
-  if (currentTime - state.lastSwitchTime >= static_cast<uint16_t>(state.duration) / 10) {
-    state.isLowFrequency = !state.isLowFrequency;
-    tone(getSpeakerPin(), state.isLowFrequency ? static_cast<uint16_t>(state.lowFrequency) : static_cast<uint16_t>(state.highFrequency));
-    state.lastSwitchTime = currentTime;
+  if (state.effect.flags & EFFECT_SMOOTH) {
+    deadline = soundTimeAt(state.lastUpdate, currentTime) + SWEEP_RETUNE_INTERVAL;
+  } else {
+    deadline = soundTimeAt(state.pointTime, currentTime) + state.effect.stepTime;
+  }
+  return true;
+}
+
+/**
+ * @brief Shift the timestamps of a tone, used to resume it after a pause.
+ * @param state The ToneState structure of the tone.
+ * @param delta Time to add to the timestamps (ms).
+ */
+void shiftSoundTime(ToneState& state, uint32_t delta) {
+  state.time += delta;
+}
+
+/**
+ * @brief Shift the timestamps of an alert sequence, used to resume it after a pause.
+ * @param state The AlertState structure of the alert.
+ * @param delta Time to add to the timestamps (ms).
+ */
+void shiftSoundTime(AlertState& state, uint32_t delta) {
+  state.time += delta;
+}
+
+/**
+ * @brief Shift the timestamps of a melody, used to resume it after a pause.
+ * @param state The MelodyState structure of the melody.
+ * @param delta Time to add to the timestamps (ms).
+ */
+void shiftSoundTime(MelodyState& state, uint32_t delta) {
+  state.time += delta;
+  if (state.controls) state.controls->glide.time += delta;
+}
+
+/**
+ * @brief Shift the timestamps of a tone series, used to resume it after a pause.
+ * @param state The ToneSeriesState structure of the series.
+ * @param delta Time to add to the timestamps (ms).
+ */
+void shiftSoundTime(ToneSeriesState& state, uint32_t delta) {
+  state.time += delta;
+}
+
+/**
+ * @brief Shift the timestamps of a sweep, used to resume it after a pause.
+ * @param state The SweepState structure of the sweep.
+ * @param delta Time to add to the timestamps (ms).
+ */
+void shiftSoundTime(SweepState& state, uint32_t delta) {
+  state.time += delta;
+}
+
+/**
+ * @brief Shift the timestamps of a siren, used to resume it after a pause.
+ * @param state The SirenState structure of the siren.
+ * @param delta Time to add to the timestamps (ms).
+ */
+void shiftSoundTime(SirenState& state, uint32_t delta) {
+  state.time += delta;
+  state.pointTime += delta;
+}
+
+/**
+ * @brief Send the frequency a sound should currently produce to the speaker.
+ * Used to take the speaker back after another sound has used it.
+ * @param frequency The frequency to play, or PAUSE for silence.
+ */
+void resumeSpeaker(uint16_t frequency) {
+  if (frequency != PAUSE) {
+    tone(getSpeakerPin(), frequency);
+  } else {
+    noTone(getSpeakerPin());
+  }
+}
+
+/**
+ * @brief Get the frequency a playing tone currently produces.
+ * @param state The ToneState structure of the tone.
+ * @return The frequency of the tone.
+ */
+uint16_t soundFrequency(const ToneState& state) {
+  return static_cast<uint16_t>(state.frequency);
+}
+
+/**
+ * @brief Get the frequency a playing alert sequence currently produces.
+ * @param state The AlertState structure of the alert.
+ * @return The frequency of the tones, or PAUSE during a lapse.
+ */
+uint16_t soundFrequency(const AlertState& state) {
+  return state.isToneOn ? static_cast<uint16_t>(state.frequency) : static_cast<uint16_t>(PAUSE);
+}
+
+/**
+ * @brief Get the frequency a playing melody currently produces.
+ * @param state The MelodyState structure of the melody.
+ * @return The frequency of the current note (or of its glide), or PAUSE for a rest or an articulation gap.
+ */
+uint16_t soundFrequency(const MelodyState& state) {
+  if (state.isArticulating) return PAUSE;
+  return (state.controls && state.controls->glide.isPlaying) ? state.controls->glide.frequency : static_cast<uint16_t>(state.noteFrequency);
+}
+
+/**
+ * @brief Get the frequency a playing tone series currently produces.
+ * @param state The ToneSeriesState structure of the series.
+ * @return The current frequency of the series.
+ */
+uint16_t soundFrequency(const ToneSeriesState& state) {
+  return static_cast<uint16_t>(state.currentFrequency);
+}
+
+/**
+ * @brief Get the frequency a playing sweep currently produces.
+ * @param state The SweepState structure of the sweep.
+ * @return The current frequency of the sweep.
+ */
+uint16_t soundFrequency(const SweepState& state) {
+  return state.frequency;
+}
+
+/**
+ * @brief Get the frequency a playing siren currently produces.
+ * @param state The SirenState structure of the siren.
+ * @return The low or high frequency of the siren.
+ */
+uint16_t soundFrequency(const SirenState& state) {
+  return sirenFrequency(state, sirenEffect(state));
+}
+
+/**
+ * @brief Idle until a deadline returned by nextDeadline().
+ * On AVR the CPU sleeps in idle mode and is woken by the next interrupt (the millis() timer ticks
+ * about once per millisecond); other boards call yield(). On the host the fake clock jumps to the deadline.
+ * @param deadline The time to wait for (ms).
+ */
+void sleepUntil(uint32_t deadline) {
+#ifdef ARDUINO
+  while (static_cast<int32_t>(millis() - deadline) < 0) {
+#ifdef __AVR__
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+#else
+    yield();
+#endif
   }
+#else
+  hostSleepUntil(deadline);
+#endif
 }
 
 /**
  * @brief Stop playing the tone.
  * This function stops any tone currently being played.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ */
+template <typename Output>
+void stopTone(Output& output) {
+  output.stop();
+}
+
+/**
+ * @brief Same as stopTone(output, ...) with the speaker pin (SpeakerOutput) as output.
  */
 void stopTone() {
-  noTone(getSpeakerPin());
+  SpeakerOutput output;
+  stopTone(output);
 }
 
 // Define the melody and durations for a sample melody (non-RTTTL)
@@ -0,0 +1,174 @@
+/**
+ * @file sound_host_backend.h
+ * @brief Host (PC) backend for the sound functions.
+ * Provides the Arduino calls used by sound_fun_rtttl.h (millis, tone, noTone, PROGMEM access, Serial)
+ * so the library builds and runs on Linux for simulation, tools and benchmarks.
+ * Time comes from a fake clock advanced by hand, and every tone() or noTone() call is recorded.
+ * Included automatically by sound_fun_rtttl.h when ARDUINO is not defined.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef SOUND_HOST_BACKEND_H
+#define SOUND_HOST_BACKEND_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+/** @brief Maximum number of tone events kept by the recording sink. */
+#ifndef HOST_TONE_EVENT_CAPACITY
+#define HOST_TONE_EVENT_CAPACITY 4096
+#endif
+
+#define PROGMEM
+#define F(text) (text)
+#define pgm_read_byte(address) (*reinterpret_cast<const uint8_t*>(address))
+#define pgm_read_word(address) (*reinterpret_cast<const uint16_t*>(address))
+#define pgm_read_dword(address) (*reinterpret_cast<const uint32_t*>(address))
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define LOW 0x0
+#define HIGH 0x1
+
+/**
+ * @brief One call to tone() or noTone() seen by the recording sink.
+ */
+struct HostToneEvent {
+  uint32_t time;      /**< Fake clock time of the call (ms). */
+  uint8_t pin;        /**< Pin passed to tone() or noTone(). */
+  uint16_t frequency; /**< Frequency passed to tone(), 0 for noTone(). */
+};
+
+uint32_t hostMillis = 0;                                  /**< Fake clock (ms). */
+HostToneEvent hostToneEvents[HOST_TONE_EVENT_CAPACITY];   /**< Recorded tone events. */
+size_t hostToneEventCount = 0;                            /**< Number of recorded events. */
+uint32_t hostToneEventsDropped = 0;                       /**< Events lost because the buffer was full. */
+void (*hostToneSink)(const HostToneEvent& event) = nullptr; /**< Optional callback for every tone event. */
+bool hostSerialEcho = false;                              /**< Whether Serial output is written to stdout. */
+
+/**
+ * @brief Set the fake clock.
+ * @param ms The new time (ms).
+ */
+void hostSetMillis(uint32_t ms) {
+  hostMillis = ms;
+}
+
+/**
+ * @brief Advance the fake clock.
+ * @param ms Number of milliseconds to advance.
+ */
+void hostAdvanceMillis(uint32_t ms) {
+  hostMillis += ms;
+}
+
+/**
+ * @brief Advance the fake clock to a deadline, as a sleeping CPU would wake at it.
+ * The clock does not move if the deadline has already passed.
+ * @param deadline The time to wake up (ms).
+ */
+void hostSleepUntil(uint32_t deadline) {
+  if (static_cast<int32_t>(deadline - hostMillis) > 0) {
+    hostMillis = deadline;
+  }
+}
+
+/**
+ * @brief Discard the recorded tone events.
+ */
+void hostClearToneEvents() {
+  hostToneEventCount = 0;
+  hostToneEventsDropped = 0;
+}
+
+/**
+ * @brief Record a tone event and forward it to hostToneSink.
+ * @param pin The pin of the event.
+ * @param frequency The frequency, 0 for silence.
+ */
+void hostRecordTone(uint8_t pin, uint16_t frequency) {
+  HostToneEvent event = { hostMillis, pin, frequency };
+  if (hostToneEventCount < HOST_TONE_EVENT_CAPACITY) {
+    hostToneEvents[hostToneEventCount++] = event;
+  } else {
+    hostToneEventsDropped++;
+  }
+  if (hostToneSink) hostToneSink(event);
+}
+
+uint32_t millis() {
+  return hostMillis;
+}
+
+uint32_t micros() {
+  return hostMillis * 1000UL;
+}
+
+void delay(uint32_t ms) {
+  hostAdvanceMillis(ms);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t, uint8_t) {}
+
+int digitalRead(uint8_t) {
+  return HIGH;
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long = 0) {
+  hostRecordTone(pin, frequency);
+}
+
+void noTone(uint8_t pin) {
+  hostRecordTone(pin, 0);
+}
+
+long random(long maxValue) {
+  return maxValue > 0 ? rand() % maxValue : 0;
+}
+
+long random(long minValue, long maxValue) {
+  return minValue >= maxValue ? minValue : minValue + random(maxValue - minValue);
+}
+
+void randomSeed(unsigned long seed) {
+  srand(seed);
+}
+
+/**
+ * @brief Minimal stand-in for the Arduino Serial object.
+ * Output is discarded unless hostSerialEcho is set.
+ */
+struct HostSerial {
+  void begin(unsigned long) {}
+  operator bool() const { return true; }
+  void print(const char* text) { if (hostSerialEcho) fputs(text, stdout); }
+  void print(char c) { if (hostSerialEcho) fputc(c, stdout); }
+  void print(long value) { if (hostSerialEcho) printf("%ld", value); }
+  void print(unsigned long value) { if (hostSerialEcho) printf("%lu", value); }
+  void print(int value) { print(static_cast<long>(value)); }
+  void print(unsigned int value) { print(static_cast<unsigned long>(value)); }
+  void print(double value) { if (hostSerialEcho) printf("%.2f", value); }
+  template <typename T>
+  void println(T value) {
+    print(value);
+    println();
+  }
+  void println() { if (hostSerialEcho) fputc('\n', stdout); }
+};
+
+HostSerial Serial; /**< Host Serial object. */
+
+#endif  // SOUND_HOST_BACKEND_H
@@ -0,0 +1,317 @@
+/**
+ * @file sound_playlist.h
+ * @brief Playlist: a queue of melodies played back to back with no gap and no heap allocation.
+ * Tracks are RTTTL strings (RAM or PROGMEM), packed images or catalog entries. While a track plays,
+ * the next RTTTL track is packed into a second buffer a few notes per updatePlaylist() call, in the
+ * idle time between note transitions; when the current track ends the next one starts on the same
+ * note boundary. Memory use is fixed: the queue and two packed buffers live in the Playlist structure.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef SOUND_PLAYLIST_H
+#define SOUND_PLAYLIST_H
+
+#include "sound_fun_rtttl.h"
+#include "melody_catalog.h"
+
+/** @brief Maximum number of tracks waiting in a playlist. */
+#ifndef SOUND_PLAYLIST_MAX_TRACKS
+#define SOUND_PLAYLIST_MAX_TRACKS 8
+#endif
+
+/** @brief Notes of each of the two prefetch buffers; longer RTTTL tracks play in streaming mode. */
+#ifndef SOUND_PLAYLIST_BUFFER_NOTES
+#define SOUND_PLAYLIST_BUFFER_NOTES 64
+#endif
+
+/** @brief Notes of the next track packed per updatePlaylist() call. */
+#ifndef SOUND_PLAYLIST_PREFETCH_NOTES
+#define SOUND_PLAYLIST_PREFETCH_NOTES 4
+#endif
+
+/**
+ * @brief Format of the melody data of a playlist track.
+ */
+enum PlaylistTrackType {
+  PLAYLIST_TRACK_RTTTL, /**< RTTTL string, packed into a prefetch buffer before it plays. */
+  PLAYLIST_TRACK_PACKED /**< Packed melody image, played as is. */
+};
+
+/**
+ * @brief How far the next track has been prepared.
+ */
+enum PlaylistPrefetch {
+  PLAYLIST_PREFETCH_IDLE,     /**< Nothing prepared yet. */
+  PLAYLIST_PREFETCH_PACKING,  /**< Header read, notes being packed into the free buffer. */
+  PLAYLIST_PREFETCH_READY,    /**< Ready to start (packed buffer or packed image). */
+  PLAYLIST_PREFETCH_STREAMING /**< Does not fit a buffer or cannot be packed: plays in streaming mode. */
+};
+
+/**
+ * @brief One melody waiting in a playlist.
+ */
+struct PlaylistTrack {
+  const void* data;    /**< RTTTL string or packed image. */
+  uint8_t type;        /**< PlaylistTrackType of data. */
+  bool isProgmem;      /**< Whether data is stored in PROGMEM. */
+  uint8_t repeatCount; /**< Number of times to play the track. */
+};
+
+/**
+ * @brief Structure to manage a queue of melodies played back to back.
+ * Use playlist.melody with setMelodyTiming() to choose the timing mode of every track.
+ */
+struct Playlist {
+  PlaylistTrack tracks[SOUND_PLAYLIST_MAX_TRACKS];                        /**< Ring buffer of tracks waiting to play. */
+  uint8_t head;                                                           /**< Index of the next track. */
+  uint8_t count;                                                          /**< Number of tracks waiting. */
+  uint16_t buffers[2][PACKED_HEADER_WORDS + SOUND_PLAYLIST_BUFFER_NOTES]; /**< Packed images of the current and next RTTTL tracks. */
+  uint8_t playingBuffer;                                                  /**< Buffer the current track plays from. */
+  uint8_t prefetch;                                                       /**< PlaylistPrefetch of the next track. */
+  const char* prefetchCursor;                                             /**< Next note of the next track to pack. */
+  RTTTLHeader prefetchHeader;                                             /**< Control section of the next track. */
+  MelodyState melody;                                                     /**< State of the current track. */
+  uint16_t tracksPlayed;                                                  /**< Number of tracks started. */
+};
+
+/**
+ * @brief Initialize an empty playlist. The timing settings of playlist.melody are kept.
+ * @param playlist The Playlist structure to initialize.
+ */
+void initPlaylist(Playlist& playlist) {
+  playlist.head = 0;
+  playlist.count = 0;
+  playlist.playingBuffer = 0;
+  playlist.prefetch = PLAYLIST_PREFETCH_IDLE;
+  playlist.prefetchCursor = nullptr;
+  playlist.melody.isPlaying = false;
+  playlist.tracksPlayed = 0;
+}
+
+/**
+ * @brief Add a track at the end of a playlist.
+ * @param playlist The Playlist structure.
+ * @param data The RTTTL string or packed image; it must stay valid until the track has played.
+ * @param type PLAYLIST_TRACK_RTTTL or PLAYLIST_TRACK_PACKED.
+ * @param isProgmem True if data is stored in PROGMEM.
+ * @param repeatCount Number of times to play the track.
+ * @return False if data is null or the queue is full.
+ */
+bool queuePlaylistTrack(Playlist& playlist, const void* data, PlaylistTrackType type, bool isProgmem, uint8_t repeatCount) {
+  if (!data || playlist.count >= SOUND_PLAYLIST_MAX_TRACKS) {
+    return false;
+  }
+  PlaylistTrack& track = playlist.tracks[(playlist.head + playlist.count) % SOUND_PLAYLIST_MAX_TRACKS];
+  track.data = data;
+  track.type = type;
+  track.isProgmem = isProgmem;
+  track.repeatCount = (repeatCount > 0) ? repeatCount : 1;
+  playlist.count++;
+  return true;
+}
+
+/**
+ * @brief Add an RTTTL melody at the end of a playlist.
+ * @param playlist The Playlist structure.
+ * @param rtttl The RTTTL string; it must stay valid until the track has played.
+ * @param isProgmem True if the RTTTL string is stored in PROGMEM.
+ * @param repeatCount Number of times to play the track (default: 1).
+ * @return False if the queue is full.
+ */
+bool queueRTTTLTrack(Playlist& playlist, const char* rtttl, bool isProgmem = false, uint8_t repeatCount = 1) {
+  return queuePlaylistTrack(playlist, rtttl, PLAYLIST_TRACK_RTTTL, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Add a packed melody image (PROGMEM_RTTTL, PROGMEM_TONE_MELODY, packMelody()) at the end of a playlist.
+ * @param playlist The Playlist structure.
+ * @param packed The packed melody image; it must stay valid until the track has played.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ * @param repeatCount Number of times to play the track (default: 1).
+ * @return False if the queue is full.
+ */
+bool queuePackedTrack(Playlist& playlist, const uint16_t* packed, bool isProgmem = false, uint8_t repeatCount = 1) {
+  return queuePlaylistTrack(playlist, packed, PLAYLIST_TRACK_PACKED, isProgmem, repeatCount);
+}
+
+/**
+ * @brief Add a catalog melody at the end of a playlist.
+ * @param playlist The Playlist structure.
+ * @param entry The entry from findCatalogMelody() or readCatalogEntry().
+ * @param repeatCount Number of times to play the track (default: 1).
+ * @return False if the queue is full.
+ */
+bool queueCatalogTrack(Playlist& playlist, const MelodyCatalogEntry& entry, uint8_t repeatCount = 1) {
+  PlaylistTrackType type = (entry.format == CATALOG_FORMAT_PACKED) ? PLAYLIST_TRACK_PACKED : PLAYLIST_TRACK_RTTTL;
+  return queuePlaylistTrack(playlist, entry.data, type, true, repeatCount);
+}
+
+/**
+ * @brief Find a catalog melody by name and add it at the end of a playlist.
+ * @param playlist The Playlist structure.
+ * @param catalog The catalog entries (PROGMEM), sorted by name.
+ * @param count The number of entries.
+ * @param name The name of the melody (case-insensitive).
+ * @param repeatCount Number of times to play the track (default: 1).
+ * @return False if the melody was not found or the queue is full.
+ */
+bool queueCatalogTrack(Playlist& playlist, const MelodyCatalogEntry* catalog, size_t count, const char* name, uint8_t repeatCount = 1) {
+  MelodyCatalogEntry entry;
+  return findCatalogMelody(catalog, count, name, entry) && queueCatalogTrack(playlist, entry, repeatCount);
+}
+
+/**
+ * @brief Prepare the next track of a playlist, at most maxNotes notes at a time.
+ * Packed images are ready at once. RTTTL tracks are packed into the buffer the current track is not
+ * using; tracks longer than SOUND_PLAYLIST_BUFFER_NOTES or with notes that cannot be packed are left
+ * to play in streaming mode, which needs no buffer either.
+ * @param playlist The Playlist structure.
+ * @param maxNotes Maximum number of notes to pack in this call.
+ * @return True once the next track is ready to start (or there is no next track).
+ */
+bool prefetchPlaylistTrack(Playlist& playlist, uint16_t maxNotes) {
+  if (playlist.count == 0 || playlist.prefetch == PLAYLIST_PREFETCH_READY || playlist.prefetch == PLAYLIST_PREFETCH_STREAMING) {
+    return true;
+  }
+  const PlaylistTrack& track = playlist.tracks[playlist.head];
+  uint16_t* image = playlist.buffers[playlist.playingBuffer ^ 1];
+  if (playlist.prefetch == PLAYLIST_PREFETCH_IDLE) {
+    if (track.type == PLAYLIST_TRACK_PACKED) {
+      playlist.prefetch = PLAYLIST_PREFETCH_READY;
+      return true;
+    }
+    const char* notes = static_cast<const char*>(track.data);
+    if (!parseRTTTLHeader(notes, track.isProgmem, playlist.prefetchHeader) || !isPackedWholeNote(playlist.prefetchHeader)) {
+      playlist.prefetch = PLAYLIST_PREFETCH_STREAMING;
+      return true;
+    }
+    playlist.prefetchCursor = notes;
+    image[0] = playlist.prefetchHeader.wholeNote;
+    image[1] = 0;
+    playlist.prefetch = PLAYLIST_PREFETCH_PACKING;
+  }
+
+  RTTTLNote note;
+  for (uint16_t i = 0; i < maxNotes; i++) {
+    if (!readRTTTLNote(playlist.prefetchCursor, track.isProgmem, playlist.prefetchHeader, note)) {
+      playlist.prefetch = (image[1] > 0) ? PLAYLIST_PREFETCH_READY : PLAYLIST_PREFETCH_STREAMING;
+      return true;
+    }
+    if (image[1] >= SOUND_PLAYLIST_BUFFER_NOTES || !packRTTTLNote(note, image[PACKED_HEADER_WORDS + image[1]])) {
+      playlist.prefetch = PLAYLIST_PREFETCH_STREAMING;
+      return true;
+    }
+    image[1]++;
+  }
+  return false;
+}
+
+/**
+ * @brief Start the next track of a playlist, finishing its preparation if needed.
+ * In MELODY_TIMING_ABSOLUTE mode the first note is placed on startTime, so the timeline continues
+ * from the previous track.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param playlist The Playlist structure.
+ * @param startTime The time the track is scheduled to start (ms).
+ * @return True if a track started.
+ */
+template <typename Output>
+bool startPlaylistTrack(Output& output, Playlist& playlist, uint32_t startTime) {
+  while (playlist.count > 0) {
+    prefetchPlaylistTrack(playlist, UINT16_MAX);
+    PlaylistTrack track = playlist.tracks[playlist.head];
+    uint8_t prefetch = playlist.prefetch;
+    playlist.head = (playlist.head + 1) % SOUND_PLAYLIST_MAX_TRACKS;
+    playlist.count--;
+    playlist.prefetch = PLAYLIST_PREFETCH_IDLE;
+
+    if (prefetch == PLAYLIST_PREFETCH_STREAMING) {
+      playRTTTLMelodyStreaming(output, playlist.melody, static_cast<const char*>(track.data), track.isProgmem, track.repeatCount);
+    } else if (track.type == PLAYLIST_TRACK_PACKED) {
+      playPackedMelody(output, playlist.melody, static_cast<const uint16_t*>(track.data), track.isProgmem, track.repeatCount);
+    } else {
+      playlist.playingBuffer ^= 1;
+      playPackedMelody(output, playlist.melody, playlist.buffers[playlist.playingBuffer], false, track.repeatCount);
+    }
+    if (playlist.melody.isPlaying) {
+      MelodyState& melody = playlist.melody;
+      if (melody.timing == MELODY_TIMING_ABSOLUTE && millis() - startTime < static_cast<uint16_t>(melody.noteDuration)) {
+        melody.time = startTime;
+      }
+      playlist.tracksPlayed++;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Update a playlist: advance the current track, start the next one on the note boundary where
+ * the current one ends, and use the remaining time to prepare the next track.
+ * Starts the first queued track when nothing is playing. Must be called repeatedly in the main loop.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param playlist The Playlist structure to update.
+ */
+template <typename Output>
+void updatePlaylist(Output& output, Playlist& playlist) {
+  MelodyState& melody = playlist.melody;
+  if (!melody.isPlaying) {
+    startPlaylistTrack(output, playlist, millis());
+    return;
+  }
+
+  uint32_t boundary;
+  nextDeadline(melody, boundary);
+  updateMelody(output, melody);
+  if (!melody.isPlaying) {
+    startPlaylistTrack(output, playlist, boundary);
+    return;
+  }
+  prefetchPlaylistTrack(playlist, SOUND_PLAYLIST_PREFETCH_NOTES);
+}
+
+/**
+ * @brief Same as updatePlaylist(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void updatePlaylist(Playlist& playlist) {
+  SpeakerOutput output;
+  updatePlaylist(output, playlist);
+}
+
+/**
+ * @brief Stop the current track and remove every queued track.
+ * @tparam Output Output type with play(frequency) and stop() members (e.g. SpeakerOutput).
+ * @param output The output the sound is sent to.
+ * @param playlist The Playlist structure.
+ */
+template <typename Output>
+void stopPlaylist(Output& output, Playlist& playlist) {
+  playlist.head = 0;
+  playlist.count = 0;
+  playlist.prefetch = PLAYLIST_PREFETCH_IDLE;
+  playlist.melody.isPlaying = false;
+  output.stop();
+}
+
+/**
+ * @brief Same as stopPlaylist(output, ...) with the speaker pin (SpeakerOutput) as output.
+ */
+void stopPlaylist(Playlist& playlist) {
+  SpeakerOutput output;
+  stopPlaylist(output, playlist);
+}
+
+/**
+ * @brief Check whether a playlist is playing or has tracks waiting.
+ * @param playlist The Playlist structure.
+ * @return True until the last track has ended.
+ */
+bool isPlaylistPlaying(const Playlist& playlist) {
+  return playlist.melody.isPlaying || playlist.count > 0;
+}
+
+#endif  // SOUND_PLAYLIST_H
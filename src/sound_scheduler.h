@@ -0,0 +1,381 @@
+/**
+ * @file sound_scheduler.h
+ * @brief Sound scheduler: one update entry point and priority arbitration of the speaker.
+ * The scheduler keeps pointers to the state structures of the active sounds (tones, alerts, melodies,
+ * tone series, sirens and sweeps). Only the highest-priority playing sound is updated and may use the speaker;
+ * lower-priority sounds are frozen and resume where they stopped when the speaker is free again.
+ * When no transition is due, updateSoundScheduler() only compares millis() with a cached deadline.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef SOUND_SCHEDULER_H
+#define SOUND_SCHEDULER_H
+
+#include "sound_fun_rtttl.h"
+
+/** @brief Maximum number of sounds a scheduler can hold. */
+#ifndef SOUND_SCHEDULER_MAX_JOBS
+#define SOUND_SCHEDULER_MAX_JOBS 4
+#endif
+
+/** @brief Index used when no sound owns the speaker. */
+#define SOUND_JOB_NONE -1
+
+/**
+ * @brief Kind of state structure held by a sound job.
+ */
+enum SoundJobType : uint8_t {
+  SOUND_JOB_TONE,        /**< ToneState, updated with updateTone(). */
+  SOUND_JOB_ALERT,       /**< AlertState, updated with updateAlert(). */
+  SOUND_JOB_MELODY,      /**< MelodyState, updated with updateMelody(). */
+  SOUND_JOB_TONE_SERIES, /**< ToneSeriesState, updated with updateToneSeries(). */
+  SOUND_JOB_SIREN,       /**< SirenState, updated with updateSiren(). */
+  SOUND_JOB_SWEEP        /**< SweepState, updated with updateSweep(). */
+};
+
+/**
+ * @brief Function called when the next deadline of a scheduler changes.
+ * Can arm a hardware or RTOS timer that calls updateSoundScheduler() at the deadline (ms).
+ */
+typedef void (*SoundDeadlineCallback)(uint32_t deadline);
+
+/**
+ * @brief One sound registered in a scheduler.
+ */
+struct SoundJob {
+  SoundStateHeader* state; /**< State structure of the sound (owned by the caller), cast back to its kind by type. */
+  uint32_t frozenSince;    /**< Time the sound was paused (ms). */
+  SoundJobType type;       /**< Kind of state structure. */
+  uint8_t priority;        /**< Priority of the sound; higher values preempt lower ones. */
+  bool isFrozen;           /**< Whether the sound is paused because a higher-priority sound owns the speaker. */
+};
+
+static_assert(sizeof(SoundJob) <= SOUND_STATE_BUDGET(9, 12, 16), "SoundJob exceeds its RAM budget");
+
+/**
+ * @brief Structure to manage a set of sounds sharing the speaker.
+ */
+struct SoundScheduler {
+  SoundJob jobs[SOUND_SCHEDULER_MAX_JOBS]; /**< Registered sounds. */
+  uint8_t jobCount;                        /**< Number of registered sounds. */
+  int8_t activeJob;                        /**< Index of the sound that owns the speaker, or SOUND_JOB_NONE. */
+  uint32_t nextDue;                        /**< Time the active sound needs its next update (ms). */
+  SoundDeadlineCallback onDeadline;        /**< Optional function told about every new deadline (nullptr if unused). */
+};
+
+/**
+ * @brief Initialize a sound scheduler with no sounds.
+ * @param scheduler The SoundScheduler structure to initialize.
+ */
+void initSoundScheduler(SoundScheduler& scheduler) {
+  scheduler.jobCount = 0;
+  scheduler.activeJob = SOUND_JOB_NONE;
+  scheduler.nextDue = 0;
+  scheduler.onDeadline = nullptr;
+}
+
+/**
+ * @brief Set the function told about every new deadline of a scheduler.
+ * Use it to wake the main loop from a timer instead of polling updateSoundScheduler().
+ * @param scheduler The SoundScheduler structure.
+ * @param callback The function to call, or nullptr to disable it.
+ */
+void setSoundDeadlineCallback(SoundScheduler& scheduler, SoundDeadlineCallback callback) {
+  scheduler.onDeadline = callback;
+}
+
+/**
+ * @brief Check whether the sound of a job is playing.
+ * @param job The sound job.
+ * @return True if the state of the job is playing.
+ */
+bool isSoundJobPlaying(const SoundJob& job) {
+  return job.state->isPlaying;
+}
+
+/**
+ * @brief Run the update function of a job.
+ * @param job The sound job.
+ */
+void updateSoundJob(SoundJob& job) {
+  switch (job.type) {
+    case SOUND_JOB_TONE: updateTone(*static_cast<ToneState*>(job.state)); break;
+    case SOUND_JOB_ALERT: updateAlert(*static_cast<AlertState*>(job.state)); break;
+    case SOUND_JOB_MELODY: updateMelody(*static_cast<MelodyState*>(job.state)); break;
+    case SOUND_JOB_TONE_SERIES: updateToneSeries(*static_cast<ToneSeriesState*>(job.state)); break;
+    case SOUND_JOB_SIREN: updateSiren(*static_cast<SirenState*>(job.state)); break;
+    case SOUND_JOB_SWEEP: updateSweep(*static_cast<SweepState*>(job.state)); break;
+  }
+}
+
+/**
+ * @brief Get the time a job needs its next update.
+ * @param job The sound job.
+ * @param deadline Set to the time (ms) of the next transition of the job.
+ * @return True if the job is playing.
+ */
+bool soundJobDeadline(const SoundJob& job, uint32_t& deadline) {
+  switch (job.type) {
+    case SOUND_JOB_TONE: return nextDeadline(*static_cast<const ToneState*>(job.state), deadline);
+    case SOUND_JOB_ALERT: return nextDeadline(*static_cast<const AlertState*>(job.state), deadline);
+    case SOUND_JOB_MELODY: return nextDeadline(*static_cast<const MelodyState*>(job.state), deadline);
+    case SOUND_JOB_TONE_SERIES: return nextDeadline(*static_cast<const ToneSeriesState*>(job.state), deadline);
+    case SOUND_JOB_SIREN: return nextDeadline(*static_cast<const SirenState*>(job.state), deadline);
+    case SOUND_JOB_SWEEP: return nextDeadline(*static_cast<const SweepState*>(job.state), deadline);
+  }
+  return false;
+}
+
+/**
+ * @brief Store the next deadline of the active sound and report it to the deadline callback.
+ * @param scheduler The SoundScheduler structure.
+ * @return True if the active sound is still playing.
+ */
+bool refreshSoundDeadline(SoundScheduler& scheduler) {
+  if (!soundJobDeadline(scheduler.jobs[scheduler.activeJob], scheduler.nextDue)) {
+    return false;
+  }
+  if (scheduler.onDeadline) {
+    scheduler.onDeadline(scheduler.nextDue);
+  }
+  return true;
+}
+
+/**
+ * @brief Give the speaker to a job: shift its timestamps past the time it was frozen and restore its sound.
+ * @param job The sound job.
+ * @param currentTime The current time (ms).
+ */
+void resumeSoundJob(SoundJob& job, uint32_t currentTime) {
+  uint32_t delta = job.isFrozen ? currentTime - job.frozenSince : 0;
+  job.isFrozen = false;
+  switch (job.type) {
+    case SOUND_JOB_TONE:
+      shiftSoundTime(*static_cast<ToneState*>(job.state), delta);
+      resumeSpeaker(soundFrequency(*static_cast<ToneState*>(job.state)));
+      break;
+    case SOUND_JOB_ALERT:
+      shiftSoundTime(*static_cast<AlertState*>(job.state), delta);
+      resumeSpeaker(soundFrequency(*static_cast<AlertState*>(job.state)));
+      break;
+    case SOUND_JOB_MELODY:
+      shiftSoundTime(*static_cast<MelodyState*>(job.state), delta);
+      resumeSpeaker(soundFrequency(*static_cast<MelodyState*>(job.state)));
+      break;
+    case SOUND_JOB_TONE_SERIES:
+      shiftSoundTime(*static_cast<ToneSeriesState*>(job.state), delta);
+      resumeSpeaker(soundFrequency(*static_cast<ToneSeriesState*>(job.state)));
+      break;
+    case SOUND_JOB_SIREN:
+      shiftSoundTime(*static_cast<SirenState*>(job.state), delta);
+      resumeSpeaker(soundFrequency(*static_cast<SirenState*>(job.state)));
+      break;
+    case SOUND_JOB_SWEEP:
+      shiftSoundTime(*static_cast<SweepState*>(job.state), delta);
+      resumeSpeaker(soundFrequency(*static_cast<SweepState*>(job.state)));
+      break;
+  }
+}
+
+/**
+ * @brief Choose the sound that owns the speaker.
+ * The playing job with the highest priority wins (ties go to the job registered last). Every other
+ * playing job is frozen, and the winner is resumed, which also restores its sound on the speaker.
+ * @param scheduler The SoundScheduler structure.
+ * @param currentTime The current time (ms).
+ */
+void arbitrateSoundJobs(SoundScheduler& scheduler, uint32_t currentTime) {
+  int8_t best = SOUND_JOB_NONE;
+  for (uint8_t i = 0; i < scheduler.jobCount; i++) {
+    if (isSoundJobPlaying(scheduler.jobs[i]) && (best == SOUND_JOB_NONE || scheduler.jobs[i].priority >= scheduler.jobs[best].priority)) {
+      best = static_cast<int8_t>(i);
+    }
+  }
+  for (uint8_t i = 0; i < scheduler.jobCount; i++) {
+    SoundJob& job = scheduler.jobs[i];
+    if (static_cast<int8_t>(i) != best && !job.isFrozen && isSoundJobPlaying(job)) {
+      job.isFrozen = true;
+      job.frozenSince = currentTime;
+    }
+  }
+  scheduler.activeJob = best;
+  if (best == SOUND_JOB_NONE) {
+    return;
+  }
+  resumeSoundJob(scheduler.jobs[best], currentTime);
+  refreshSoundDeadline(scheduler);
+}
+
+/**
+ * @brief Register a started sound in a scheduler, or re-arm one that is already registered.
+ * @param scheduler The SoundScheduler structure.
+ * @param type The kind of state structure.
+ * @param state The state structure of the sound.
+ * @param priority Priority of the sound; higher values preempt lower ones.
+ * @return True if the sound is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, SoundJobType type, SoundStateHeader* state, uint8_t priority) {
+  uint8_t index = 0;
+  while (index < scheduler.jobCount && scheduler.jobs[index].state != state) {
+    index++;
+  }
+  if (index == scheduler.jobCount) {
+    if (scheduler.jobCount >= SOUND_SCHEDULER_MAX_JOBS) {
+      return false;
+    }
+    scheduler.jobCount++;
+  }
+  SoundJob& job = scheduler.jobs[index];
+  job.type = type;
+  job.state = state;
+  job.priority = priority;
+  job.isFrozen = false;
+  arbitrateSoundJobs(scheduler, millis());
+  return true;
+}
+
+/**
+ * @brief Register a tone started with playTone().
+ * Call it after each playTone() on this state; a lower-priority tone starts frozen.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The ToneState structure of the tone.
+ * @param priority Priority of the tone; higher values preempt lower ones.
+ * @return True if the tone is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, ToneState& state, uint8_t priority) {
+  return addSoundJob(scheduler, SOUND_JOB_TONE, &state, priority);
+}
+
+/**
+ * @brief Register an alert or beep sequence started with playAlert() or playBeep().
+ * Call it after each playAlert() on this state; a lower-priority alert starts frozen.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The AlertState structure of the alert.
+ * @param priority Priority of the alert; higher values preempt lower ones.
+ * @return True if the alert is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, AlertState& state, uint8_t priority) {
+  return addSoundJob(scheduler, SOUND_JOB_ALERT, &state, priority);
+}
+
+/**
+ * @brief Register a melody started with playMelody(), playRTTTLMelody() or playPackedMelody().
+ * Call it after each play call on this state; a lower-priority melody starts frozen.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The MelodyState structure of the melody.
+ * @param priority Priority of the melody; higher values preempt lower ones.
+ * @return True if the melody is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, MelodyState& state, uint8_t priority) {
+  return addSoundJob(scheduler, SOUND_JOB_MELODY, &state, priority);
+}
+
+/**
+ * @brief Register a tone series started with playToneSeries().
+ * Call it after each playToneSeries() on this state; a lower-priority series starts frozen.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The ToneSeriesState structure of the series.
+ * @param priority Priority of the series; higher values preempt lower ones.
+ * @return True if the series is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, ToneSeriesState& state, uint8_t priority) {
+  return addSoundJob(scheduler, SOUND_JOB_TONE_SERIES, &state, priority);
+}
+
+/**
+ * @brief Register a siren started with playSiren().
+ * Call it after each playSiren() on this state; a lower-priority siren starts frozen.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The SirenState structure of the siren.
+ * @param priority Priority of the siren; higher values preempt lower ones.
+ * @return True if the siren is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, SirenState& state, uint8_t priority) {
+  return addSoundJob(scheduler, SOUND_JOB_SIREN, &state, priority);
+}
+
+/**
+ * @brief Register a sweep started with playSweep().
+ * Call it after each playSweep() on this state; a lower-priority sweep starts frozen.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The SweepState structure of the sweep.
+ * @param priority Priority of the sweep; higher values preempt lower ones.
+ * @return True if the sweep is registered, false if the scheduler is full.
+ */
+bool addSoundJob(SoundScheduler& scheduler, SweepState& state, uint8_t priority) {
+  return addSoundJob(scheduler, SOUND_JOB_SWEEP, &state, priority);
+}
+
+/**
+ * @brief Remove a sound from a scheduler.
+ * The sound is no longer updated; if it owned the speaker, the next sound by priority takes over.
+ * @param scheduler The SoundScheduler structure.
+ * @param state The state structure of the sound.
+ */
+void removeSoundJob(SoundScheduler& scheduler, const SoundStateHeader* state) {
+  uint8_t index = 0;
+  while (index < scheduler.jobCount && scheduler.jobs[index].state != state) {
+    index++;
+  }
+  if (index == scheduler.jobCount) {
+    return;
+  }
+  if (static_cast<int8_t>(index) == scheduler.activeJob) {
+    noTone(getSpeakerPin());
+  }
+  for (uint8_t i = index; i + 1 < scheduler.jobCount; i++) {
+    scheduler.jobs[i] = scheduler.jobs[i + 1];
+  }
+  scheduler.jobCount--;
+  arbitrateSoundJobs(scheduler, millis());
+}
+
+/**
+ * @brief Update all the sounds of a scheduler.
+ * Only the sound that owns the speaker is updated, and only once its next transition is due;
+ * when it ends, the next sound by priority resumes. Must be called repeatedly in the main loop.
+ * @param scheduler The SoundScheduler structure to update.
+ */
+void updateSoundScheduler(SoundScheduler& scheduler) {
+  if (scheduler.activeJob == SOUND_JOB_NONE) {
+    return;
+  }
+  uint32_t currentTime = millis();
+  if (static_cast<int32_t>(currentTime - scheduler.nextDue) < 0) {
+    return;
+  }
+
+  updateSoundJob(scheduler.jobs[scheduler.activeJob]);
+  if (!refreshSoundDeadline(scheduler)) {
+    arbitrateSoundJobs(scheduler, currentTime);
+  }
+}
+
+/**
+ * @brief Get the time a scheduler next needs updateSoundScheduler().
+ * Calling updateSoundScheduler() earlier does nothing, so the main loop can sleep or do other work until then
+ * (see sleepUntil()). The deadline changes when sounds are added or removed.
+ * @param scheduler The SoundScheduler structure.
+ * @param deadline Set to the time (ms) of the next transition of the sound that owns the speaker.
+ * @return True if a sound is playing, false otherwise (deadline is left unchanged).
+ */
+bool nextDeadline(const SoundScheduler& scheduler, uint32_t& deadline) {
+  if (scheduler.activeJob == SOUND_JOB_NONE) {
+    return false;
+  }
+  deadline = scheduler.nextDue;
+  return true;
+}
+
+/**
+ * @brief Check whether any sound of a scheduler is playing.
+ * @param scheduler The SoundScheduler structure.
+ * @return True if a sound owns the speaker.
+ */
+bool isSoundSchedulerPlaying(const SoundScheduler& scheduler) {
+  return scheduler.activeJob != SOUND_JOB_NONE;
+}
+
+#endif  // SOUND_SCHEDULER_H
@@ -0,0 +1,122 @@
+/**
+ * @file sound_speaker.h
+ * @brief Speaker outputs bound to their own pin, for driving several buzzers independently.
+ * Any of these types can be passed as the output of the play and update functions, e.g.
+ * updateMelody(panel, panelMelody), each sound with its own state structure:
+ *  - Speaker<Pin>: tone()/noTone() on a pin known at compile time (no global pin read).
+ *  - PinOutput: tone()/noTone() on a pin chosen at run time.
+ *  - GpioSpeaker<Pin>: square wave written directly to the pin's port register from a timer interrupt.
+ *    tone() can only sound one pin at a time on most AVR boards; GpioSpeaker outputs play together.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef SOUND_SPEAKER_H
+#define SOUND_SPEAKER_H
+
+#include "sound_fun_rtttl.h"
+
+#ifdef __AVR__
+// tick() runs in an interrupt and reads 16-bit fields, so play() and stop() change them with interrupts disabled.
+#define SPEAKER_BEGIN_UPDATE() uint8_t speakerSreg = SREG; cli()
+#define SPEAKER_END_UPDATE() SREG = speakerSreg
+#else
+#define SPEAKER_BEGIN_UPDATE()
+#define SPEAKER_END_UPDATE()
+#endif
+
+/**
+ * @brief Output playing tone() on a pin fixed at compile time.
+ * Example: Speaker<9> panel; panel.begin(); playMelody(panel, state, melody, durations, length);
+ * @tparam Pin The speaker pin.
+ */
+template <uint8_t Pin>
+struct Speaker {
+  void begin() { pinMode(Pin, OUTPUT); }
+  void play(uint16_t frequency) { tone(Pin, frequency); }
+  void stop() { noTone(Pin); }
+};
+
+/**
+ * @brief Output playing tone() on a pin chosen at run time.
+ * Example: PinOutput enclosure = { 10 };
+ */
+struct PinOutput {
+  uint8_t pin; /**< The speaker pin. */
+  void begin() { pinMode(pin, OUTPUT); }
+  void play(uint16_t frequency) { tone(pin, frequency); }
+  void stop() { noTone(pin); }
+};
+
+/**
+ * @brief Output generating a square wave on a pin from a periodic interrupt, without tone().
+ * A 16-bit phase accumulator advances on every tick() and its top bit is written to the pin. On AVR
+ * the port register and bit mask of the pin are looked up once in begin(), so tick() writes the port
+ * directly; elsewhere digitalWrite() is called when the level changes. Call tick() of every speaker
+ * from one timer interrupt running at the tick rate given to begin() (at least twice the highest frequency).
+ * @tparam Pin The speaker pin.
+ */
+template <uint8_t Pin>
+struct GpioSpeaker {
+  uint16_t phase;              /**< Phase accumulator; the pin is high while the top bit is set. */
+  volatile uint16_t increment; /**< Phase step per tick (frequency * 65536 / tickRate), 0 while silent. */
+  uint16_t tickRate;           /**< Rate tick() is called at (Hz). */
+  bool level;                  /**< Level last written to the pin. */
+#ifdef __AVR__
+  volatile uint8_t* port;      /**< Output register of the pin. */
+  uint8_t mask;                /**< Bit of the pin in port. */
+#endif
+
+  /**
+   * @brief Set the pin as output (low) and the rate tick() will be called at.
+   * @param rate The tick rate (Hz).
+   */
+  void begin(uint16_t rate) {
+    tickRate = rate;
+    phase = 0;
+    increment = 0;
+    level = false;
+#ifdef __AVR__
+    port = portOutputRegister(digitalPinToPort(Pin));
+    mask = digitalPinToBitMask(Pin);
+#endif
+    pinMode(Pin, OUTPUT);
+    digitalWrite(Pin, LOW);
+  }
+
+  void play(uint16_t frequency) {
+    uint16_t step = 0;
+    if (frequency != PAUSE && 2UL * frequency < tickRate) {
+      step = static_cast<uint16_t>(((static_cast<uint32_t>(frequency) << 16) + tickRate / 2) / tickRate);
+    }
+    SPEAKER_BEGIN_UPDATE();
+    increment = step;
+    SPEAKER_END_UPDATE();
+  }
+
+  void stop() {
+    play(PAUSE);
+  }
+
+  /**
+   * @brief Advance the square wave by one tick and write the pin if its level changed. Interrupt safe.
+   */
+  void tick() {
+    uint16_t step = increment;
+    phase = step ? static_cast<uint16_t>(phase + step) : 0;
+    bool high = (phase & 0x8000) != 0;
+    if (high == level) {
+      return;
+    }
+    level = high;
+#ifdef __AVR__
+    if (high) *port |= mask;
+    else *port &= ~mask;
+#else
+    digitalWrite(Pin, high ? HIGH : LOW);
+#endif
+  }
+};
+
+#endif  // SOUND_SPEAKER_H
@@ -0,0 +1,181 @@
+/**
+ * @file sound_synth.h
+ * @brief Software-mixed polyphonic square-wave synthesizer.
+ * Each voice is a 16-bit phase accumulator. renderSynthSample() mixes all voices into one signed sample
+ * with a few additions per voice, cheap enough for a timer interrupt at 8-16 kHz feeding PWM or a DAC.
+ * renderSynth() fills a whole buffer (host sinks, WAV rendering) and uses SIMD vectors where available.
+ * The play and update functions drive a voice through SynthVoiceOutput, so a melody and an alert,
+ * or several melodies forming chords, can sound at the same time.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef SOUND_SYNTH_H
+#define SOUND_SYNTH_H
+
+#include "sound_fun_rtttl.h"
+
+/** @brief Number of voices mixed by a synthesizer. */
+#ifndef SYNTH_MAX_VOICES
+#define SYNTH_MAX_VOICES 4
+#endif
+/** @brief Default level of each voice; SYNTH_MAX_VOICES voices at this level fit a signed 8-bit sample. */
+#define SYNTH_DEFAULT_LEVEL (127 / SYNTH_MAX_VOICES)
+/** @brief Offset that turns a signed sample into an unsigned 8-bit PWM duty cycle. */
+#define SYNTH_PWM_OFFSET 128
+
+#if defined(__GNUC__) && !defined(__AVR__)
+/** @brief Whether renderSynth() uses GCC vector extensions (SSE2/NEON). */
+#define SYNTH_USE_SIMD 1
+/** @brief Samples rendered per vector by renderSynth(). */
+#define SYNTH_VECTOR_LANES 8
+typedef uint16_t SynthPhaseVector __attribute__((vector_size(SYNTH_VECTOR_LANES * sizeof(uint16_t))));
+typedef int16_t SynthSampleVector __attribute__((vector_size(SYNTH_VECTOR_LANES * sizeof(int16_t))));
+#endif
+
+#ifdef __AVR__
+// The interrupt reads 16-bit voice fields, so the main loop changes them with interrupts disabled.
+#define SYNTH_BEGIN_UPDATE() uint8_t synthSreg = SREG; cli()
+#define SYNTH_END_UPDATE() SREG = synthSreg
+#else
+#define SYNTH_BEGIN_UPDATE()
+#define SYNTH_END_UPDATE()
+#endif
+
+/**
+ * @brief One square-wave voice.
+ */
+struct SynthVoice {
+  uint16_t phase;     /**< Phase accumulator; the output is high while the top bit is set. */
+  uint16_t increment; /**< Phase step per sample (frequency * 65536 / sampleRate). */
+  int16_t level;      /**< Amplitude of the voice, 0 while silent. */
+};
+
+/**
+ * @brief Structure to manage a set of mixed voices.
+ */
+struct SynthEngine {
+  SynthVoice voices[SYNTH_MAX_VOICES]; /**< The voices. */
+  uint16_t sampleRate;                 /**< Output sample rate (Hz). */
+  int16_t level;                       /**< Amplitude given to a voice when it starts playing. */
+};
+
+/**
+ * @brief Output that sends play and update functions to one synthesizer voice.
+ * Example: SynthVoiceOutput lead = { &synth, 0 }; playRTTTLMelody(lead, melodyState, NOKIA, true);
+ */
+struct SynthVoiceOutput {
+  SynthEngine* engine; /**< The synthesizer. */
+  uint8_t voice;       /**< Index of the voice. */
+  void play(uint16_t frequency);
+  void stop();
+};
+
+/**
+ * @brief Initialize a synthesizer with all voices silent.
+ * @param engine The SynthEngine structure to initialize.
+ * @param sampleRate The rate renderSynthSample() is called at (Hz).
+ * @param level Amplitude of each voice (default: SYNTH_DEFAULT_LEVEL).
+ */
+void initSynth(SynthEngine& engine, uint16_t sampleRate, int16_t level = SYNTH_DEFAULT_LEVEL) {
+  engine.sampleRate = sampleRate;
+  engine.level = level;
+  for (uint8_t i = 0; i < SYNTH_MAX_VOICES; i++) {
+    engine.voices[i].phase = 0;
+    engine.voices[i].increment = 0;
+    engine.voices[i].level = 0;
+  }
+}
+
+/**
+ * @brief Set the frequency of a voice.
+ * Frequencies at or above half the sample rate cannot be represented and silence the voice.
+ * @param engine The SynthEngine structure.
+ * @param voice Index of the voice.
+ * @param frequency The frequency (Hz), or PAUSE to silence the voice.
+ */
+void setSynthVoice(SynthEngine& engine, uint8_t voice, uint16_t frequency) {
+  if (voice >= SYNTH_MAX_VOICES) {
+    return;
+  }
+  uint16_t increment = 0;
+  int16_t level = 0;
+  if (frequency != PAUSE && 2UL * frequency < engine.sampleRate) {
+    increment = static_cast<uint16_t>(((static_cast<uint32_t>(frequency) << 16) + engine.sampleRate / 2) / engine.sampleRate);
+    level = engine.level;
+  }
+  SYNTH_BEGIN_UPDATE();
+  engine.voices[voice].increment = increment;
+  engine.voices[voice].level = level;
+  SYNTH_END_UPDATE();
+}
+
+void SynthVoiceOutput::play(uint16_t frequency) {
+  setSynthVoice(*engine, voice, frequency);
+}
+
+void SynthVoiceOutput::stop() {
+  setSynthVoice(*engine, voice, PAUSE);
+}
+
+/**
+ * @brief Render the next sample of a synthesizer.
+ * Intended for a timer interrupt: for PWM output write SYNTH_PWM_OFFSET + the sample to the compare register.
+ * @param engine The SynthEngine structure.
+ * @return The sum of all voices (between -SYNTH_MAX_VOICES * level and SYNTH_MAX_VOICES * level).
+ */
+int16_t renderSynthSample(SynthEngine& engine) {
+  int16_t sample = 0;
+  for (uint8_t i = 0; i < SYNTH_MAX_VOICES; i++) {
+    SynthVoice& voice = engine.voices[i];
+    voice.phase += voice.increment;
+    sample += (voice.phase & 0x8000) ? voice.level : -voice.level;
+  }
+  return sample;
+}
+
+/**
+ * @brief Render a block of samples of a synthesizer.
+ * Produces exactly the samples of count calls to renderSynthSample(); on the host, each voice is
+ * computed SYNTH_VECTOR_LANES samples at a time.
+ * @param engine The SynthEngine structure.
+ * @param buffer Output buffer of count samples.
+ * @param count Number of samples to render.
+ */
+void renderSynth(SynthEngine& engine, int16_t* buffer, size_t count) {
+  for (size_t n = 0; n < count; n++) {
+    buffer[n] = 0;
+  }
+  for (uint8_t i = 0; i < SYNTH_MAX_VOICES; i++) {
+    SynthVoice& voice = engine.voices[i];
+    uint16_t phase = voice.phase;
+    uint16_t increment = voice.increment;
+    int16_t level = voice.level;
+    size_t n = 0;
+#ifdef SYNTH_USE_SIMD
+    SynthPhaseVector phases;
+    for (uint8_t lane = 0; lane < SYNTH_VECTOR_LANES; lane++) {
+      phases[lane] = static_cast<uint16_t>(phase + increment * (lane + 1));
+    }
+    const SynthPhaseVector step = SynthPhaseVector() + static_cast<uint16_t>(increment * SYNTH_VECTOR_LANES);
+    const SynthSampleVector high = SynthSampleVector() + level;
+    for (; n + SYNTH_VECTOR_LANES <= count; n += SYNTH_VECTOR_LANES) {
+      SynthSampleVector isHigh = (SynthSampleVector)phases >> 15;  // -1 where the top bit is set
+      SynthSampleVector out;
+      memcpy(&out, buffer + n, sizeof(out));
+      out += (high & isHigh) - (high & ~isHigh);
+      memcpy(buffer + n, &out, sizeof(out));
+      phases += step;
+    }
+    phase = static_cast<uint16_t>(phase + increment * n);
+#endif
+    for (; n < count; n++) {
+      phase += increment;
+      buffer[n] += (phase & 0x8000) ? level : -level;
+    }
+    voice.phase = phase;
+  }
+}
+
+#endif  // SOUND_SYNTH_H
@@ -0,0 +1,317 @@
+/**
+ * @file sound_timer.h
+ * @brief Tone output on AVR Timer1 with precomputed timer settings.
+ * tone() turns every frequency into a prescaler and compare value with 32-bit divisions at run time.
+ * Here the settings of every packable note are computed at compile time (TIMER_NOTE_SETTINGS, in PROGMEM).
+ * Melodies read as note names (RTTTL, packed and compact) pass the note number of each note to the output
+ * (see playOutputNote()), so a note change is one table load and the register writes. Other sounds play
+ * frequencies, whose settings a TimerToneOutput keeps once prepared.
+ * The timer runs in CTC mode toggling OC1A (pin 9 on the Uno/Nano, 11 on the Mega); no interrupt is used.
+ * @author ATphonOS
+ * @date 2024
+ * MIT license
+ */
+
+#ifndef SOUND_TIMER_H
+#define SOUND_TIMER_H
+
+#include "sound_fun_rtttl.h"
+#include "rtttl_compile.h"
+
+/** @brief Clock of the timer (Hz). */
+#ifdef F_CPU
+#define TIMER_CLOCK F_CPU
+#else
+#define TIMER_CLOCK 16000000UL
+#endif
+
+/** @brief Pin toggled by the timer (OC1A). */
+#ifndef TIMER_OUTPUT_PIN
+#if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
+#define TIMER_OUTPUT_PIN 11
+#else
+#define TIMER_OUTPUT_PIN 9
+#endif
+#endif
+
+/** @brief Number of frequencies a TimerToneOutput keeps settings for. */
+#ifndef TIMER_OUTPUT_SETTINGS
+#define TIMER_OUTPUT_SETTINGS 16
+#endif
+
+/** @brief Number of notes in TIMER_NOTE_SETTINGS (every pitch of packed octaves 0 to PACKED_MAX_OCTAVE). */
+#define TIMER_NOTE_COUNT ((PACKED_MAX_OCTAVE + 1) * NOTES_PER_OCTAVE)
+
+/**
+ * @brief Register values that make the timer toggle its pin at a given frequency.
+ * Output frequency = TIMER_CLOCK / (2 * prescaler * (top + 1)).
+ */
+struct TimerSetting {
+  uint16_t top;        /**< Compare value (OCR1A). */
+  uint8_t clockSelect; /**< Clock select bits (CS12..CS10): 1 to 5 for prescaler 1, 8, 64, 256, 1024; 0 stops the timer. */
+};
+
+namespace sound_timer_detail {
+
+constexpr uint16_t prescaler(uint8_t clockSelect) {
+  return clockSelect == 1 ? 1 : clockSelect == 2 ? 8 : clockSelect == 3 ? 64 : clockSelect == 4 ? 256 : 1024;
+}
+
+/** Timer counts per half period, rounded to nearest. */
+constexpr uint32_t halfPeriod(uint32_t clock, uint16_t frequency, uint8_t clockSelect) {
+  return (clock + static_cast<uint32_t>(prescaler(clockSelect)) * frequency) / (2UL * prescaler(clockSelect) * frequency);
+}
+
+constexpr TimerSetting settingFor(uint32_t counts, uint8_t clockSelect) {
+  return TimerSetting{ static_cast<uint16_t>(counts > 0 ? counts - 1 : 0), clockSelect };
+}
+
+/** Smallest prescaler from clockSelect up whose half period fits the 16-bit counter. */
+constexpr TimerSetting searchSetting(uint32_t clock, uint16_t frequency, uint8_t clockSelect) {
+  return clockSelect >= 5 ? settingFor(halfPeriod(clock, frequency, 5) > 65536UL ? 65536UL : halfPeriod(clock, frequency, 5), 5)
+         : halfPeriod(clock, frequency, clockSelect) <= 65536UL ? settingFor(halfPeriod(clock, frequency, clockSelect), clockSelect)
+         : searchSetting(clock, frequency, clockSelect + 1);
+}
+
+constexpr TimerSetting noteSetting(uint8_t k) {
+  return rtttl_compile_detail::noteHz(k) < MIN_FREQUENCY ? TimerSetting{ 0, 0 } : searchSetting(TIMER_CLOCK, rtttl_compile_detail::noteHz(k), 1);
+}
+
+template <size_t N>
+struct NoteTable {
+  TimerSetting notes[N];
+};
+
+template <size_t N, size_t... I>
+constexpr NoteTable<N> noteTable(rtttl_compile_detail::IndexList<I...>) {
+  return NoteTable<N>{ { noteSetting(I)... } };
+}
+
+}  // namespace sound_timer_detail
+
+/**
+ * @brief Compute the timer setting for a frequency: the smallest prescaler whose compare value fits 16 bits,
+ * with the compare value rounded to the nearest count. Same math at compile time and at run time.
+ * @param frequency The frequency (Hz); PAUSE (0) stops the timer.
+ * @param clock The timer clock (Hz, default: TIMER_CLOCK).
+ * @return The timer setting.
+ */
+constexpr TimerSetting timerSetting(uint16_t frequency, uint32_t clock = TIMER_CLOCK) {
+  return frequency == PAUSE ? TimerSetting{ 0, 0 } : sound_timer_detail::searchSetting(clock, frequency, 1);
+}
+
+/**
+ * @brief Frequency a timer setting produces (model of the hardware), rounded to the nearest hertz.
+ * @param setting The timer setting.
+ * @param clock The timer clock (Hz, default: TIMER_CLOCK).
+ * @return The output frequency (Hz), 0 if the timer is stopped.
+ */
+constexpr uint32_t timerFrequency(TimerSetting setting, uint32_t clock = TIMER_CLOCK) {
+  return setting.clockSelect == 0 ? 0
+         : (clock + static_cast<uint32_t>(sound_timer_detail::prescaler(setting.clockSelect)) * (setting.top + 1UL)) /
+               (2UL * sound_timer_detail::prescaler(setting.clockSelect) * (setting.top + 1UL));
+}
+
+/** @brief Timer settings of every packable note, by note number (octave * 12 + semitone), computed at compile time. */
+constexpr sound_timer_detail::NoteTable<TIMER_NOTE_COUNT> TIMER_NOTE_SETTINGS PROGMEM =
+  sound_timer_detail::noteTable<TIMER_NOTE_COUNT>(rtttl_compile_detail::MakeIndexList<TIMER_NOTE_COUNT>::type());
+
+/**
+ * @brief Get the precomputed timer setting of a packed note.
+ * @param note The packed note (see packNote()).
+ * @return The setting from TIMER_NOTE_SETTINGS; the timer is stopped for pauses.
+ */
+TimerSetting timerNoteSetting(uint16_t note) {
+  TimerSetting setting = { 0, 0 };
+  uint8_t pitch = note >> PACKED_PITCH_SHIFT;
+  if (pitch > 0 && pitch <= NOTES_PER_OCTAVE) {
+    uint8_t octave = (note >> PACKED_OCTAVE_SHIFT) & 0x07;
+    memcpy_P(&setting, &TIMER_NOTE_SETTINGS.notes[octave * NOTES_PER_OCTAVE + pitch - 1], sizeof(setting));
+  }
+  return setting;
+}
+
+/**
+ * @brief Get the precomputed timer setting of a note number.
+ * @param noteNumber The note number (octave * 12 + semitone), below TIMER_NOTE_COUNT.
+ * @return The setting from TIMER_NOTE_SETTINGS.
+ */
+TimerSetting timerNoteNumberSetting(uint8_t noteNumber) {
+  TimerSetting setting;
+  memcpy_P(&setting, &TIMER_NOTE_SETTINGS.notes[noteNumber], sizeof(setting));
+  return setting;
+}
+
+#ifndef ARDUINO
+TimerSetting hostTimerSetting = { 0, 0 }; /**< Last setting written to the modeled timer. */
+uint32_t hostTimerWrites = 0;             /**< Number of setting writes to the modeled timer. */
+#endif
+
+/**
+ * @brief Write a setting to Timer1: CTC mode with OC1A toggling, or timer stopped.
+ * On the host the write is recorded in hostTimerSetting and as a tone event of the modeled frequency;
+ * on non-AVR boards tone() plays the modeled frequency.
+ * @param setting The timer setting.
+ */
+void writeTimerSetting(TimerSetting setting) {
+#if defined(__AVR__)
+  if (setting.clockSelect == 0) {
+    TCCR1B = 0;
+    TCCR1A = 0;
+    digitalWrite(TIMER_OUTPUT_PIN, LOW);
+    return;
+  }
+  TCCR1A = _BV(COM1A0);
+  OCR1A = setting.top;
+  if (TCNT1 > setting.top) TCNT1 = 0;
+  TCCR1B = _BV(WGM12) | setting.clockSelect;
+#elif defined(ARDUINO)
+  if (setting.clockSelect == 0) noTone(TIMER_OUTPUT_PIN);
+  else tone(TIMER_OUTPUT_PIN, timerFrequency(setting));
+#else
+  hostTimerSetting = setting;
+  hostTimerWrites++;
+  hostRecordTone(TIMER_OUTPUT_PIN, timerFrequency(setting));
+#endif
+}
+
+/**
+ * @brief Output driving Timer1 with precomputed settings.
+ * Melody notes with a note number in TIMER_NOTE_SETTINGS are loaded from the table (playNote()).
+ * play() looks a frequency up among the prepared ones; a frequency that was not prepared is computed
+ * with timerSetting() and kept (replacing the oldest entry when full), and counted in misses.
+ * Prepare the frequencies of other sounds with prepareTimerFrequency(), and of frequency-array melodies with prepareTimerMelody().
+ */
+struct TimerToneOutput {
+  uint16_t frequencies[TIMER_OUTPUT_SETTINGS];  /**< Prepared frequencies. */
+  TimerSetting settings[TIMER_OUTPUT_SETTINGS]; /**< Timer setting of each prepared frequency. */
+  uint8_t count;                                /**< Number of prepared frequencies. */
+  uint8_t next;                                 /**< Entry replaced by the next frequency once full. */
+  uint16_t misses;                              /**< Frequencies played without being prepared. */
+
+  void begin() {
+    count = 0;
+    next = 0;
+    misses = 0;
+    pinMode(TIMER_OUTPUT_PIN, OUTPUT);
+    writeTimerSetting(timerSetting(PAUSE));
+  }
+  void play(uint16_t frequency);
+  void playNote(uint16_t frequency, uint8_t noteNumber);
+  void stop() { writeTimerSetting(timerSetting(PAUSE)); }
+};
+
+/**
+ * @brief Play a melody note on a TimerToneOutput from its note number (see playOutputNote()).
+ */
+void playOutputNote(TimerToneOutput& output, uint16_t frequency, uint8_t noteNumber) {
+  output.playNote(frequency, noteNumber);
+}
+
+/**
+ * @brief Find the entry of a prepared frequency.
+ * @param output The TimerToneOutput.
+ * @param frequency The frequency (Hz).
+ * @return The entry index, or TIMER_OUTPUT_SETTINGS if it is not prepared.
+ */
+uint8_t findTimerFrequency(const TimerToneOutput& output, uint16_t frequency) {
+  for (uint8_t i = 0; i < output.count; i++) {
+    if (output.frequencies[i] == frequency) return i;
+  }
+  return TIMER_OUTPUT_SETTINGS;
+}
+
+/**
+ * @brief Keep the setting of a frequency in an output.
+ * @param output The TimerToneOutput.
+ * @param frequency The frequency (Hz).
+ * @param setting Its timer setting.
+ * @return The entry index.
+ */
+uint8_t addTimerSetting(TimerToneOutput& output, uint16_t frequency, TimerSetting setting) {
+  uint8_t index = findTimerFrequency(output, frequency);
+  if (index == TIMER_OUTPUT_SETTINGS) {
+    if (output.count < TIMER_OUTPUT_SETTINGS) {
+      index = output.count++;
+    } else {
+      index = output.next;
+      output.next = (output.next + 1) % TIMER_OUTPUT_SETTINGS;
+    }
+  }
+  output.frequencies[index] = frequency;
+  output.settings[index] = setting;
+  return index;
+}
+
+/**
+ * @brief Prepare one frequency (e.g. the two of a siren) so playing it needs no division.
+ * @param output The TimerToneOutput.
+ * @param frequency The frequency (Hz).
+ */
+void prepareTimerFrequency(TimerToneOutput& output, uint16_t frequency) {
+  if (frequency != PAUSE && findTimerFrequency(output, frequency) == TIMER_OUTPUT_SETTINGS) {
+    addTimerSetting(output, frequency, timerSetting(frequency));
+  }
+}
+
+/**
+ * @brief Prepare the notes of a packed melody image from TIMER_NOTE_SETTINGS (no division at all), for playing
+ * them as frequencies (e.g. through an EffectOutput); updateMelody() loads them from the table directly.
+ * Melodies with more distinct notes than TIMER_OUTPUT_SETTINGS keep the last ones.
+ * @param output The TimerToneOutput.
+ * @param packed The packed melody image.
+ * @param isProgmem True if the image is stored in PROGMEM.
+ */
+void prepareTimerMelody(TimerToneOutput& output, const uint16_t* packed, bool isProgmem = false) {
+  if (!packed) {
+    return;
+  }
+  uint16_t length = readPackedWord(packed + 1, isProgmem);
+  for (uint16_t i = 0; i < length; i++) {
+    uint16_t note = readPackedWord(packed + PACKED_HEADER_WORDS + i, isProgmem);
+    uint16_t frequency = packedNoteFrequency(note);
+    if (frequency != PAUSE && findTimerFrequency(output, frequency) == TIMER_OUTPUT_SETTINGS) {
+      addTimerSetting(output, frequency, timerNoteSetting(note));
+    }
+  }
+}
+
+/**
+ * @brief Prepare the notes of a started melody given as frequency arrays (computed once with timerSetting()),
+ * as transposed by setMelodyTranspose(). Notes read as note names (RTTTL, packed and compact images) are loaded
+ * from TIMER_NOTE_SETTINGS when played and need no preparation; streamed RTTTLStream notes are not prepared.
+ * @param output The TimerToneOutput.
+ * @param state The MelodyState of the melody.
+ */
+void prepareTimerMelody(TimerToneOutput& output, const MelodyState& state) {
+  if (state.source == MELODY_SOURCE_ARRAYS && state.melody) {
+    int8_t transpose = state.controls ? state.controls->transpose : 0;
+    for (size_t i = 0; i < state.length; i++) {
+      prepareTimerFrequency(output, transposeFrequency(static_cast<uint16_t>(state.melody[i]), transpose));
+    }
+  }
+}
+
+void TimerToneOutput::play(uint16_t frequency) {
+  uint8_t index = findTimerFrequency(*this, frequency);
+  if (index == TIMER_OUTPUT_SETTINGS) {
+    misses++;
+    index = addTimerSetting(*this, frequency, timerSetting(frequency));
+  }
+  writeTimerSetting(settings[index]);
+}
+
+/**
+ * @brief Play a note: a direct load from TIMER_NOTE_SETTINGS when the note number is in the table, play() otherwise.
+ * @param frequency The frequency of the note (Hz).
+ * @param noteNumber The note number (octave * 12 + semitone), or NO_NOTE_NUMBER.
+ */
+void TimerToneOutput::playNote(uint16_t frequency, uint8_t noteNumber) {
+  if (noteNumber < TIMER_NOTE_COUNT) {
+    writeTimerSetting(timerNoteNumberSetting(noteNumber));
+  } else {
+    play(frequency);
+  }
+}
+
+#endif  // SOUND_TIMER_H